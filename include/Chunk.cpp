@@ -1,5 +0,0 @@
-//
-// Created by admin on 19.11.2019.
-//
-
-#include "Chunk.h"
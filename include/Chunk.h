@@ -1,40 +1,259 @@
 #pragma once
 
+#include <array>
+#include <iterator>
 #include <map>
 #include <optional>
 #include <stdint.h>
+#include <string>
+#include <utility>
+#include <vector>
 #include "Block.h"
+#include "biome_grid.h"
+#include "block_registry.h"
+#include "chunk_section.h"
 
 
+/*!
+ * Lightweight view of a block inside a chunk: a block state id and its world position
+ */
+class BlockView {
+public:
+    BlockView(uint32_t id, std::array<int32_t, 3> const& pos)
+        : m_Id(id), m_Pos(pos) {
+    }
+
+    //! Block state id, see block_registry
+    [[nodiscard]] uint32_t getId() const {
+        return m_Id;
+    }
+
+    //! Namespaced block name, e.g. "minecraft:stone"
+    [[nodiscard]] std::string const& getName() const {
+        return block_registry::get_instance().get_name(m_Id);
+    }
+
+    //! Canonical block state, including properties
+    [[nodiscard]] block_state const& getState() const {
+        return block_registry::get_instance().get_state(m_Id);
+    }
+
+    [[nodiscard]] std::array<int32_t, 3> const& getPos() const {
+        return m_Pos;
+    }
+
+    [[nodiscard]] Block toBlock() const {
+        return Block(getName(), m_Pos);
+    }
+
+private:
+    uint32_t m_Id;
+    std::array<int32_t, 3> m_Pos;  // XYZ (world)
+};
+
+
+/*!
+ * Dense paletted chunk store. Every section holds 4096 indices into a palette of block state ids shared by
+ * the whole chunk, sections made of a single block only keep that palette index.
+ */
 class Chunk {
 public:
+    static constexpr int32_t SECTION_BLOCKS = 4096;
+
+    //! Fields decoded when reading a chunk, see region_file_reader::readChunk
+    enum Field : uint32_t {
+        BLOCKS = 1,
+        BIOMES = 2,
+    };
+
+    class const_iterator {
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = BlockView;
+        using difference_type = std::ptrdiff_t;
+        using pointer = void;
+        using reference = BlockView;
+
+        const_iterator(Chunk const* chunk, size_t section, int32_t index)
+            : m_Chunk(chunk), m_Section(section), m_Index(index) {
+            skipMissing();
+        }
+
+        BlockView operator*() const {
+            return m_Chunk->viewAt(m_Section, m_Index);
+        }
+
+        const_iterator& operator++() {
+            if (++m_Index == SECTION_BLOCKS) {
+                m_Index = 0;
+                ++m_Section;
+                skipMissing();
+            }
+            return *this;
+        }
+
+        const_iterator operator++(int) {
+            const_iterator it = *this;
+            ++*this;
+            return it;
+        }
+
+        bool operator==(const_iterator const& other) const {
+            return m_Section == other.m_Section && m_Index == other.m_Index;
+        }
+
+        bool operator!=(const_iterator const& other) const {
+            return !(*this == other);
+        }
+
+    private:
+        void skipMissing() {
+            while (m_Section < m_Chunk->m_Sections.size() && !m_Chunk->m_Sections[m_Section].present) {
+                ++m_Section;
+            }
+        }
+
+        Chunk const* m_Chunk;
+        size_t m_Section;
+        int32_t m_Index;
+    };
+
     Chunk(std::array<int32_t, 2> chunkPos)
-        : m_ChunkPos(chunkPos) {
+        : m_ChunkPos(chunkPos), m_Origin{chunkPos[0] * 16, chunkPos[1] * 16} {
     }
 
     [[nodiscard]] std::array<int32_t, 2> const& getPos() const {
         return m_ChunkPos;
     }
 
-    void addBlock(Block& block) {
-        auto val = block.getPos();
-        m_Chunks[val] = block;
+    /*!
+     * World x, z block coordinate of the chunk's first block
+     */
+    [[nodiscard]] std::array<int32_t, 2> const& getOrigin() const {
+        return m_Origin;
+    }
+
+    void setOrigin(std::array<int32_t, 2> const& origin) {
+        m_Origin = origin;
+    }
+
+    /*!
+     * Sets a single block (world coordinate), the section is created filled with air if missing. Names
+     * without a namespace, as returned by getBlock, are taken as "minecraft:" blocks.
+     */
+    void addBlock(Block& block);
+
+    /*!
+     * Copies a decoded section into the chunk, remapping its palette into the chunk palette
+     */
+    void addSection(chunk_section const& section);
+
+    [[nodiscard]] const_iterator begin() const {
+        return const_iterator(this, 0, 0);
+    }
+
+    [[nodiscard]] const_iterator end() const {
+        return const_iterator(this, m_Sections.size(), 0);
+    }
+
+    //! Decoded biomes, empty unless read with Chunk::BIOMES
+    [[nodiscard]] biome_grid const& getBiomes() const {
+        return m_Biomes;
     }
 
-    [[nodiscard]] std::map<std::array<int32_t, 3>, Block> const& getBlocks() const {
-        return m_Chunks;
+    void setBiomes(biome_grid biomes) {
+        m_Biomes = std::move(biomes);
+    }
+
+    /*!
+     * Returns the biome id (see biome_registry) at chunk-local x, z (0 - 15) and world y
+     */
+    [[nodiscard]] std::optional<uint32_t> getBiomeIdAt(int32_t localX, int32_t y, int32_t localZ) const;
+
+    /*!
+     * Returns the block at the given world coordinate, names omit the "minecraft:" namespace
+     */
+    [[nodiscard]] std::optional<Block> getBlock(std::array<int32_t, 3> const& coord) const;
+
+    /*!
+     * Every block of the loaded sections by world coordinate, names omit the "minecraft:" namespace.
+     * Kept for compatibility, the map is built on each call: prefer iterating the chunk.
+     */
+    [[nodiscard]] std::map<std::array<int32_t, 3>, Block> getBlocks() const;
+
+    /*!
+     * O(1) lookup by chunk-local x, z (0 - 15) and world y
+     */
+    [[nodiscard]] std::optional<BlockView> getBlockAt(int32_t localX, int32_t y, int32_t localZ) const;
+
+    /*!
+     * Returns the block state id at chunk-local x, z (0 - 15) and world y
+     */
+    [[nodiscard]] std::optional<uint32_t> getBlockIdAt(int32_t localX, int32_t y, int32_t localZ) const;
+
+    //! Block state ids referenced by the section indices
+    [[nodiscard]] std::vector<uint32_t> const& getPalette() const {
+        return m_Palette;
     }
 
-    [[nodiscard]] std::optional<Block> getBlock(std::array<int32_t, 3> const& coord) const {
-        auto it = m_Chunks.find(coord);
-        if (it == m_Chunks.end()) {
-            return {};
+    /*!
+     * Returns the chunk palette index of a block, or -1 if the section is not loaded
+     */
+    [[nodiscard]] int32_t getPaletteIndexAt(int32_t localX, int32_t y, int32_t localZ) const;
+
+    //! Number of blocks held by loaded sections
+    [[nodiscard]] size_t size() const;
+
+    /*!
+     * Appends the loaded sections to out. Palette entries are written as block names and properties since
+     * block state ids are process-local, integers are in native byte order. See readSections
+     */
+    void writeSections(std::vector<char>& out) const;
+
+    /*!
+     * Replaces the palette, sections and origin with data written by writeSections, biomes are kept.
+     * Returns false, leaving the chunk untouched, if the data is malformed.
+     */
+    bool readSections(char const* data, size_t size);
+
+    /*!
+     * Calls visit(sectionY, indices, uniform) for every loaded section, bottom to top. Indices are chunk
+     * palette indices ordered (y * 16 + z) * 16 + x, or nullptr when every block is the uniform index.
+     */
+    template<class Visitor>
+    void visitSections(Visitor&& visit) const {
+        for (size_t i = 0; i < m_Sections.size(); ++i) {
+            Section const& section = m_Sections[i];
+            if (section.present) {
+                visit(m_MinSection + static_cast<int32_t>(i), section.indices.empty() ? nullptr : section.indices.data(),
+                      section.uniform);
+            }
         }
-        return it->second;
     }
 
 private:
+    struct Section {
+        bool present = false;
+        uint16_t uniform = 0;  // palette index of every block while indices is empty
+        std::vector<uint16_t> indices;
+    };
+
+    uint16_t paletteIndexOf(uint32_t id);
+
+    Section& createSection(int32_t sectionY);
+
+    Section const* sectionAt(int32_t sectionY) const;
+
+    BlockView viewAt(size_t section, int32_t index) const;
+
     std::array<int32_t, 2> m_ChunkPos;
-    std::map<std::array<int32_t, 3>, Block> m_Chunks;
-};
+    std::array<int32_t, 2> m_Origin;
+
+    std::vector<uint32_t> m_Palette;
 
+    // Indexed by section y - m_MinSection
+    std::vector<Section> m_Sections;
+    int32_t m_MinSection = 0;
+
+    biome_grid m_Biomes;
+};
@@ -1,10 +1,12 @@
 #pragma once
 
+#include <list>
 #include <map>
 #include "Block.h"
 #include "ChunkRegistry.h"
 #include "Chunk.h"
 #include "region_file_reader.h"
+#include "shared_chunk_cache.h"
 
 /*!
  * The chunk registry contains a small subset of relevant blocks, but one should not expect it to be complete.
@@ -13,7 +15,18 @@
 class ChunkRegistry {
 
 public:
-    ChunkRegistry(std::string const pathToRegionFolder);
+    //! Cache counters, see getStats
+    struct Stats {
+        size_t hotHits = 0;
+        size_t warmHits = 0;
+        size_t sharedHits = 0;
+        size_t misses = 0;
+    };
+
+    /*!
+     * Chunks are read in decode-and-drop mode, only the given fields (see Chunk::Field) are kept
+     */
+    ChunkRegistry(std::string const pathToRegionFolder, uint32_t fields = Chunk::BLOCKS);
 
     ChunkRegistry(ChunkRegistry const &) = delete;
 
@@ -23,10 +36,79 @@ public:
 
     std::shared_ptr<Chunk> getChunk(int32_t x, int32_t z);
 
+    /*!
+     * Non-throwing getChunk: empty, corrupt and unsupported chunks are reported through the status
+     * and leave chunk untouched. Only a missing or unreadable region file throws.
+     */
+    chunk_status::STATUS tryGetChunk(int32_t x, int32_t z, std::shared_ptr<Chunk> &chunk);
+
     [[nodiscard]]  std::optional<Block> getBlock(std::array<int32_t, 3> const &coord) const;
 
+    /*!
+     * Bounds the cache to hotChunks decoded chunks (0 for no limit). The least recently used decoded chunk
+     * is demoted to a warm tier holding its original zlib bytes (0 warmBytes disables the tier). warmBytes
+     * bounds every zlib byte kept, the copies hot chunks hold for demotion included. Warm chunks are decoded
+     * from memory on access and promoted back to the hot tier.
+     */
+    void setCacheLimits(size_t hotChunks, size_t warmBytes);
+
+    /*!
+     * Shares decoded chunks with other processes through cache, keyed by dimension and the chunk's header
+     * timestamp. Chunks missing from both tiers are looked up in the shared cache before being read from
+     * disk, and published there once decoded. Only used when reading Chunk::BLOCKS alone.
+     */
+    void setSharedCache(std::shared_ptr<shared_chunk_cache> cache, int32_t dimension);
+
+    [[nodiscard]] Stats const& getStats() const {
+        return m_Stats;
+    }
+
+    //! Compressed bytes held by the warm tier
+    [[nodiscard]] size_t getWarmBytes() const {
+        return m_WarmBytes;
+    }
+
+    //! Compressed bytes held by both tiers, at most the warmBytes limit
+    [[nodiscard]] size_t getCompressedBytes() const {
+        return m_WarmBytes + m_HotBytes;
+    }
+
 private:
+    using ChunkPos = std::array<int32_t, 2>;
+
+    struct HotChunk {
+        std::shared_ptr<Chunk> chunk;
+        std::vector<char> compressed;  // kept for demotion within the byte budget, empty without a warm tier
+        std::list<ChunkPos>::iterator lru;
+    };
+
+    struct WarmChunk {
+        std::vector<char> compressed;
+        std::list<ChunkPos>::iterator lru;
+    };
+
+    //! Adds a decoded chunk to the hot tier, compressed is dropped without a warm tier
+    void addHot(ChunkPos const& pos, std::shared_ptr<Chunk> const& chunk, std::vector<char> compressed);
+
+    //! Demotes least recently used hot chunks past the hot limit, then trims compressed bytes to the byte limit
+    void trim();
+
     std::string m_PathToRegionFolder;
 
-    std::map<std::array<int32_t, 2>, std::shared_ptr<Chunk>> loadedChunks;
+    uint32_t m_Fields;
+
+    // Most recently used first
+    std::map<ChunkPos, HotChunk> loadedChunks;
+    std::list<ChunkPos> m_HotOrder;
+    std::map<ChunkPos, WarmChunk> m_WarmChunks;
+    std::list<ChunkPos> m_WarmOrder;
+
+    size_t m_HotLimit = 0;
+    size_t m_WarmLimit = 0;
+    size_t m_WarmBytes = 0;
+    size_t m_HotBytes = 0;  // compressed copies held by hot chunks
+    Stats m_Stats;
+
+    std::shared_ptr<shared_chunk_cache> m_SharedCache;
+    int32_t m_Dimension = 0;
 };
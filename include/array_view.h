@@ -0,0 +1,117 @@
+/*
+ * array_view.h
+ * Copyright (C) 2012 - 2019 David Jolly
+ * ----------------------
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef ARRAY_VIEW_H_
+#define ARRAY_VIEW_H_
+
+#include <cstddef>
+#include <stdexcept>
+#include <vector>
+
+/*
+ * Non-owning view of a contiguous array (std::span stand-in for C++17)
+ */
+template<class T>
+class array_view {
+private:
+
+    /*
+     * Viewed elements
+     */
+    T* ptr;
+
+    /*
+     * Number of viewed elements
+     */
+    size_t len;
+
+public:
+
+    /*
+     * Array view constructor
+     */
+    array_view(void) : ptr(NULL), len(0) { return; }
+
+    /*
+     * Array view constructor
+     */
+    array_view(T* ptr, size_t len) : ptr(ptr), len(len) { return; }
+
+    /*
+     * Array view constructor
+     */
+    template<class U>
+    array_view(std::vector<U>& vec) : ptr(vec.data()), len(vec.size()) { return; }
+
+    /*
+     * Array view constructor
+     */
+    template<class U>
+    array_view(const std::vector<U>& vec) : ptr(vec.data()), len(vec.size()) { return; }
+
+    /*
+     * Returns the element at a given index
+     */
+    T& operator[](size_t index) const { return ptr[index]; }
+
+    /*
+     * Returns the element at a given index (bounds checked)
+     */
+    T& at(size_t index) const {
+        if (index >= len)
+            throw std::out_of_range("index out-of-range");
+        return ptr[index];
+    }
+
+    /*
+     * Returns an iterator to the first element
+     */
+    T* begin(void) const { return ptr; }
+
+    /*
+     * Returns the viewed elements
+     */
+    T* data(void) const { return ptr; }
+
+    /*
+     * Returns the view's empty status
+     */
+    bool empty(void) const { return !len; }
+
+    /*
+     * Returns an iterator past the last element
+     */
+    T* end(void) const { return ptr + len; }
+
+    /*
+     * Returns the number of viewed elements
+     */
+    size_t size(void) const { return len; }
+
+    /*
+     * Returns a view of count elements starting at offset
+     */
+    array_view sub_view(size_t offset, size_t count) const {
+        if (offset > len || count > len - offset)
+            throw std::out_of_range("index out-of-range");
+        return array_view(ptr + offset, count);
+    }
+};
+
+#endif // ARRAY_VIEW_H_
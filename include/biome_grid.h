@@ -0,0 +1,139 @@
+/*
+ * biome_grid.h
+ * Copyright (C) 2012 - 2019 David Jolly
+ * ----------------------
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef BIOME_GRID_H_
+#define BIOME_GRID_H_
+
+#include <cstdint>
+#include <vector>
+#include "biome_registry.h"
+#include "tag/compound_tag.h"
+
+/*
+ * Declared here, Chunk (included by region_file_reader.h) holds a biome_grid
+ */
+class region_file_reader;
+
+/*
+ * A chunk's biomes decoded into a grid of cells holding palette indices.
+ * Every layout is supported: per column byte or int arrays (pre-1.15), 4x4x4
+ * cell int arrays (1.15 - 1.17) and per section biomes{palette,data} (1.18+).
+ * Palette entries are biome_registry ids.
+ */
+class biome_grid {
+private:
+
+    /*
+     * Palette index of every cell, ordered (layer * width + z) * width + x
+     */
+    std::vector<uint8_t> cells;
+
+    /*
+     * Biome ids (see biome_registry) referenced by cells
+     */
+    std::vector<uint32_t> palette;
+
+    /*
+     * Cell width in blocks, as a shift (0 for per column biomes, 2 for 4x4x4 cells)
+     */
+    unsigned int shift;
+
+    /*
+     * Number of cell layers (1 for per column biomes)
+     */
+    unsigned int layers;
+
+    /*
+     * World y of the lowest cell layer
+     */
+    int min_y;
+
+    /*
+     * Returns the palette index of a biome id, adding it if needed
+     */
+    uint8_t get_palette_index(uint32_t id);
+
+    /*
+     * Size the grid for a given cell shift, layer count and lowest y, cells start out as NONE
+     */
+    void resize(unsigned int shift, unsigned int layers, int min_y);
+
+public:
+
+    /*
+     * Biome grid constructor
+     */
+    biome_grid(void) : shift(0), layers(0), min_y(0) { return; }
+
+    /*
+     * Returns the biome id at a given x, z coord (relative to the chunk) and world y. Heights
+     * outside the grid are clamped to its lowest and highest layers. Returns NONE if empty.
+     */
+    uint32_t biome_at(unsigned int x, int y, unsigned int z) const {
+        if (cells.empty())
+            return biome_registry::NONE;
+        int layer = (layers > 1) ? (y - min_y) >> 2 : 0;
+        layer = layer < 0 ? 0 : (layer >= static_cast<int>(layers) ? static_cast<int>(layers) - 1 : layer);
+        unsigned int width = 16 >> shift;
+        return palette[cells[(layer * width + (z >> shift)) * width + (x >> shift)]];
+    }
+
+    /*
+     * Decode the biomes of a chunk's root compound. Returns false if it holds none.
+     */
+    bool decode(compound_tag& root);
+
+    /*
+     * Decode the biomes of a region's chunk at a given x, z coord. Returns false if the chunk is
+     * empty or holds no biomes. Chunk tags read by the call are dropped afterwards.
+     */
+    bool decode(region_file_reader& reader, unsigned int x, unsigned int z);
+
+    /*
+     * Return every cell's palette index, ordered (layer * width + z) * width + x
+     */
+    const std::vector<uint8_t>& get_cells(void) const { return cells; }
+
+    /*
+     * Return the number of cell layers (1 for per column biomes)
+     */
+    unsigned int get_layers(void) const { return layers; }
+
+    /*
+     * Return the world y of the lowest cell layer
+     */
+    int get_min_y(void) const { return min_y; }
+
+    /*
+     * Return the grid's palette (biome ids)
+     */
+    const std::vector<uint32_t>& get_palette(void) const { return palette; }
+
+    /*
+     * Return the cell width in blocks, as a shift (0 for per column biomes, 2 for 4x4x4 cells)
+     */
+    unsigned int get_shift(void) const { return shift; }
+
+    /*
+     * Return every cell's biome id, ordered like get_cells
+     */
+    std::vector<uint32_t> to_ids(void) const;
+};
+
+#endif // BIOME_GRID_H_
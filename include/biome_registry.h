@@ -0,0 +1,117 @@
+/*
+ * biome_registry.h
+ * Copyright (C) 2012 - 2019 David Jolly
+ * ----------------------
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef BIOME_REGISTRY_H_
+#define BIOME_REGISTRY_H_
+
+#include <cstdint>
+#include <deque>
+#include <shared_mutex>
+#include <string>
+#include <unordered_map>
+
+/*
+ * Process-wide biome registry, mapping namespaced biome names to dense ids.
+ * Numeric biome ids of pre-1.18 chunks are mapped to their names, so every
+ * layout shares one id space. Thread-safe.
+ */
+class biome_registry {
+public:
+
+    /*
+     * Id of cells without biome data, registered first (empty name)
+     */
+    static const uint32_t NONE = 0;
+
+private:
+
+    /*
+     * Registered names, indexed by id (deque keeps references stable)
+     */
+    std::deque<std::string> names;
+
+    /*
+     * Name to id
+     */
+    std::unordered_map<std::string, uint32_t> ids;
+
+    /*
+     * Ids of numeric biome ids, UINT32_MAX until first use
+     */
+    uint32_t legacy_ids[256];
+
+    /*
+     * Guards names, ids and legacy_ids
+     */
+    mutable std::shared_mutex mutex;
+
+    /*
+     * Biome registry constructor
+     */
+    biome_registry(void);
+
+    /*
+     * Returns the id of a biome name, the exclusive lock must be held
+     */
+    uint32_t get_id_locked(const std::string& name);
+
+public:
+
+    /*
+     * Biome registry constructor
+     */
+    biome_registry(const biome_registry& other) = delete;
+
+    /*
+     * Biome registry assignment operator
+     */
+    biome_registry& operator=(const biome_registry& other) = delete;
+
+    /*
+     * Returns the process-wide registry
+     */
+    static biome_registry& get_instance(void);
+
+    /*
+     * Returns the id of a namespaced biome name, registering it if needed
+     */
+    uint32_t get_id(const std::string& name);
+
+    /*
+     * Returns the id of a numeric (pre-1.18) biome id, registering it if needed
+     */
+    uint32_t get_legacy_id(int legacy);
+
+    /*
+     * Returns the namespaced name of a numeric (pre-1.18) biome id (minecraft:unknown_<id> if unknown)
+     */
+    static std::string get_legacy_name(int legacy);
+
+    /*
+     * Returns the namespaced name of an id
+     */
+    const std::string& get_name(uint32_t id) const;
+
+    /*
+     * Returns the number of registered biomes
+     */
+    size_t size(void) const;
+};
+
+#endif // BIOME_REGISTRY_H_
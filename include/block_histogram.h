@@ -0,0 +1,150 @@
+/*
+ * block_histogram.h
+ * Copyright (C) 2012 - 2019 David Jolly
+ * ----------------------
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef BLOCK_HISTOGRAM_H_
+#define BLOCK_HISTOGRAM_H_
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+#include "Chunk.h"
+#include "chunk_section.h"
+#include "parallel.h"
+#include "region_file_reader.h"
+
+/*
+ * Block state counts (by block_registry id), optionally per world y. Sections
+ * are counted on their palette indices and mapped through the palette, single
+ * entry sections count in O(1). Histograms merge across threads and regions,
+ * region counts skip corrupt and unsupported chunks and report them to an
+ * optional callback instead of throwing.
+ */
+class block_histogram {
+private:
+
+    /*
+     * Count per layer
+     */
+    bool per_y;
+
+    /*
+     * Counts indexed by block state id
+     */
+    std::vector<uint64_t> counts;
+
+    /*
+     * Counts per world y, indexed by block state id (per_y only)
+     */
+    std::map<int32_t, std::vector<uint64_t>> layers;
+
+    /*
+     * Palette index counts of the section being added
+     */
+    std::vector<uint32_t> tally;
+
+    /*
+     * Add count blocks of a given id to a count vector
+     */
+    static void add_to(std::vector<uint64_t>& dest, uint32_t id, uint64_t count);
+
+    /*
+     * Count palette indices and add them through the palette, optionally to a layer
+     */
+    void add_indices(const uint16_t* indices, unsigned int count, const uint32_t* palette, unsigned int palette_size, int32_t y);
+
+public:
+
+    /*
+     * Block histogram constructor
+     */
+    block_histogram(bool per_y = false) : per_y(per_y) { return; }
+
+    /*
+     * Add count blocks of a given id at a given world y (ignored unless per_y)
+     */
+    void add(uint32_t id, int32_t y, uint64_t count);
+
+    /*
+     * Add every block of a loaded chunk
+     */
+    void add_chunk(const Chunk& chunk);
+
+    /*
+     * Add every block of a region's chunk at a given x, z coord
+     */
+    void add_chunk(region_file_reader& reader, unsigned int x, unsigned int z);
+
+    /*
+     * Add every block of a decoded section
+     */
+    void add_section(const chunk_section& section);
+
+    /*
+     * Returns the count of a given id
+     */
+    uint64_t get_count(uint32_t id) const { return id < counts.size() ? counts[id] : 0; }
+
+    /*
+     * Returns the count of a given id at a given world y (per_y only)
+     */
+    uint64_t get_count(uint32_t id, int32_t y) const;
+
+    /*
+     * Returns every non-zero (id, count) pair, ordered by id
+     */
+    std::vector<std::pair<uint32_t, uint64_t>> get_counts(void) const;
+
+    /*
+     * Returns the counts per world y, indexed by block state id (per_y only)
+     */
+    const std::map<int32_t, std::vector<uint64_t>>& get_layers(void) const { return layers; }
+
+    /*
+     * Returns the total number of counted blocks
+     */
+    uint64_t get_total(void) const;
+
+    /*
+     * Returns true if counts are kept per world y
+     */
+    bool is_per_y(void) const { return per_y; }
+
+    /*
+     * Add another histogram's counts
+     */
+    void merge(const block_histogram& other);
+
+    /*
+     * Count every chunk of region files, in parallel across chunks and regions
+     * (thread_count 0 for one thread per core). Corrupt and unsupported chunks are skipped
+     * and passed to skipped, if set, concurrently from worker threads.
+     */
+    static block_histogram of_regions(const std::vector<std::string>& paths, bool per_y = false, unsigned int thread_count = 0,
+        const parallel::skip_work& skipped = nullptr);
+
+    /*
+     * Non-throwing add_chunk: empty, corrupt and unsupported chunks are reported through the status.
+     * A corrupt chunk keeps the sections counted before the error was found.
+     */
+    chunk_status::STATUS try_add_chunk(region_file_reader& reader, unsigned int x, unsigned int z);
+};
+
+#endif // BLOCK_HISTOGRAM_H_
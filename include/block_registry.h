@@ -0,0 +1,167 @@
+/*
+ * block_registry.h
+ * Copyright (C) 2012 - 2019 David Jolly
+ * ----------------------
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef BLOCK_REGISTRY_H_
+#define BLOCK_REGISTRY_H_
+
+#include <cstdint>
+#include <deque>
+#include <shared_mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "block_state.h"
+#include "tag/compound_tag.h"
+
+/*
+ * Process-wide block state registry, mapping Name + Properties to dense ids.
+ * States are hash-consed into block_state objects as palettes are decoded and
+ * are never removed, so ids and references to states stay valid. Property keys
+ * are interned to small integers for fast lookup. Thread-safe.
+ */
+class block_registry {
+public:
+
+    /*
+     * Block state property list, sorted by key name
+     */
+    typedef block_state::property_list property_list;
+
+    /*
+     * Id of minecraft:air, registered first
+     */
+    static const uint32_t AIR = 0;
+
+    /*
+     * Returned by find_key for unknown keys
+     */
+    static const block_state::key_type NO_KEY = UINT32_MAX;
+
+private:
+
+    /*
+     * Registered states, indexed by id (deque keeps references stable)
+     */
+    std::deque<block_state> states;
+
+    /*
+     * Canonical state string to id
+     */
+    std::unordered_map<std::string, uint32_t> ids;
+
+    /*
+     * Interned property key names, indexed by key
+     */
+    std::deque<std::string> key_names;
+
+    /*
+     * Property key name to key
+     */
+    std::unordered_map<std::string, block_state::key_type> keys;
+
+    /*
+     * Guards states, ids, key_names and keys
+     */
+    mutable std::shared_mutex mutex;
+
+    /*
+     * Block registry constructor
+     */
+    block_registry(void);
+
+    /*
+     * Intern a property key, the exclusive lock must be held
+     */
+    block_state::key_type intern_key_locked(const std::string& key);
+
+public:
+
+    /*
+     * Block registry constructor
+     */
+    block_registry(const block_registry& other) = delete;
+
+    /*
+     * Block registry assignment operator
+     */
+    block_registry& operator=(const block_registry& other) = delete;
+
+    /*
+     * Returns the process-wide registry
+     */
+    static block_registry& get_instance(void);
+
+    /*
+     * Returns the canonical state string of a name and (sorted) properties
+     */
+    static std::string get_state_string(const std::string& name, const property_list& properties);
+
+    /*
+     * Returns the key of a property name, or NO_KEY if it was never interned
+     */
+    block_state::key_type find_key(const std::string& key) const;
+
+    /*
+     * Returns the id of a block state, registering it if needed
+     */
+    uint32_t get_id(const std::string& name, property_list properties = property_list());
+
+    /*
+     * Returns the id of a palette entry compound (Name, Properties), registering it if needed
+     */
+    uint32_t get_id(compound_tag* palette_entry);
+
+    /*
+     * Returns the name of an interned property key
+     */
+    const std::string& get_key_name(block_state::key_type key) const;
+
+    /*
+     * Returns the namespaced block name of an id
+     */
+    const std::string& get_name(uint32_t id) const { return get_state(id).get_name(); }
+
+    /*
+     * Returns the properties of an id, sorted by key name
+     */
+    const property_list& get_properties(uint32_t id) const { return get_state(id).get_properties(); }
+
+    /*
+     * Returns the block state of an id
+     */
+    const block_state& get_state(uint32_t id) const;
+
+    /*
+     * Intern a property key
+     */
+    block_state::key_type intern_key(const std::string& key);
+
+    /*
+     * Returns true if an id is one of the air blocks (air, cave_air, void_air)
+     */
+    bool is_air(uint32_t id) const { return get_state(id).is_air(); }
+
+    /*
+     * Returns the number of registered states
+     */
+    size_t size(void) const;
+};
+
+#endif // BLOCK_REGISTRY_H_
@@ -0,0 +1,92 @@
+/*
+ * block_search.h
+ * Copyright (C) 2012 - 2019 David Jolly
+ * ----------------------
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef BLOCK_SEARCH_H_
+#define BLOCK_SEARCH_H_
+
+#include <array>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "chunk_format.h"
+#include "parallel.h"
+#include "region_file_reader.h"
+
+/*
+ * Palette-driven block search. A section's palette is checked for the target
+ * block names first; sections without them are skipped without unpacking their
+ * block states, the others are scanned for the matching indices only. Region
+ * searches skip corrupt and unsupported chunks and report them to an optional
+ * callback instead of throwing.
+ */
+class block_search {
+public:
+
+    /*
+     * Matching block
+     */
+    struct match {
+
+        /*
+         * World x, y, z coord
+         */
+        std::array<int32_t, 3> pos;
+
+        /*
+         * Block state id (see block_registry)
+         */
+        uint32_t id;
+    };
+
+    /*
+     * Find blocks with one of the given names in a section compound. Chunk x, z are in chunks.
+     */
+    static void find_in_section(compound_tag* section, chunk_format::GENERATION generation, int chunk_x, int chunk_z,
+        const std::vector<std::string>& names, std::vector<match>& matches);
+
+    /*
+     * Find blocks with one of the given names in a region's chunk at a given x, z coord
+     */
+    static void find_in_chunk(region_file_reader& reader, unsigned int x, unsigned int z, const std::vector<std::string>& names,
+        std::vector<match>& matches);
+
+    /*
+     * Find blocks with one of the given names in every chunk of a region. Corrupt and unsupported
+     * chunks are skipped and passed to skipped, if set.
+     */
+    static std::vector<match> find_in_region(region_file_reader& reader, const std::vector<std::string>& names,
+        const parallel::skip_work& skipped = nullptr);
+
+    /*
+     * Find blocks with one of the given names in region files, in parallel across chunks and regions
+     * (thread_count 0 for one thread per core). Matches are ordered by region, then chunk. Corrupt and
+     * unsupported chunks are skipped and passed to skipped, if set, concurrently from worker threads.
+     */
+    static std::vector<match> find_in_regions(const std::vector<std::string>& paths, const std::vector<std::string>& names,
+        unsigned int thread_count = 0, const parallel::skip_work& skipped = nullptr);
+
+    /*
+     * Non-throwing find_in_chunk: empty, corrupt and unsupported chunks are reported through the status.
+     * Matches of a corrupt chunk are dropped.
+     */
+    static chunk_status::STATUS try_find_in_chunk(region_file_reader& reader, unsigned int x, unsigned int z,
+        const std::vector<std::string>& names, std::vector<match>& matches);
+};
+
+#endif // BLOCK_SEARCH_H_
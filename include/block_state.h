@@ -0,0 +1,151 @@
+/*
+ * block_state.h
+ * Copyright (C) 2012 - 2019 David Jolly
+ * ----------------------
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef BLOCK_STATE_H_
+#define BLOCK_STATE_H_
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+/*
+ * Canonical block state (name and properties). Instances are hash-consed by
+ * block_registry, so equal states share one object and compare by address or id.
+ */
+class block_state {
+public:
+
+    /*
+     * Interned property key
+     */
+    typedef uint32_t key_type;
+
+    /*
+     * Block state property list, sorted by key name
+     */
+    typedef std::vector<std::pair<std::string, std::string>> property_list;
+
+private:
+
+    /*
+     * Block state id
+     */
+    uint32_t id;
+
+    /*
+     * Namespaced block name
+     */
+    std::string name;
+
+    /*
+     * Properties, sorted by key name
+     */
+    property_list properties;
+
+    /*
+     * Interned key of every property, in properties order
+     */
+    std::vector<key_type> keys;
+
+    /*
+     * Canonical state string, e.g. minecraft:oak_stairs[facing=north,half=bottom]
+     */
+    std::string state;
+
+    /*
+     * True for air, cave_air and void_air
+     */
+    bool air;
+
+public:
+
+    /*
+     * Block state constructor
+     */
+    block_state(uint32_t id, const std::string& name, property_list&& properties, std::vector<key_type>&& keys,
+            std::string&& state) : id(id), name(name), properties(std::move(properties)), keys(std::move(keys)),
+            state(std::move(state)), air(is_air_name(name)) { return; }
+
+    /*
+     * Block state equals operator
+     */
+    bool operator==(const block_state& other) const { return id == other.id; }
+
+    /*
+     * Block state not-equals operator
+     */
+    bool operator!=(const block_state& other) const { return id != other.id; }
+
+    /*
+     * Return a block state's id
+     */
+    uint32_t get_id(void) const { return id; }
+
+    /*
+     * Return a block state's namespaced name
+     */
+    const std::string& get_name(void) const { return name; }
+
+    /*
+     * Return a block state's properties, sorted by key name
+     */
+    const property_list& get_properties(void) const { return properties; }
+
+    /*
+     * Returns the value of a property. Returns NULL if not found.
+     */
+    const std::string* get_property(key_type key) const {
+        for (size_t i = 0; i < keys.size(); ++i) {
+            if (keys[i] == key)
+                return &properties[i].second;
+        }
+        return NULL;
+    }
+
+    /*
+     * Returns the value of a property. Returns NULL if not found.
+     */
+    const std::string* get_property(const std::string& key) const;
+
+    /*
+     * Returns true if a namespaced block name is one of the air blocks (air, cave_air, void_air)
+     */
+    static bool is_air_name(std::string_view name) {
+        return name == "minecraft:air" || name == "minecraft:cave_air" || name == "minecraft:void_air";
+    }
+
+    /*
+     * Returns true if the block state is one of the air blocks
+     */
+    bool is_air(void) const { return air; }
+
+    /*
+     * Returns true if the block state has a given property
+     */
+    bool has_property(key_type key) const { return get_property(key) != NULL; }
+
+    /*
+     * Return a block state's canonical string
+     */
+    const std::string& to_string(void) const { return state; }
+};
+
+#endif // BLOCK_STATE_H_
@@ -0,0 +1,161 @@
+/*
+ * box_query.h
+ * Copyright (C) 2012 - 2019 David Jolly
+ * ----------------------
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef BOX_QUERY_H_
+#define BOX_QUERY_H_
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+#include "block_search.h"
+#include "chunk_section.h"
+#include "parallel.h"
+#include "region_dim.h"
+
+/*
+ * World-space bounding box query over a folder of region files. The box is split
+ * into the regions, chunks and sections it intersects (rounding towards negative
+ * infinity), chunks are processed in parallel and only sections overlapping the
+ * box are decoded. Corrupt and unsupported chunks are skipped and reported to an
+ * optional callback instead of throwing; sections of a corrupt chunk decoded before
+ * the error was found are still visited.
+ */
+class box_query {
+public:
+
+    /*
+     * Section visitor, called with a decoded section, its chunk x, z coord (in chunks) and
+     * the worker thread index. Called concurrently from worker threads.
+     */
+    typedef std::function<void(const chunk_section&, int, int, unsigned int)> section_visitor;
+
+private:
+
+    /*
+     * Section visitor, also called with the index of the section's chunk in the query plan
+     */
+    typedef std::function<void(const chunk_section&, int, int, size_t, unsigned int)> item_visitor;
+
+    /*
+     * Region folder
+     */
+    std::string folder;
+
+    /*
+     * Lowest world x, y, z coord (inclusive)
+     */
+    std::array<int32_t, 3> min;
+
+    /*
+     * Highest world x, y, z coord (inclusive)
+     */
+    std::array<int32_t, 3> max;
+
+    /*
+     * Call visit for every section of the planned chunks overlapping the box, along with the index
+     * of its chunk in the plan. Corrupt and unsupported chunks are passed to skipped, if set.
+     */
+    void for_each_section(const std::vector<std::string>& paths, const std::vector<parallel::chunk_item>& chunks,
+        const item_visitor& visit, unsigned int thread_count, const parallel::skip_work& skipped) const;
+
+    /*
+     * Collect the existing region files and the chunks intersecting the box, grouped by region
+     */
+    void plan(std::vector<std::string>& paths, std::vector<parallel::chunk_item>& chunks) const;
+
+public:
+
+    /*
+     * Box query constructor. Corners are inclusive world coords, in any order.
+     */
+    box_query(const std::string& folder, const std::array<int32_t, 3>& from, const std::array<int32_t, 3>& to);
+
+    /*
+     * Returns true if a given world x, y, z coord lies in the box
+     */
+    bool contains(int32_t x, int32_t y, int32_t z) const {
+        return x >= min[0] && x <= max[0] && y >= min[1] && y <= max[1] && z >= min[2] && z <= max[2];
+    }
+
+    /*
+     * Returns every block in the box, in parallel (thread_count 0 for one thread per core).
+     * Blocks are ordered by region, then chunk, then section. Corrupt and unsupported chunks
+     * are skipped and passed to skipped, if set, concurrently from worker threads.
+     */
+    std::vector<block_search::match> get_blocks(unsigned int thread_count = 0, const parallel::skip_work& skipped = nullptr) const;
+
+    /*
+     * Return the box's highest world x, y, z coord (inclusive)
+     */
+    const std::array<int32_t, 3>& get_max(void) const { return max; }
+
+    /*
+     * Return the box's lowest world x, y, z coord (inclusive)
+     */
+    const std::array<int32_t, 3>& get_min(void) const { return min; }
+
+    /*
+     * Returns the path of the region file at a given region x, z coord
+     */
+    static std::string get_region_path(const std::string& folder, int region_x, int region_z);
+
+    /*
+     * Call visit(x, y, z, id, thread) for every block in the box, in parallel (thread_count 0 for
+     * one thread per core). Blocks are streamed as sections are decoded, visit is called
+     * concurrently from worker threads and may use the thread index for per-thread state.
+     * Corrupt and unsupported chunks are skipped and passed to skipped, if set.
+     */
+    template<class Visitor>
+    void visit_blocks(Visitor&& visit, unsigned int thread_count = 0, const parallel::skip_work& skipped = nullptr) const {
+        visit_sections([&](const chunk_section& section, int chunk_x, int chunk_z, unsigned int thread) {
+            int32_t base_x = chunk_x * static_cast<int32_t>(region_dim::BLOCK_WIDTH),
+                base_y = section.get_y() * static_cast<int32_t>(region_dim::BLOCK_WIDTH),
+                base_z = chunk_z * static_cast<int32_t>(region_dim::BLOCK_WIDTH);
+
+            // clip the box to the section
+            int32_t lower_x = std::max(min[0], base_x) - base_x, upper_x = std::min(max[0], base_x + 15) - base_x,
+                lower_y = std::max(min[1], base_y) - base_y, upper_y = std::min(max[1], base_y + 15) - base_y,
+                lower_z = std::max(min[2], base_z) - base_z, upper_z = std::min(max[2], base_z + 15) - base_z;
+            const uint16_t* indices = section.get_indices();
+            const uint32_t* palette = section.get_palette().data();
+            for (int32_t y = lower_y; y <= upper_y; ++y) {
+                for (int32_t z = lower_z; z <= upper_z; ++z) {
+                    const uint16_t* row = indices + chunk_section::get_index(0, y, z);
+                    for (int32_t x = lower_x; x <= upper_x; ++x) {
+                        visit(base_x + x, base_y + y, base_z + z, palette[row[x]], thread);
+                    }
+                }
+            }
+        }, thread_count, skipped);
+    }
+
+    /*
+     * Call visit for every section overlapping the box, in parallel (thread_count 0 for one
+     * thread per core). Sections outside the box's y range are skipped before decoding.
+     * Corrupt and unsupported chunks are skipped and passed to skipped, if set, concurrently
+     * from worker threads.
+     */
+    void visit_sections(const section_visitor& visit, unsigned int thread_count = 0,
+        const parallel::skip_work& skipped = nullptr) const;
+};
+
+#endif // BOX_QUERY_H_
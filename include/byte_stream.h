@@ -177,6 +177,11 @@ public:
      */
     byte_stream(std::vector<char>& buff);
 
+    /*
+     * Byte stream constructor (takes ownership of buff)
+     */
+    byte_stream(std::vector<char>&& buff);
+
     /*
      * Byte stream destructor
      */
@@ -0,0 +1,99 @@
+/*
+ * chunk_format.h
+ * Copyright (C) 2012 - 2019 David Jolly
+ * ----------------------
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef CHUNK_FORMAT_H_
+#define CHUNK_FORMAT_H_
+
+#include "tag/compound_tag.h"
+#include "tag/list_tag.h"
+#include "tag/long_array_tag.h"
+
+/*
+ * Chunk NBT layout, selected from a chunk's DataVersion
+ */
+class chunk_format {
+public:
+
+    /*
+     * Supported chunk layouts
+     */
+    enum GENERATION {
+        LEGACY, // numeric Blocks/Data arrays (pre-1.13)
+        FLATTENED, // Level/Sections with Palette/BlockStates, spanning packing (1.13 - 1.15)
+        PADDED, // same tags, padded packing (1.16 - 1.17)
+        ROOT_SECTIONS, // root sections with block_states{palette,data}, negative Y (1.18+)
+    };
+
+    /*
+     * First DataVersion of each layout (17w47a, 20w17a, 21w43a)
+     */
+    static const int FLATTENED_VERSION = 1451;
+    static const int PADDED_VERSION = 2529;
+    static const int ROOT_SECTIONS_VERSION = 2844;
+
+    /*
+     * Bits per packed heightmap value
+     */
+    static const unsigned int HEIGHTMAP_BITS = 9;
+
+    /*
+     * Returns a chunk's DataVersion, or -1 if it has none (pre-1.9)
+     */
+    static int get_data_version(compound_tag& root);
+
+    /*
+     * Returns the layout used by a given DataVersion
+     */
+    static GENERATION get_generation(int data_version);
+
+    /*
+     * Returns a packed heightmap (e.g. WORLD_SURFACE, MOTION_BLOCKING) from a chunk's Heightmaps.
+     * Returns NULL if not found.
+     */
+    static long_array_tag* get_heightmap(compound_tag& root, GENERATION generation, const std::string& name);
+
+    /*
+     * Returns the compound holding a chunk's position and sections (Level, or the root for 1.18+).
+     * Returns NULL if not found.
+     */
+    static compound_tag* get_level(compound_tag& root, GENERATION generation);
+
+    /*
+     * Retrieve the lowest block y of a chunk, heightmap values are relative to it. Returns false
+     * if it cannot be told (1.18+ chunks without yPos).
+     */
+    static bool get_min_y(compound_tag& root, GENERATION generation, int& y);
+
+    /*
+     * Retrieve a chunk's x, z position (in chunks). Returns false if not found.
+     */
+    static bool get_position(compound_tag& root, GENERATION generation, int& x, int& z);
+
+    /*
+     * Retrieve a section's y (in sections). Returns false if it has no Y byte.
+     */
+    static bool get_section_y(compound_tag* section, int& y);
+
+    /*
+     * Returns a chunk's section list. Returns NULL if not found.
+     */
+    static list_tag* get_sections(compound_tag& root, GENERATION generation);
+};
+
+#endif // CHUNK_FORMAT_H_
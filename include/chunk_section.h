@@ -0,0 +1,116 @@
+/*
+ * chunk_section.h
+ * Copyright (C) 2012 - 2019 David Jolly
+ * ----------------------
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef CHUNK_SECTION_H_
+#define CHUNK_SECTION_H_
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "array_view.h"
+#include "chunk_format.h"
+#include "tag/compound_tag.h"
+#include "tag/list_tag.h"
+#include "tag/long_array_tag.h"
+
+/*
+ * A 16x16x16 chunk section decoded into dense palette indices
+ */
+class chunk_section {
+public:
+
+    /*
+     * Number of blocks in a section
+     */
+    static const unsigned int BLOCK_COUNT = 4096;
+
+private:
+
+    /*
+     * Section y coordinate (in sections)
+     */
+    int y;
+
+    /*
+     * Palette index of every block, ordered (y * 16 + z) * 16 + x
+     */
+    uint16_t indices[BLOCK_COUNT];
+
+    /*
+     * Block state ids (see block_registry) referenced by indices
+     */
+    std::vector<uint32_t> palette;
+
+public:
+
+    /*
+     * Chunk section constructor
+     */
+    chunk_section(void) : y(0), indices() { return; }
+
+    /*
+     * Decode a section compound of a given layout in a single pass.
+     * Returns false if the section holds no block data.
+     */
+    static bool decode(compound_tag* section, chunk_format::GENERATION generation, chunk_section& sect);
+
+    /*
+     * Returns the number of bits per block index for a given palette size
+     */
+    static unsigned int get_bits(size_t palette_size);
+
+    /*
+     * Retrieve a section's palette and packed block states for a given layout. States are
+     * NULL when a 1.18+ palette holds a single entry. Returns false if the section holds no block data.
+     */
+    static bool get_block_states(compound_tag* section, chunk_format::GENERATION generation, list_tag*& palette,
+        long_array_tag*& states);
+
+    /*
+     * Return the block index of a given x, y, z coord (relative to the section)
+     */
+    static unsigned int get_index(unsigned int x, unsigned int y, unsigned int z) { return (y * 16 + z) * 16 + x; }
+
+    /*
+     * Return a section's palette indices
+     */
+    const uint16_t* get_indices(void) const { return indices; }
+
+    /*
+     * Return the block state id at a given x, y, z coord (relative to the section)
+     */
+    uint32_t get_id_at(unsigned int x, unsigned int y, unsigned int z) const { return palette[indices[get_index(x, y, z)]]; }
+
+    /*
+     * Return the block name at a given x, y, z coord (relative to the section)
+     */
+    const std::string& get_name_at(unsigned int x, unsigned int y, unsigned int z) const;
+
+    /*
+     * Return a section's palette (block state ids)
+     */
+    const std::vector<uint32_t>& get_palette(void) const { return palette; }
+
+    /*
+     * Return a section's y coordinate (in sections)
+     */
+    int get_y(void) const { return y; }
+};
+
+#endif // CHUNK_SECTION_H_
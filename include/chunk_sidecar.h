@@ -0,0 +1,167 @@
+/*
+ * chunk_sidecar.h
+ * Copyright (C) 2012 - 2019 David Jolly
+ * ----------------------
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef CHUNK_SIDECAR_H_
+#define CHUNK_SIDECAR_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+#include "array_view.h"
+
+/*
+ * On-disk cache of a region's decoded chunks (see Chunk::writeSections), kept in a sidecar file
+ * next to the region or anywhere else. Every chunk index holds at most one entry, valid while the
+ * region header still lists the same modified timestamp and data offset for that chunk. The file
+ * is versioned, in native byte order and laid out to be mapped as is: a header naming the region
+ * file, a table of CHUNK_COUNT entries and the payloads they point at. Not thread-safe.
+ */
+class chunk_sidecar {
+public:
+
+    /*
+     * File format version, bumped with any change to the layout or payload format
+     */
+    static const uint32_t VERSION = 1;
+
+private:
+
+    /*
+     * File header and table entry layouts (see chunk_sidecar.cpp)
+     */
+    struct file_header;
+    struct file_entry;
+
+    /*
+     * Entry decoded during this run, not yet saved
+     */
+    struct pending_entry {
+        uint32_t modified;
+        uint64_t offset;
+        std::vector<char> payload;
+    };
+
+    /*
+     * Sidecar file path
+     */
+    std::string path;
+
+    /*
+     * Region file path recorded in the sidecar
+     */
+    std::string region_path;
+
+    /*
+     * Mapped sidecar file, NULL if missing or invalid
+     */
+    const char* mapped;
+
+    /*
+     * Mapped sidecar file size in bytes
+     */
+    size_t mapped_size;
+
+    /*
+     * Sidecar file contents on platforms without mmap
+     */
+    std::vector<char> buffer;
+
+    /*
+     * Table entries of the mapped file
+     */
+    const file_entry* entries;
+
+    /*
+     * Entries added since the file was loaded, by chunk index
+     */
+    std::map<unsigned int, pending_entry> pending;
+
+    /*
+     * Map the sidecar file, ignoring it if missing, of another version or written for another region
+     */
+    void load(void);
+
+    /*
+     * Release the mapped sidecar file
+     */
+    void unload(void);
+
+public:
+
+    /*
+     * Chunk sidecar constructor, loading path if it holds a valid sidecar for region_path
+     */
+    chunk_sidecar(const std::string& path, const std::string& region_path);
+
+    /*
+     * Chunk sidecar constructor
+     */
+    chunk_sidecar(const chunk_sidecar& other) = delete;
+
+    /*
+     * Chunk sidecar destructor, unsaved entries are dropped
+     */
+    virtual ~chunk_sidecar(void);
+
+    /*
+     * Chunk sidecar assignment operator
+     */
+    chunk_sidecar& operator=(const chunk_sidecar& other) = delete;
+
+    /*
+     * Returns the payload cached for a chunk index, empty if missing or stale (the timestamp
+     * or data offset differ). Valid until the next insert or save.
+     */
+    array_view<const char> find(unsigned int index, uint32_t modified, uint64_t offset) const;
+
+    /*
+     * Returns the default sidecar path of a region file
+     */
+    static std::string get_default_path(const std::string& region_path) { return region_path + ".sections"; }
+
+    /*
+     * Returns the sidecar file path
+     */
+    const std::string& get_path(void) const { return path; }
+
+    /*
+     * Returns the region file path recorded in the sidecar
+     */
+    const std::string& get_region_path(void) const { return region_path; }
+
+    /*
+     * Add or replace the payload of a chunk index
+     */
+    void insert(unsigned int index, uint32_t modified, uint64_t offset, std::vector<char> payload);
+
+    /*
+     * Returns true if entries were added since the file was loaded
+     */
+    bool is_dirty(void) const { return !pending.empty(); }
+
+    /*
+     * Write the sidecar file, merging loaded and added entries. The file is written next to
+     * its path and renamed into place. Throws std::runtime_error on failure.
+     */
+    void save(void);
+};
+
+#endif // CHUNK_SIDECAR_H_
@@ -0,0 +1,53 @@
+/*
+ * chunk_status.h
+ * Copyright (C) 2012 - 2019 David Jolly
+ * ----------------------
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef CHUNK_STATUS_H_
+#define CHUNK_STATUS_H_
+
+#include <string>
+
+/*
+ * Outcome of reading a region's chunk, returned by the non-throwing (try_*) reader calls
+ */
+class chunk_status {
+public:
+
+    /*
+     * Chunk read outcomes
+     */
+    enum STATUS {
+        OK, // chunk read and positioned
+        EMPTY, // no chunk stored, or a chunk without sections
+        CORRUPT, // truncated, undecompressable or malformed chunk data
+        UNSUPPORTED_COMPRESSION, // gzip or unknown compression type
+    };
+
+    /*
+     * Throw the exception matching a non-OK status for a chunk at a given x, z coord
+     * (std::out_of_range if empty, std::runtime_error otherwise)
+     */
+    static void check(STATUS status, unsigned int x, unsigned int z);
+
+    /*
+     * Returns a string representation of a status
+     */
+    static std::string to_string(STATUS status);
+};
+
+#endif // CHUNK_STATUS_H_
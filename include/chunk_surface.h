@@ -0,0 +1,115 @@
+/*
+ * chunk_surface.h
+ * Copyright (C) 2012 - 2019 David Jolly
+ * ----------------------
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef CHUNK_SURFACE_H_
+#define CHUNK_SURFACE_H_
+
+#include <climits>
+#include <cstdint>
+#include "chunk_format.h"
+#include "region_file_reader.h"
+#include "tag/compound_tag.h"
+
+/*
+ * Highest non-air block of every column of a chunk. Sections are decoded from
+ * the top down and decoding stops once every column is resolved. The packed
+ * WORLD_SURFACE heightmap, when present, tells where to start; it is only
+ * trusted while the decoded blocks agree with it.
+ */
+class chunk_surface {
+public:
+
+    /*
+     * Number of columns in a chunk
+     */
+    static const unsigned int COLUMN_COUNT = 256;
+
+    /*
+     * Height of columns holding no block
+     */
+    static const int32_t NO_HEIGHT = INT32_MIN;
+
+private:
+
+    /*
+     * Block state id (see block_registry) of every column's top block, ordered z * 16 + x
+     */
+    uint32_t ids[COLUMN_COUNT];
+
+    /*
+     * World y of every column's top block, ordered z * 16 + x
+     */
+    int32_t heights[COLUMN_COUNT];
+
+    /*
+     * Resolve columns from the top down, starting at a given section y. Returns false if a
+     * column disagrees with its hinted height (hints may be NULL).
+     */
+    bool scan(list_tag* sections, chunk_format::GENERATION generation, int top_section, const int32_t* hints);
+
+public:
+
+    /*
+     * Chunk surface constructor
+     */
+    chunk_surface(void) { clear(); }
+
+    /*
+     * Mark every column as holding no block
+     */
+    void clear(void);
+
+    /*
+     * Extract the surface of a chunk's root compound. Returns false if the chunk has no sections.
+     */
+    bool extract(compound_tag& root);
+
+    /*
+     * Extract the surface of a region's chunk at a given x, z coord. Returns false if the chunk is
+     * empty. Chunk tags read by the call are dropped afterwards.
+     */
+    bool extract(region_file_reader& reader, unsigned int x, unsigned int z);
+
+    /*
+     * Return the height (world y) of a given x, z column, or NO_HEIGHT
+     */
+    int32_t get_height_at(unsigned int x, unsigned int z) const { return heights[get_index(x, z)]; }
+
+    /*
+     * Return every column's height (world y), ordered z * 16 + x
+     */
+    const int32_t* get_heights(void) const { return heights; }
+
+    /*
+     * Return the block state id of a given x, z column's top block (air if none)
+     */
+    uint32_t get_id_at(unsigned int x, unsigned int z) const { return ids[get_index(x, z)]; }
+
+    /*
+     * Return every column's top block state id, ordered z * 16 + x
+     */
+    const uint32_t* get_ids(void) const { return ids; }
+
+    /*
+     * Return the column index of a given x, z coord (relative to the chunk)
+     */
+    static unsigned int get_index(unsigned int x, unsigned int z) { return z * 16 + x; }
+};
+
+#endif // CHUNK_SURFACE_H_
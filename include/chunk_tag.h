@@ -33,27 +33,43 @@ private:
      */
     compound_tag root;
 
+    /*
+     * Renewed whenever root's sub-tags are dropped or replaced, unique across chunk tags
+     * so a tag reallocated in the same place never repeats a previous revision
+     */
+    unsigned long revision;
+
     /*
      * Returns a chunk tag sub-tag at a given name helper
      */
     void get_tag_by_name_helper(const std::string& name, generic_tag* tag, std::vector<generic_tag*>& tags);
 
+    /*
+     * Returns a new, never used revision
+     */
+    static unsigned long next_revision(void);
+
+    /*
+     * Add a reference to every root sub-tag (subtrees become shared)
+     */
+    void retain_root(void);
+
 public:
 
     /*
      * Chunk tag constructor
      */
-    chunk_tag(void) { return; }
+    chunk_tag(void) : revision(next_revision()) { return; }
 
     /*
-     * Chunk tag constructor
+     * Chunk tag constructor (shares subtrees with other, see get_unique_sub_tag)
      */
-    chunk_tag(const chunk_tag& other) : root(other.root) { return; }
+    chunk_tag(const chunk_tag& other) : root(other.root), revision(next_revision()) { retain_root(); }
 
     /*
-     * Chunk tag constructor
+     * Chunk tag constructor (adopts root's subtrees, which the caller must no longer release)
      */
-    chunk_tag(const compound_tag& root) : root(root) { return; }
+    chunk_tag(const compound_tag& root) : root(root), revision(next_revision()) { return; }
 
     /*
      * Chunk tag destructor
@@ -81,17 +97,22 @@ public:
     void clean_root(void);
 
     /*
-     * Clean chunk tag (recursively)
+     * Clean chunk tag (recursively), subtrees still referenced elsewhere are kept
      */
     static void clean_tag(generic_tag* tag);
 
     /*
-     * Copy chunk tag
+     * Copy a single chunk tag level, compound/list sub-tags are shared with src
+     */
+    static generic_tag* clone_tag(generic_tag* src);
+
+    /*
+     * Copy chunk tag (deep copy, nothing is shared with other)
      */
     void copy(chunk_tag& other);
 
     /*
-     * Copy chunk tag (recursively)
+     * Copy chunk tag (recursively, deep copy)
      */
     static generic_tag* copy_tag(generic_tag* src);
 
@@ -121,6 +142,11 @@ public:
      */
     unsigned int get_data_size(void) { return root.get_data_size(false); }
 
+    /*
+     * Return a chunk tag's revision, views into the root tag are stale once it changes
+     */
+    unsigned long get_revision(void) const { return revision; }
+
     /*
      * Return a chunk tag's root tag
      */
@@ -132,9 +158,15 @@ public:
     std::vector<generic_tag*> get_sub_tag_by_name(const std::string& name);
 
     /*
-     * Sets a chunk tag's root tag
+     * Returns the sub-tag at a given path (compound names or list indices) that is safe
+     * to modify, copying any shared tag along the path first. Returns NULL if not found.
+     */
+    generic_tag* get_unique_sub_tag(const std::vector<std::string>& path);
+
+    /*
+     * Sets a chunk tag's root tag (adopts root's subtrees, which the caller must no longer release)
      */
-    void set_root_tag(compound_tag& root) { this->root = root; }
+    void set_root_tag(compound_tag& root);
 
     /*
      * Returns a string representation of a chunk tag
@@ -0,0 +1,204 @@
+/*
+ * chunk_view.h
+ * Copyright (C) 2012 - 2019 David Jolly
+ * ----------------------
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef CHUNK_VIEW_H_
+#define CHUNK_VIEW_H_
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+#include "chunk_format.h"
+#include "chunk_section.h"
+#include "legacy_section.h"
+#include "tag/compound_tag.h"
+#include "tag/int_array_tag.h"
+#include "tag/list_tag.h"
+#include "tag/long_array_tag.h"
+
+/*
+ * Resolved view of a parsed chunk. The layout, position, section list and the
+ * commonly queried sub-tags are looked up once, sections are indexed by y and
+ * decoded on first use, so point queries cost O(1). A view borrows the chunk's
+ * tags and must not outlive them (see chunk_tag::get_revision).
+ */
+class chunk_view {
+private:
+
+    /*
+     * Chunk layout
+     */
+    chunk_format::GENERATION generation;
+
+    /*
+     * Compound holding the position and sections (Level, or the root for 1.18+), NULL if absent
+     */
+    compound_tag* level;
+
+    /*
+     * True if the chunk has an xPos and zPos
+     */
+    bool positioned;
+
+    /*
+     * Chunk x, z position (in chunks)
+     */
+    int x_pos, z_pos;
+
+    /*
+     * Section list, NULL if absent
+     */
+    list_tag* sections;
+
+    /*
+     * Lowest section y in section_tags
+     */
+    int min_section;
+
+    /*
+     * Section compounds, indexed by y - min_section (NULL where absent)
+     */
+    std::vector<compound_tag*> section_tags;
+
+    /*
+     * Decoded sections, indexed like section_tags (NULL until decoded or without block data)
+     */
+    std::vector<std::unique_ptr<chunk_section>> decoded;
+
+    /*
+     * Decoded legacy sections, indexed like section_tags (NULL until decoded or without Blocks)
+     */
+    std::vector<std::unique_ptr<legacy_section>> legacy;
+
+    /*
+     * Decode status of every section: bit 0 for decoded, bit 1 for legacy
+     */
+    std::vector<uint8_t> checked;
+
+    /*
+     * Level Biomes array (byte or int array), NULL if absent
+     */
+    generic_tag* biomes;
+
+    /*
+     * Legacy HeightMap, NULL if absent
+     */
+    int_array_tag* height_map;
+
+    /*
+     * Heightmaps compound, NULL if absent
+     */
+    compound_tag* heightmaps;
+
+    /*
+     * Returns the index of a section y in section_tags, or -1 if out of range
+     */
+    int get_slot(int y) const {
+        int slot = y - min_section;
+        return (slot >= 0 && slot < static_cast<int>(section_tags.size())) ? slot : -1;
+    }
+
+public:
+
+    /*
+     * Chunk view constructor
+     */
+    chunk_view(compound_tag& root);
+
+    /*
+     * Chunk view constructor
+     */
+    chunk_view(const chunk_view& other) = delete;
+
+    /*
+     * Chunk view assignment operator
+     */
+    chunk_view& operator=(const chunk_view& other) = delete;
+
+    /*
+     * Return the Level Biomes array (byte or int array), NULL if absent
+     */
+    generic_tag* get_biomes(void) const { return biomes; }
+
+    /*
+     * Returns the block state id (see block_registry) at a given x, z coord (relative to the chunk)
+     * and world y. Returns air where no section holds block data (and for legacy chunks).
+     */
+    uint32_t get_block_id_at(unsigned int x, int y, unsigned int z);
+
+    /*
+     * Return the chunk's layout
+     */
+    chunk_format::GENERATION get_generation(void) const { return generation; }
+
+    /*
+     * Return the legacy HeightMap, NULL if absent
+     */
+    int_array_tag* get_height_map(void) const { return height_map; }
+
+    /*
+     * Returns a packed heightmap (e.g. WORLD_SURFACE) from Heightmaps, NULL if absent
+     */
+    long_array_tag* get_heightmap(const std::string& name) const;
+
+    /*
+     * Returns the decoded legacy section at a given section y, NULL if absent
+     */
+    const legacy_section* get_legacy_section(int y);
+
+    /*
+     * Return the compound holding the position and sections, NULL if absent
+     */
+    compound_tag* get_level(void) const { return level; }
+
+    /*
+     * Returns the decoded section at a given section y, NULL if absent or without block data
+     */
+    const chunk_section* get_section(int y);
+
+    /*
+     * Returns the section compound at a given section y, NULL if absent
+     */
+    compound_tag* get_section_tag(int y) const {
+        int slot = get_slot(y);
+        return slot >= 0 ? section_tags[slot] : NULL;
+    }
+
+    /*
+     * Return the section list, NULL if absent
+     */
+    list_tag* get_sections(void) const { return sections; }
+
+    /*
+     * Return the chunk's x position (in chunks)
+     */
+    int get_x_pos(void) const { return x_pos; }
+
+    /*
+     * Return the chunk's z position (in chunks)
+     */
+    int get_z_pos(void) const { return z_pos; }
+
+    /*
+     * Returns true if the chunk has an xPos and zPos
+     */
+    bool has_position(void) const { return positioned; }
+};
+
+#endif // CHUNK_VIEW_H_
@@ -0,0 +1,146 @@
+/*
+ * incremental_scan.h
+ * Copyright (C) 2012 - 2019 David Jolly
+ * ----------------------
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef INCREMENTAL_SCAN_H_
+#define INCREMENTAL_SCAN_H_
+
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <string>
+#include <vector>
+#include "region_dim.h"
+#include "region_file_reader.h"
+#include "sparse_array.h"
+
+/*
+ * Incremental world scanner. A manifest records the header timestamp and data offset of every
+ * chunk seen by the last scan, so a scan only reads region headers and hands the chunks that were
+ * added or changed since to callbacks. Chunks gone from a scanned region, and every chunk of a
+ * region file that no longer exists, are reported as removed.
+ */
+class incremental_scan {
+public:
+
+    /*
+     * Header state of a chunk when last scanned
+     */
+    struct chunk_state {
+        uint32_t modified;
+        uint64_t offset;
+    };
+
+    /*
+     * Added or changed chunk callback (reader, chunk x, chunk z). The chunk is read lazily
+     * through the reader and its tags are dropped once the callback returns.
+     */
+    typedef std::function<void(region_file_reader&, unsigned int, unsigned int)> chunk_work;
+
+    /*
+     * Removed chunk callback (region path, chunk x, chunk z)
+     */
+    typedef std::function<void(const std::string&, unsigned int, unsigned int)> removed_work;
+
+    /*
+     * Chunk states of a region, by chunk index (z * CHUNK_WIDTH + x)
+     */
+    typedef sparse_array<chunk_state, region_dim::CHUNK_COUNT> region_manifest;
+
+    /*
+     * Manifest file format version
+     */
+    static const unsigned int VERSION = 1;
+
+private:
+
+    /*
+     * Chunk states by region path
+     */
+    std::map<std::string, region_manifest> manifest;
+
+    /*
+     * Change callbacks, unset callbacks are skipped
+     */
+    chunk_work added;
+    chunk_work changed;
+    removed_work removed;
+
+    /*
+     * Report every chunk of a region as removed and forget it
+     */
+    void remove_region(std::map<std::string, region_manifest>::iterator region);
+
+    /*
+     * Scan a single region file against its manifest entry
+     */
+    void scan_region(const std::string& path, region_manifest& previous);
+
+public:
+
+    /*
+     * Incremental scan constructor
+     */
+    incremental_scan(void) { return; }
+
+    /*
+     * Forget every recorded chunk, the next scan reports all chunks as added
+     */
+    void clear(void) { manifest.clear(); }
+
+    /*
+     * Returns the recorded chunk states by region path
+     */
+    const std::map<std::string, region_manifest>& get_manifest(void) const { return manifest; }
+
+    /*
+     * Read a manifest written by save, replacing the current one. A missing file
+     * leaves the manifest empty. Throws std::runtime_error if the file is malformed.
+     */
+    void load(const std::string& path);
+
+    /*
+     * Write the manifest to a file, through a temporary file renamed into place.
+     * Throws std::runtime_error on failure.
+     */
+    void save(const std::string& path) const;
+
+    /*
+     * Scan the given region files, calling back for added, changed and removed chunks. The manifest
+     * is updated as chunks are handled, so a scan interrupted by an exception resumes where it left
+     * off. Recorded regions not listed are only reported removed if their file no longer exists.
+     */
+    void scan(const std::vector<std::string>& paths);
+
+    /*
+     * Sets the callback for chunks missing from the manifest
+     */
+    void set_added(const chunk_work& added) { this->added = added; }
+
+    /*
+     * Sets the callback for chunks whose timestamp or data offset changed
+     */
+    void set_changed(const chunk_work& changed) { this->changed = changed; }
+
+    /*
+     * Sets the callback for recorded chunks which are no longer stored
+     */
+    void set_removed(const removed_work& removed) { this->removed = removed; }
+};
+
+#endif // INCREMENTAL_SCAN_H_
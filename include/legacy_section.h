@@ -0,0 +1,102 @@
+/*
+ * legacy_section.h
+ * Copyright (C) 2012 - 2019 David Jolly
+ * ----------------------
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef LEGACY_SECTION_H_
+#define LEGACY_SECTION_H_
+
+#include <cstdint>
+#include "tag/compound_tag.h"
+
+/*
+ * A 16x16x16 pre-1.13 chunk section decoded into dense 16-bit values. Each
+ * value combines the 12-bit block id (Blocks plus the Add nibble) with the
+ * 4-bit Data value: (id << 4) | data.
+ */
+class legacy_section {
+public:
+
+    /*
+     * Number of blocks in a section
+     */
+    static const unsigned int BLOCK_COUNT = 4096;
+
+private:
+
+    /*
+     * Section y coordinate (in sections)
+     */
+    int y;
+
+    /*
+     * Value of every block, ordered (y * 16 + z) * 16 + x
+     */
+    uint16_t values[BLOCK_COUNT];
+
+public:
+
+    /*
+     * Legacy section constructor
+     */
+    legacy_section(void) : y(0), values() { return; }
+
+    /*
+     * Decode a section compound's Blocks, Add and Data arrays in a single pass.
+     * Returns false if the section holds no Blocks.
+     */
+    static bool decode(compound_tag* section, legacy_section& sect);
+
+    /*
+     * Returns the block id of a value
+     */
+    static uint16_t get_block_id(uint16_t value) { return value >> 4; }
+
+    /*
+     * Return the block id at a given x, y, z coord (relative to the section)
+     */
+    uint16_t get_block_id_at(unsigned int x, unsigned int y, unsigned int z) const {
+        return get_block_id(get_value_at(x, y, z));
+    }
+
+    /*
+     * Returns the data value of a value
+     */
+    static uint8_t get_data(uint16_t value) { return value & 15; }
+
+    /*
+     * Return the data value at a given x, y, z coord (relative to the section)
+     */
+    uint8_t get_data_at(unsigned int x, unsigned int y, unsigned int z) const { return get_data(get_value_at(x, y, z)); }
+
+    /*
+     * Return the combined value at a given x, y, z coord (relative to the section)
+     */
+    uint16_t get_value_at(unsigned int x, unsigned int y, unsigned int z) const { return values[(y * 16 + z) * 16 + x]; }
+
+    /*
+     * Return every block's combined value, ordered (y * 16 + z) * 16 + x
+     */
+    const uint16_t* get_values(void) const { return values; }
+
+    /*
+     * Return a section's y coordinate (in sections)
+     */
+    int get_y(void) const { return y; }
+};
+
+#endif // LEGACY_SECTION_H_
@@ -0,0 +1,52 @@
+/*
+ * nibble_array.h
+ * Copyright (C) 2012 - 2019 David Jolly
+ * ----------------------
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef NIBBLE_ARRAY_H_
+#define NIBBLE_ARRAY_H_
+
+#include <cstdint>
+#include "array_view.h"
+
+/*
+ * 4-bit array decoder (BlockLight, SkyLight). Two values per byte, the even
+ * index in the low nibble. Bulk decoding uses SSE2 where available.
+ */
+class nibble_array {
+public:
+
+    /*
+     * Number of bytes of a section's light array
+     */
+    static const unsigned int SECTION_SIZE = 2048;
+
+    /*
+     * Returns the value at a given index
+     */
+    static uint8_t get(array_view<const char> data, unsigned int index) {
+        uint8_t value = static_cast<uint8_t>(data[index >> 1]);
+        return (index & 1) ? value >> 4 : value & 15;
+    }
+
+    /*
+     * Unpack count values (even) from data, holding at least count / 2 bytes
+     */
+    static void unpack(array_view<const char> data, uint8_t* out, unsigned int count);
+};
+
+#endif // NIBBLE_ARRAY_H_
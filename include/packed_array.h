@@ -0,0 +1,82 @@
+/*
+ * packed_array.h
+ * Copyright (C) 2012 - 2019 David Jolly
+ * ----------------------
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef PACKED_ARRAY_H_
+#define PACKED_ARRAY_H_
+
+#include <cstdint>
+#include "array_view.h"
+
+/*
+ * Bit-packed long array decoder (BlockStates, Heightmaps, biome data) and
+ * unpacked index search and counting. Padded arrays (1.16+) never split an index across
+ * two longs, spanning arrays (pre-1.16) do. Every width/layout pair has its
+ * own unpacker, AVX2 kernels are selected at runtime when the cpu supports them.
+ */
+class packed_array {
+public:
+
+    /*
+     * Maximum supported index width
+     */
+    static const unsigned int MAX_BITS = 16;
+
+    /*
+     * Maximum value range counted with vector compares
+     */
+    static const unsigned int MAX_COUNT_VALUES = 16;
+
+    /*
+     * Maximum number of targets searched with vector compares
+     */
+    static const unsigned int MAX_FIND_TARGETS = 8;
+
+    /*
+     * Add the number of occurrences of every value to tally, values must be below tally_size
+     */
+    static void count(const uint16_t* values, unsigned int count, uint32_t* tally, unsigned int tally_size);
+
+    /*
+     * Find the positions of values matching any of the targets, returns the number found.
+     * Positions must hold count entries.
+     */
+    static unsigned int find(const uint16_t* values, unsigned int count, array_view<const uint16_t> targets, uint32_t* positions);
+
+    /*
+     * Returns the index at a given position
+     */
+    static unsigned int get(array_view<const int64_t> data, unsigned int bits, bool padded, unsigned int index);
+
+    /*
+     * Returns true if the AVX2 kernels are in use
+     */
+    static bool has_avx2(void);
+
+    /*
+     * Returns the number of longs needed to hold count bits-wide indices
+     */
+    static unsigned int long_count(unsigned int bits, bool padded, unsigned int count);
+
+    /*
+     * Unpack count bits-wide indices from a packed long array
+     */
+    static void unpack(array_view<const int64_t> data, unsigned int bits, bool padded, uint16_t* out, unsigned int count);
+};
+
+#endif // PACKED_ARRAY_H_
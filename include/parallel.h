@@ -0,0 +1,90 @@
+/*
+ * parallel.h
+ * Copyright (C) 2012 - 2019 David Jolly
+ * ----------------------
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef PARALLEL_H_
+#define PARALLEL_H_
+
+#include <functional>
+#include <string>
+#include <vector>
+#include "region_file_reader.h"
+
+/*
+ * Work distribution across threads and region files
+ */
+class parallel {
+public:
+
+    /*
+     * Chunk work callback (reader, chunk x, chunk z, item, thread)
+     */
+    typedef std::function<void(region_file_reader&, unsigned int, unsigned int, size_t, unsigned int)> chunk_work;
+
+    /*
+     * Skipped chunk callback (reader, chunk x, chunk z, status), for corrupt and unsupported chunks
+     */
+    typedef std::function<void(region_file_reader&, unsigned int, unsigned int, chunk_status::STATUS)> skip_work;
+
+    /*
+     * Item work callback (item, thread)
+     */
+    typedef std::function<void(size_t, unsigned int)> item_work;
+
+    /*
+     * Number of items per region in for_each_chunk (one per chunk row)
+     */
+    static const unsigned int ITEMS_PER_REGION = 32;
+
+    /*
+     * Single chunk of a region file (path index, chunk x, chunk z)
+     */
+    struct chunk_item {
+        size_t path;
+        unsigned int x;
+        unsigned int z;
+    };
+
+    /*
+     * Run work on every filled chunk of the given region files. Each chunk row of a region
+     * is one item (item = path index * ITEMS_PER_REGION + chunk z), so callers can keep
+     * per-item results in a deterministic order. Every thread reads through its own lazy
+     * reader and chunk tags are dropped once their work is done.
+     */
+    static void for_each_chunk(const std::vector<std::string>& paths, unsigned int thread_count, const chunk_work& work);
+
+    /*
+     * Run work on the given chunks, each one being an item (item = index into chunks). Chunks
+     * are expected to be grouped by path. Empty chunks are skipped.
+     */
+    static void for_each_chunk(const std::vector<std::string>& paths, const std::vector<chunk_item>& chunks,
+        unsigned int thread_count, const chunk_work& work);
+
+    /*
+     * Run work on items [0, count) over thread_count threads (0 for one per core).
+     * The first exception thrown by a worker is rethrown once all threads are done.
+     */
+    static void for_each_item(size_t count, unsigned int thread_count, const item_work& work);
+
+    /*
+     * Returns the number of threads to use for a requested count (0 for one per core)
+     */
+    static unsigned int get_thread_count(unsigned int requested);
+};
+
+#endif // PARALLEL_H_
@@ -25,8 +25,16 @@
 #include "chunk_tag.h"
 #include "region_dim.h"
 #include "region_header.h"
+#include "sparse_array.h"
 
 class region {
+public:
+
+    /*
+     * Chunk tags, allocated per chunk on first use
+     */
+    typedef sparse_array<chunk_tag, region_dim::CHUNK_COUNT> tag_array;
+
 private:
 
     /*
@@ -35,9 +43,9 @@ private:
     region_header header;
 
     /*
-     * Region chunk tags
+     * Region chunk tags (absent chunks are empty)
      */
-    chunk_tag tags[region_dim::CHUNK_COUNT];
+    tag_array tags;
 
     /*
      * Region x, z coord
@@ -54,7 +62,7 @@ public:
     /*
      * Region constructor
      */
-    region(const region& other);
+    region(const region& other) : header(other.header), tags(other.tags), x(other.x), z(other.z) { return; }
 
     /*
      * Region constructor
@@ -64,7 +72,7 @@ public:
     /*
      * Region constructor
      */
-    region(int x, int z, const region_header& header, const chunk_tag (& tags)[region_dim::CHUNK_COUNT]);
+    region(int x, int z, const region_header& header, const tag_array& tags) : header(header), tags(tags), x(x), z(z) { return; }
 
     /*
      * Region destructor
@@ -86,6 +94,11 @@ public:
      */
     bool operator!=(const region& other) { return !(*this == other); }
 
+    /*
+     * Returns a region's tag at a given index, or NULL if it was never used
+     */
+    chunk_tag* find_tag_at(unsigned int index) { return tags.find(index); }
+
     /*
      * Generate a new region
      */
@@ -104,10 +117,10 @@ public:
     /*
      * Returns a region's tags
      */
-    const chunk_tag (& get_tags(void) const )[region_dim::CHUNK_COUNT] { return tags; }
+    const tag_array& get_tags(void) const { return tags; }
 
     /*
-     * Returns a region's tag at a given index
+     * Returns a region's tag at a given index, allocating it on first use
      */
     chunk_tag& get_tag_at(unsigned int index);
 
@@ -134,7 +147,7 @@ public:
     /*
      * Sets a region's tags
      */
-    void set_tags(const chunk_tag (& tags)[region_dim::CHUNK_COUNT]);
+    void set_tags(const tag_array& tags) { this->tags = tags; }
 
     /*
      * Sets a region tag at a given index
@@ -57,6 +57,19 @@ public:
      * Region file sector size
      */
     static const unsigned int SECTOR_SIZE = 4096;
+
+    /*
+     * Divide rounding towards negative infinity (block to chunk, chunk to region coords)
+     */
+    static int floor_div(int value, int divisor) {
+        int quotient = value / divisor;
+        return (value % divisor && ((value < 0) != (divisor < 0))) ? quotient - 1 : quotient;
+    }
+
+    /*
+     * Remainder of floor_div, always in [0, divisor) for positive divisors
+     */
+    static int floor_mod(int value, int divisor) { return value - floor_div(value, divisor) * divisor; }
 };
 
 #endif // REGION_DIM_H_
@@ -21,9 +21,16 @@
 #define REGION_FILE_READER_H_
 
 #include <fstream>
+#include <functional>
+#include <memory>
 #include <stdexcept>
 #include <string>
+#include "array_view.h"
 #include "byte_stream.h"
+#include "chunk_section.h"
+#include "chunk_sidecar.h"
+#include "chunk_status.h"
+#include "chunk_view.h"
 #include "region_file.h"
 #include "Block.h"
 #include "Chunk.h"
@@ -38,10 +45,35 @@ private:
      */
     std::ifstream file;
 
+    /*
+     * Release a chunk's tags once readChunk has decoded it
+     */
+    bool decode_and_drop;
+
+    /*
+     * Decoded chunk cache consulted by readChunk, NULL if none
+     */
+    std::shared_ptr<chunk_sidecar> sidecar;
+
+    /*
+     * View of the last chunk queried
+     */
+    std::unique_ptr<chunk_view> view;
+
+    /*
+     * Position of the viewed chunk (CHUNK_COUNT if none)
+     */
+    unsigned int view_pos;
+
+    /*
+     * Revision of the viewed chunk's tag when the view was made
+     */
+    unsigned long view_revision;
+
     /*
      * Read a chunk tag from data
      */
-    void parse_chunk_tag(std::vector<char>& data, chunk_tag& tag);
+    void parse_chunk_tag(std::vector<char>&& data, chunk_tag& tag);
 
     /*
      * Read a tag from data
@@ -60,8 +92,12 @@ private:
         if (!stream.good())
             throw std::runtime_error("Unexpected end of stream");
 
-        // retrieve value
+        // retrieve value, lengths come from the stream and are checked before reserving
         ele_len = read_value<int>(stream);
+        if (ele_len < 0)
+            throw std::runtime_error("Negative array length");
+        if (static_cast<size_t>(ele_len) > stream.available() / sizeof(T))
+            throw std::runtime_error("Unexpected array length");
         value.reserve(ele_len);
         for (int i = 0; i < ele_len; ++i) {
             value.push_back(read_value<T>(stream));
@@ -84,12 +120,6 @@ private:
      */
     std::string read_string_value(byte_stream& stream);
 
-    /*
-     * Reads all bits in range from start to end from the given buffer, eg.
-     * val = 0b 1011 1010, start = 0, end = 5 it will return 0b 1 1010
-     */
-    uint64_t getBits(uint64_t val, unsigned int start, unsigned int end);
-
     /*
      * Reads a numeric tag value from stream
      */
@@ -101,8 +131,9 @@ private:
         if (!stream.good())
             throw std::runtime_error("Unexpected end of stream");
 
-        // retrieve value
-        stream >> value;
+        // retrieve value, short reads are corrupt
+        if (!(stream >> value))
+            throw std::runtime_error("Unexpected end of stream");
         return value;
     }
 
@@ -130,13 +161,9 @@ private:
     }
 
 
-    void get_blocks_from_subchunk(compound_tag* sectionEntry, uint64_t chunkX, uint64_t chunkZ, unsigned int blockX,
+    void get_blocks_from_subchunk(compound_tag* sectionEntry, chunk_format::GENERATION generation, unsigned int blockX,
         unsigned int blockZ, std::vector<Block>& blockList);
 
-    void addSubchunk(compound_tag* sectionEntry, int32_t chunkX, int32_t chunkZ, std::array<int32_t, 2> blockOffset, std::shared_ptr<Chunk> chunk);
-
-    uint64_t getPaletteIndex(std::vector<int64_t> const& blockStateEntries, uint64_t blockNumber, unsigned int bitPerIndex);
-
     /*!
      * Reads chunk information from the mca file at the given chunk
      * \param x position of the CHUNK
@@ -144,27 +171,46 @@ private:
      */
     void read_chunk(uint16_t x, uint16_t z);
 
+    /*
+     * Reads chunk information from the mca file at the given chunk. Returns the chunk's status
+     * instead of throwing, only I/O failures throw.
+     */
+    chunk_status::STATUS try_read_chunk(uint16_t x, uint16_t z);
+
     /*
      * Returns a region's blocks at a given x, z coord
      */
     void get_blocks_at(unsigned int x, unsigned int z, std::vector<Block>& foundBlocks);
 
+    /*
+     * Returns the view of a chunk at a given x, z coord, or NULL if the chunk is empty
+     */
+    chunk_view* find_chunk_view(unsigned int x, unsigned int z);
+
+    /*
+     * Returns a byte array of a chunk's section at a given x, z & section y coord, without copying.
+     * Returns an empty view if not found.
+     */
+    array_view<const char> get_section_array(unsigned int x, unsigned int z, int section_y, const std::string& name);
+
 public:
 
     /*
      * Region file reader constructor
      */
-    region_file_reader(void) { return; }
+    region_file_reader(void) : decode_and_drop(false), view_pos(region_dim::CHUNK_COUNT), view_revision(0) { return; }
 
     /*
      * Region file reader constructor
      */
-    region_file_reader(const std::string& path) : region_file(path) { return; }
+    region_file_reader(const std::string& path) : region_file(path), decode_and_drop(false),
+        view_pos(region_dim::CHUNK_COUNT), view_revision(0) { return; }
 
     /*
      * Region file reader constructor
      */
-    region_file_reader(const region_file_reader& other) : region_file(other.path, other.reg) { return; }
+    region_file_reader(const region_file_reader& other) : region_file(other.path, other.reg),
+        decode_and_drop(other.decode_and_drop), sidecar(other.sidecar), view_pos(region_dim::CHUNK_COUNT), view_revision(0) { return; }
 
     /*
      * Region file reader destructor
@@ -201,6 +247,19 @@ public:
      */
     int get_block_at(unsigned int x, unsigned int z, unsigned int b_x, unsigned int b_y, unsigned int b_z);
 
+    /*
+     * Returns a region block data value at given x, z & b coord (pre-1.13 chunks)
+     */
+    int get_block_data_at(unsigned int x, unsigned int z, unsigned int b_x, unsigned int b_y, unsigned int b_z);
+
+    /*
+     * Returns the BlockLight nibbles (see nibble_array) of a chunk's section at a given x, z & section y
+     * coord, without copying. Returns an empty view if not found. Valid while the chunk stays loaded.
+     */
+    array_view<const char> get_block_light_at(unsigned int x, unsigned int z, int section_y) {
+        return get_section_array(x, z, section_y, "BlockLight");
+    }
+
     /*
     * Returns all blocks from lowerX, lowerZ to upperX, upperZ
     */
@@ -211,17 +270,78 @@ public:
      */
     std::vector<Block> get_blocks_at(unsigned int chunkX, unsigned int chunkZ, unsigned int blockX, unsigned int BlockZ);
 
-    std::shared_ptr<Chunk> getChunkAt(int32_t x, int32_t z);
+    std::shared_ptr<Chunk> getChunkAt(int32_t x, int32_t z, uint32_t fields = Chunk::BLOCKS);
+
+    /*!
+     * Decodes the requested fields (see Chunk::Field) of a chunk. In decode-and-drop mode the chunk's
+     * tags are released once decoded, so only the decoded chunk stays in memory.
+     */
+    void readChunk(std::shared_ptr<Chunk> chunk, uint32_t fields = Chunk::BLOCKS);
 
-    void readChunk(std::shared_ptr<Chunk> chunk);
+    /*!
+     * Non-throwing readChunk: empty chunks and chunks with malformed data are reported through the status.
+     * A corrupt chunk may keep the sections decoded before the error was found.
+     */
+    chunk_status::STATUS tryReadChunk(std::shared_ptr<Chunk> chunk, uint32_t fields = Chunk::BLOCKS);
 
 
 
     /*
-     * Returns a region's chunk tag at a given x, z coord
+     * Returns a region's chunk tag at a given x, z coord, allocating its slot on first use
      */
     chunk_tag& get_chunk_tag_at(unsigned int x, unsigned int z);
 
+    /*
+     * Returns a view of a chunk at a given x, z coord, reading the chunk on first use. The view is
+     * kept for further queries until another chunk is viewed or the chunk's tag changes.
+     */
+    chunk_view& get_chunk_view(unsigned int x, unsigned int z);
+
+    /*
+     * Decode a region's chunk at a given x, z coord one section at a time, calling visit(section, chunk x, chunk z)
+     * with the chunk's world position (in chunks). Chunks loaded for the visit are dropped afterwards.
+     */
+    void visit_sections_at(unsigned int x, unsigned int z, const std::function<void(const chunk_section&, int, int)>& visit);
+
+    /*
+     * Stream a region's blocks at a given x, z coord to visit(x, y, z, id) in world coords, with
+     * block_registry ids. Memory use is bounded by one decoded section.
+     */
+    template<class Visitor>
+    void visit_blocks_at(unsigned int x, unsigned int z, Visitor&& visit) {
+        visit_sections_at(x, z, [&visit](const chunk_section& section, int chunk_x, int chunk_z) {
+            const uint16_t* indices = section.get_indices();
+            const uint32_t* palette = section.get_palette().data();
+            int32_t base_x = chunk_x * 16, base_y = section.get_y() * 16, base_z = chunk_z * 16;
+
+            for (unsigned int index = 0; index < chunk_section::BLOCK_COUNT; ++index) {
+                visit(base_x + static_cast<int32_t>(index & 15), base_y + static_cast<int32_t>(index >> 8),
+                    base_z + static_cast<int32_t>((index >> 4) & 15), palette[indices[index]]);
+            }
+        });
+    }
+
+    /*
+     * Stream a region's blocks from lowerX, lowerZ to upperX, upperZ (in chunks, upper exclusive) to
+     * visit(x, y, z, id). Empty chunks are skipped.
+     */
+    template<class Visitor>
+    void visit_blocks_in_range(unsigned int lowerX, unsigned int upperX, unsigned int lowerZ, unsigned int upperZ, Visitor&& visit) {
+        for (unsigned int x = lowerX; x < upperX; ++x) {
+            for (unsigned int z = lowerZ; z < upperZ; ++z) {
+                if (is_filled(x, z))
+                    visit_blocks_at(x, z, visit);
+            }
+        }
+    }
+
+    /*
+     * Returns the section list of a chunk at a given x, z coord, along with its layout and position.
+     * Returns NULL if the chunk is not loaded and load is false.
+     */
+    list_tag* get_chunk_sections(unsigned int x, unsigned int z, bool load, chunk_format::GENERATION& generation,
+        int& x_pos, int& z_pos);
+
     /*
      * Returns a region height value at a given x, z & b coord
      */
@@ -232,6 +352,21 @@ public:
      */
     std::vector<int> get_heightmap_at(unsigned int x, unsigned int z);
 
+    /*
+     * Decode a packed heightmap (e.g. WORLD_SURFACE, MOTION_BLOCKING) of a chunk at a given x, z coord
+     * into 256 heights, ordered z * 16 + x and relative to the chunk's lowest y (see chunk_format::get_min_y).
+     * Returns false if not found.
+     */
+    bool get_heightmap_at(unsigned int x, unsigned int z, const std::string& name, uint16_t* heights);
+
+    /*
+     * Returns the SkyLight nibbles (see nibble_array) of a chunk's section at a given x, z & section y
+     * coord, without copying. Returns an empty view if not found. Valid while the chunk stays loaded.
+     */
+    array_view<const char> get_sky_light_at(unsigned int x, unsigned int z, int section_y) {
+        return get_section_array(x, z, section_y, "SkyLight");
+    }
+
     /*
      * Returns a region file reader's file
      */
@@ -247,17 +382,89 @@ public:
      */
     int get_z_coord(void) { return get_region().get_z(); }
 
+    /*
+     * Return a region file reader's decode-and-drop status (see set_decode_and_drop)
+     */
+    bool is_decode_and_drop(void) const { return decode_and_drop; }
+
+    /*
+     * Return a region file reader's sidecar (see set_sidecar)
+     */
+    const std::shared_ptr<chunk_sidecar>& get_sidecar(void) const { return sidecar; }
+
     /*
      * Return a region's filled status
      */
     bool is_filled(unsigned int x, unsigned int z);
 
+    /*
+     * Return a region's loaded status, true if a chunk at a given x, z coord holds tags.
+     * Unlike get_chunk_tag_at, no slot is allocated for the chunk.
+     */
+    bool is_loaded(unsigned int x, unsigned int z);
+
+    /*
+     * Returns the root compound of a chunk at a given x, z coord, reading it on first use
+     */
+    compound_tag& load_root(unsigned int x, unsigned int z);
+
+    /*
+     * Reads the compressed (zlib) data of a chunk at a given x, z coord from the mca file, without
+     * decoding it. Returns the chunk's status instead of throwing, only I/O failures throw.
+     */
+    chunk_status::STATUS try_read_compressed(unsigned int x, unsigned int z, std::vector<char>& data);
+
+    /*
+     * Fill a chunk's tags at a given x, z coord from its compressed (zlib) data, as returned by
+     * try_read_compressed. Tags already loaded are replaced. Returns the chunk's status instead of throwing.
+     */
+    chunk_status::STATUS try_load_compressed(unsigned int x, unsigned int z, std::vector<char> data);
+
+    /*
+     * Returns the section list of a chunk at a given x, z coord, along with its layout and position,
+     * reading the chunk on first use. Returns the chunk's status instead of throwing.
+     */
+    chunk_status::STATUS try_get_chunk_sections(unsigned int x, unsigned int z, chunk_format::GENERATION& generation,
+        int& x_pos, int& z_pos, list_tag*& sections);
+
+    /*
+     * Returns a view of a chunk at a given x, z coord, reading the chunk on first use (see get_chunk_view).
+     * Returns the chunk's status instead of throwing.
+     */
+    chunk_status::STATUS try_get_chunk_view(unsigned int x, unsigned int z, chunk_view*& result);
+
+    /*
+     * Returns the root compound of a chunk at a given x, z coord, reading it on first use.
+     * Returns the chunk's status instead of throwing.
+     */
+    chunk_status::STATUS try_load_root(unsigned int x, unsigned int z, compound_tag*& root);
+
+    /*
+     * Decode a region's chunk at a given x, z coord one section at a time (see visit_sections_at).
+     * Returns the chunk's status instead of throwing, exceptions thrown by visit are passed on.
+     */
+    chunk_status::STATUS try_visit_sections_at(unsigned int x, unsigned int z,
+        const std::function<void(const chunk_section&, int, int)>& visit);
+
     /*
      * Reads a file into region_file
      * If lazy is true, a chunk is only parsed when data is requested from it.
      */
     void read(bool lazy = false);
 
+    /*
+     * Sets a region file reader's decode-and-drop status. When set, readChunk releases a chunk's
+     * tags as soon as the requested fields are decoded, keeping peak memory per chunk to its decoded size.
+     */
+    void set_decode_and_drop(bool decode_and_drop) { this->decode_and_drop = decode_and_drop; }
+
+    /*
+     * Sets a region file reader's sidecar (NULL for none). readChunk serves Chunk::BLOCKS reads from
+     * the sidecar while the header still lists the cached chunk's timestamp and offset, and adds
+     * chunks it decodes. Call chunk_sidecar::save to persist them.
+     */
+    void set_sidecar(std::shared_ptr<chunk_sidecar> sidecar) { this->sidecar = std::move(sidecar); }
+
     /*
      * Returns a string representation of a region file reader
      */
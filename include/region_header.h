@@ -24,8 +24,17 @@
 #include <vector>
 #include "chunk_info.h"
 #include "region_dim.h"
+#include "sparse_array.h"
 
 class region_header {
+public:
+
+    /*
+     * Chunk information, allocated per chunk on first use
+     */
+    typedef sparse_array<chunk_info, region_dim::CHUNK_COUNT> info_array;
+
+private:
 
     /*
      * Total header size
@@ -35,26 +44,26 @@ class region_header {
 private:
 
     /*
-     * Holds information on all chunks
+     * Holds information on all chunks (absent chunks are empty)
      */
-    chunk_info info[region_dim::CHUNK_COUNT];
+    info_array info;
 
 public:
 
     /*
      * Region header constructor
      */
-    region_header(void);
+    region_header(void) { return; }
 
     /*
      * Region header constructor
      */
-    region_header(const region_header& other);
+    region_header(const region_header& other) : info(other.info) { return; }
 
     /*
      * Region header constructor
      */
-    region_header(const chunk_info (& info)[region_dim::CHUNK_COUNT]);
+    region_header(const info_array& info) : info(info) { return; }
 
     /*
      * Region header destructor
@@ -76,6 +85,11 @@ public:
      */
     bool operator!=(const region_header& other) { return !(*this == other); }
 
+    /*
+     * Return a region header's info at a given index, or NULL if none was set
+     */
+    chunk_info* find_info_at(unsigned int index) { return info.find(index); }
+
     /*
      * Return a region header's region count
      */
@@ -89,17 +103,17 @@ public:
     /*
      * Return a region header's info
      */
-    const chunk_info (& get_info(void) const )[region_dim::CHUNK_COUNT] { return info; }
+    const info_array& get_info(void) const { return info; }
 
     /*
-     * Return a region header's info at a given index
+     * Return a region header's info at a given index, allocating it on first use
      */
     chunk_info& get_info_at(unsigned int index);
 
     /*
      * Set a region header's info
      */
-    void set_info(const chunk_info (& info)[region_dim::CHUNK_COUNT]);
+    void set_info(const info_array& info) { this->info = info; }
 
     /*
      * Set a region header's info at a given index
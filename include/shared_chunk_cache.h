@@ -0,0 +1,157 @@
+/*
+ * shared_chunk_cache.h
+ * Copyright (C) 2012 - 2019 David Jolly
+ * ----------------------
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef SHARED_CHUNK_CACHE_H_
+#define SHARED_CHUNK_CACHE_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "array_view.h"
+
+/*
+ * Cross-process cache of decoded chunks (see Chunk::writeSections) in a POSIX shared-memory
+ * segment. Entries are keyed by dimension, chunk x, z and header timestamp, so a rewritten chunk
+ * simply misses. The index is an open addressed table claimed with compare-and-swap and payloads
+ * are bump allocated, nothing is ever locked or removed: once full, inserts fail until the
+ * segment is removed and recreated.
+ */
+class shared_chunk_cache {
+public:
+
+    /*
+     * Default number of index slots
+     */
+    static const unsigned int DEFAULT_SLOT_COUNT = 1 << 16;
+
+    /*
+     * Cache entry key
+     */
+    struct key {
+        int32_t dimension;
+        int32_t x;
+        int32_t z;
+        uint32_t timestamp;
+    };
+
+private:
+
+    /*
+     * Segment header and index slot layouts (see shared_chunk_cache.cpp)
+     */
+    struct segment_header;
+    struct slot;
+
+    /*
+     * Segment name
+     */
+    std::string name;
+
+    /*
+     * Mapped segment
+     */
+    void* base;
+
+    /*
+     * Mapped segment size in bytes
+     */
+    size_t size;
+
+    /*
+     * Number of index slots and payload arena size, read once when the segment is attached
+     */
+    size_t index_size;
+    size_t arena_size;
+
+    /*
+     * Segment header, index slots and payload arena within the mapping
+     */
+    segment_header* header;
+    slot* slots;
+    char* data;
+
+    /*
+     * Returns the first slot probed for a key
+     */
+    size_t get_slot_index(const key& k) const;
+
+public:
+
+    /*
+     * Shared chunk cache constructor. Opens the named segment, creating it with data_size
+     * payload bytes and slot_count index slots (rounded up to a power of two) if it does not exist.
+     * An existing segment keeps its own layout. Throws std::runtime_error on failure.
+     */
+    shared_chunk_cache(const std::string& name, size_t data_size, unsigned int slot_count = DEFAULT_SLOT_COUNT);
+
+    /*
+     * Shared chunk cache constructor
+     */
+    shared_chunk_cache(const shared_chunk_cache& other) = delete;
+
+    /*
+     * Shared chunk cache destructor, the segment outlives the mapping
+     */
+    virtual ~shared_chunk_cache(void);
+
+    /*
+     * Shared chunk cache assignment operator
+     */
+    shared_chunk_cache& operator=(const shared_chunk_cache& other) = delete;
+
+    /*
+     * Returns a view of the payload stored for a key, empty if not cached. Payloads are never
+     * modified once published, the view stays valid for the lifetime of the cache object.
+     */
+    array_view<const char> find(const key& k) const;
+
+    /*
+     * Returns the payload arena size in bytes
+     */
+    size_t get_capacity(void) const;
+
+    /*
+     * Returns the segment name
+     */
+    const std::string& get_name(void) const { return name; }
+
+    /*
+     * Returns the number of index slots
+     */
+    size_t get_slot_count(void) const;
+
+    /*
+     * Returns the payload bytes allocated so far (across all processes)
+     */
+    size_t get_used(void) const;
+
+    /*
+     * Publish a payload for a key. Returns false if the payload is empty or the arena or index is full.
+     * Publishing a key already present is a no-op.
+     */
+    bool insert(const key& k, const std::vector<char>& payload);
+
+    /*
+     * Remove a named segment, processes which mapped it keep their mapping
+     */
+    static void remove(const std::string& name);
+};
+
+#endif // SHARED_CHUNK_CACHE_H_
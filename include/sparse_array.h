@@ -0,0 +1,247 @@
+/*
+ * sparse_array.h
+ * Copyright (C) 2012 - 2019 David Jolly
+ * ----------------------
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef SPARSE_ARRAY_H_
+#define SPARSE_ARRAY_H_
+
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <stdexcept>
+#include <vector>
+
+/*
+ * Fixed capacity array whose elements are allocated on first use. A presence bitmap
+ * maps each index to its rank in a compact, index ordered list of slots, so absent
+ * elements cost one bit. Elements never move once allocated.
+ */
+template<class T, unsigned int COUNT>
+class sparse_array {
+private:
+
+    /*
+     * Number of bitmap words
+     */
+    static const unsigned int WORD_COUNT = (COUNT + 63) / 64;
+
+    /*
+     * Presence bitmap, bit i is set if index i holds a slot
+     */
+    uint64_t present[WORD_COUNT];
+
+    /*
+     * Number of slots held by the bitmap words before each word
+     */
+    unsigned int offsets[WORD_COUNT];
+
+    /*
+     * Allocated slots, ordered by index
+     */
+    std::vector<std::unique_ptr<T>> slots;
+
+    /*
+     * Returns the number of set bits in a word. Without POPCNT the builtin is a library call,
+     * so the bits are summed in parallel instead.
+     */
+    static unsigned int count_bits(uint64_t bits) {
+#if defined(__POPCNT__)
+        return __builtin_popcountll(bits);
+#else
+        bits -= (bits >> 1) & 0x5555555555555555ULL;
+        bits = (bits & 0x3333333333333333ULL) + ((bits >> 2) & 0x3333333333333333ULL);
+        bits = (bits + (bits >> 4)) & 0x0F0F0F0F0F0F0F0FULL;
+        return static_cast<unsigned int>((bits * 0x0101010101010101ULL) >> 56);
+#endif
+    }
+
+    /*
+     * Returns the slot position of a given index (the number of present indices below it)
+     */
+    size_t rank(unsigned int index) const {
+        unsigned int word = index / 64;
+
+        return offsets[word] + count_bits(present[word] & ((static_cast<uint64_t>(1) << (index % 64)) - 1));
+    }
+
+    /*
+     * Shift the slot offsets of every word after a given index by delta
+     */
+    void shift_offsets(unsigned int index, int delta) {
+        for (unsigned int word = index / 64 + 1; word < WORD_COUNT; ++word) {
+            offsets[word] += delta;
+        }
+    }
+
+public:
+
+    /*
+     * Sparse array constructor
+     */
+    sparse_array(void) : present(), offsets() { return; }
+
+    /*
+     * Sparse array constructor (copies present elements only)
+     */
+    sparse_array(const sparse_array& other) : present(), offsets() { *this = other; }
+
+    /*
+     * Sparse array assignment operator (copies present elements only)
+     */
+    sparse_array& operator=(const sparse_array& other) {
+
+        // check for self
+        if (this == &other)
+            return *this;
+
+        // assign attributes
+        std::vector<std::unique_ptr<T>> copies;
+        copies.reserve(other.slots.size());
+        for (const std::unique_ptr<T>& slot : other.slots) {
+            copies.emplace_back(new T(*slot));
+        }
+        slots.swap(copies);
+        std::copy(other.present, other.present + WORD_COUNT, present);
+        std::copy(other.offsets, other.offsets + WORD_COUNT, offsets);
+        return *this;
+    }
+
+    /*
+     * Sparse array equals operator, absent elements equal default constructed ones
+     */
+    bool operator==(const sparse_array& other) {
+
+        // check for self
+        if (this == &other)
+            return true;
+
+        // only indices present on either side can differ
+        for (unsigned int word = 0; word < WORD_COUNT; ++word) {
+            uint64_t bits = present[word] | other.present[word];
+            while (bits) {
+                unsigned int index = word * 64 + __builtin_ctzll(bits);
+                T empty = T();
+                T* element = find(index);
+                const T* other_element = other.find(index);
+                if (*(element ? element : &empty) != *(other_element ? other_element : &empty))
+                    return false;
+                bits &= bits - 1;
+            }
+        }
+        return true;
+    }
+
+    /*
+     * Sparse array not-equals operator
+     */
+    bool operator!=(const sparse_array& other) { return !(*this == other); }
+
+    /*
+     * Returns the element at a given index, allocating it on first use
+     */
+    T& at(unsigned int index) {
+        T* element = find(index);
+
+        if (element)
+            return *element;
+        size_t pos = rank(index);
+        slots.emplace(slots.begin() + pos, new T());
+        present[index / 64] |= static_cast<uint64_t>(1) << (index % 64);
+        shift_offsets(index, 1);
+        return *slots[pos];
+    }
+
+    /*
+     * Returns the array's capacity
+     */
+    static unsigned int capacity(void) { return COUNT; }
+
+    /*
+     * Drop every element
+     */
+    void clear(void) {
+        slots.clear();
+        std::fill(present, present + WORD_COUNT, 0);
+        std::fill(offsets, offsets + WORD_COUNT, 0);
+    }
+
+    /*
+     * Returns true if an element is allocated at a given index
+     */
+    bool contains(unsigned int index) const {
+        if (index >= COUNT)
+            throw std::out_of_range("index out-of-range");
+        return (present[index / 64] >> (index % 64)) & 1;
+    }
+
+    /*
+     * Drop the element at a given index, if any
+     */
+    void erase(unsigned int index) {
+        if (!contains(index))
+            return;
+        slots.erase(slots.begin() + rank(index));
+        present[index / 64] &= ~(static_cast<uint64_t>(1) << (index % 64));
+        shift_offsets(index, -1);
+    }
+
+    /*
+     * Returns the element at a given index, or NULL if not allocated
+     */
+    T* find(unsigned int index) { return contains(index) ? slots[rank(index)].get() : NULL; }
+
+    /*
+     * Returns the element at a given index, or NULL if not allocated
+     */
+    const T* find(unsigned int index) const { return contains(index) ? slots[rank(index)].get() : NULL; }
+
+    /*
+     * Call visit(index, element) for every allocated element, in index order
+     */
+    template<class Visitor>
+    void for_each(Visitor&& visit) {
+        size_t pos = 0;
+
+        for (unsigned int word = 0; word < WORD_COUNT; ++word) {
+            for (uint64_t bits = present[word]; bits; bits &= bits - 1) {
+                visit(word * 64 + __builtin_ctzll(bits), *slots[pos++]);
+            }
+        }
+    }
+
+    /*
+     * Call visit(index, element) for every allocated element, in index order
+     */
+    template<class Visitor>
+    void for_each(Visitor&& visit) const {
+        size_t pos = 0;
+
+        for (unsigned int word = 0; word < WORD_COUNT; ++word) {
+            for (uint64_t bits = present[word]; bits; bits &= bits - 1) {
+                visit(word * 64 + __builtin_ctzll(bits), static_cast<const T&>(*slots[pos++]));
+            }
+        }
+    }
+
+    /*
+     * Returns the number of allocated elements
+     */
+    size_t size(void) const { return slots.size(); }
+};
+
+#endif // SPARSE_ARRAY_H_
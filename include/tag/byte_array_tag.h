@@ -22,6 +22,7 @@
 
 #include <string>
 #include <vector>
+#include "../array_view.h"
 #include "generic_tag.h"
 
 class byte_array_tag : public generic_tag {
@@ -52,12 +53,12 @@ public:
     /*
      * Byte array tag constructor
      */
-    byte_array_tag(std::vector<char> value) : generic_tag(BYTE_ARRAY) { this->value = value; }
+    byte_array_tag(std::vector<char> value) : generic_tag(BYTE_ARRAY), value(std::move(value)) { return; }
 
     /*
      * Byte array tag constructor
      */
-    byte_array_tag(const std::string& name, std::vector<char> value) : generic_tag(name, BYTE_ARRAY) { this->value = value; }
+    byte_array_tag(const std::string& name, std::vector<char> value) : generic_tag(name, BYTE_ARRAY), value(std::move(value)) { return; }
 
     /*
      * Byte array tag destructor
@@ -114,6 +115,11 @@ public:
      */
     std::vector<char>& get_value(void) { return value; }
 
+    /*
+     * Return a view of a byte array tag's value
+     */
+    array_view<const char> get_view(void) const { return array_view<const char>(value); }
+
     /*
      * Insert a byte into a byte array tag at a given index
      */
@@ -129,10 +135,15 @@ public:
      */
     void set_value(std::vector<char>& value) { this->value = value; }
 
+    /*
+     * Set a byte array tag's value
+     */
+    void set_value(std::vector<char>&& value) { this->value = std::move(value); }
+
     /*
      * Returns a byte array tag value's size
      */
-    size_t size(void) { return value.size(); }
+    size_t size(void) const { return value.size(); }
 
     /*
      * Return a string representation of a byte array tag
@@ -21,6 +21,7 @@
 #define COMPOUND_TAG_H_
 
 #include <string>
+#include <string_view>
 #include <vector>
 #include "generic_tag.h"
 
@@ -119,10 +120,15 @@ public:
      */
     void set_value(std::vector<generic_tag*>& value) { this->value = value; }
 
+    /*
+     * Set a compound tag's value
+     */
+    void set_value(std::vector<generic_tag*>&& value) { this->value = std::move(value); }
+
     /*
      * Returns a compound tag value's size
      */
-    size_t size(void) { return value.size(); }
+    size_t size(void) const { return value.size(); }
 
     /*
      * Return a string representation of a compound tag
@@ -132,7 +138,7 @@ public:
     /*
      * Returns the subtag with the given name;
      */
-    generic_tag* get_subtag(std::string name);
+    generic_tag* get_subtag(std::string_view name);
 
 };
 
@@ -20,6 +20,7 @@
 #ifndef GENERIC_TAG_H_
 #define GENERIC_TAG_H_
 
+#include <atomic>
 #include <sstream>
 #include <string>
 #include <vector>
@@ -39,6 +40,11 @@ public:
      */
     unsigned char type;
 
+    /*
+     * Number of owners sharing this tag (see chunk_tag)
+     */
+    std::atomic<unsigned int> ref_count;
+
     /*
      * Supported tag types
      */
@@ -47,22 +53,22 @@ public:
     /*
      * Generic tag constructor
      */
-    generic_tag(void) : name(""), type(END) { return; }
+    generic_tag(void) : name(""), type(END), ref_count(1) { return; }
 
     /*
      * Generic tag constructor
      */
-    generic_tag(const generic_tag& other) : name(other.name), type(other.type) { return; }
+    generic_tag(const generic_tag& other) : name(other.name), type(other.type), ref_count(1) { return; }
 
     /*
      * Generic tag constructor
      */
-    generic_tag(unsigned char type) : name(""), type(type) { return; }
+    generic_tag(unsigned char type) : name(""), type(type), ref_count(1) { return; }
 
     /*
      * Generic tag constructor
      */
-    generic_tag(const std::string& name, unsigned char type) : name(name), type(type) { return; }
+    generic_tag(const std::string& name, unsigned char type) : name(name), type(type), ref_count(1) { return; }
 
     /*
      * Generic tag destructor
@@ -120,6 +126,21 @@ public:
      */
     unsigned char get_type(void) { return type; }
 
+    /*
+     * Returns true if a generic tag is referenced by more than one owner
+     */
+    bool is_shared(void) { return ref_count.load(std::memory_order_acquire) > 1; }
+
+    /*
+     * Drop a reference to a generic tag, returns true if it was the last one
+     */
+    bool release(void) { return ref_count.fetch_sub(1, std::memory_order_acq_rel) == 1; }
+
+    /*
+     * Add a reference to a generic tag
+     */
+    void retain(void) { ref_count.fetch_add(1, std::memory_order_relaxed); }
+
     /*
      * Set a generic tag's name
      */
@@ -22,6 +22,7 @@
 
 #include <string>
 #include <vector>
+#include "../array_view.h"
 #include "generic_tag.h"
 
 class int_array_tag : public generic_tag {
@@ -52,12 +53,12 @@ public:
     /*
      * Integer array tag constructor
      */
-    int_array_tag(std::vector<int> value) : generic_tag(INT_ARRAY) { this->value = value; }
+    int_array_tag(std::vector<int> value) : generic_tag(INT_ARRAY), value(std::move(value)) { return; }
 
     /*
      * Integer array tag constructor
      */
-    int_array_tag(const std::string& name, std::vector<int> value) : generic_tag(name, INT_ARRAY) { this->value = value; }
+    int_array_tag(const std::string& name, std::vector<int> value) : generic_tag(name, INT_ARRAY), value(std::move(value)) { return; }
 
     /*
      * Integer array tag destructor
@@ -114,6 +115,11 @@ public:
      */
     std::vector<int>& get_value(void) { return value; }
 
+    /*
+     * Return a view of a integer array tag's value
+     */
+    array_view<const int> get_view(void) const { return array_view<const int>(value); }
+
     /*
      * Insert a integer into a integer array tag at a given index
      */
@@ -129,10 +135,15 @@ public:
      */
     void set_value(std::vector<int>& value) { this->value = value; }
 
+    /*
+     * Set a integer array tag's value
+     */
+    void set_value(std::vector<int>&& value) { this->value = std::move(value); }
+
     /*
      * Returns a integer array tag value's size
      */
-    size_t size(void) { return value.size(); }
+    size_t size(void) const { return value.size(); }
 
     /*
      * Return a string representation of a integer array tag
@@ -22,6 +22,7 @@
 
 #include <string>
 #include <vector>
+#include "../array_view.h"
 #include "generic_tag.h"
 
 class list_tag : public generic_tag {
@@ -119,6 +120,11 @@ public:
      */
     std::vector<generic_tag*>& get_value(void) { return value; }
 
+    /*
+     * Return a view of a list tag's value
+     */
+    array_view<generic_tag* const> get_view(void) const { return array_view<generic_tag* const>(value); }
+
     /*
      * Insert a tag into a list tag at a given index
      */
@@ -134,10 +140,15 @@ public:
      */
     void set_value(std::vector<generic_tag*>& value) { this->value = value; }
 
+    /*
+     * Set a list tag's value
+     */
+    void set_value(std::vector<generic_tag*>&& value) { this->value = std::move(value); }
+
     /*
      * Returns a list tag value's size
      */
-    size_t size(void) { return value.size(); }
+    size_t size(void) const { return value.size(); }
 
     /*
      * Return a string representation of a list tag
@@ -25,6 +25,7 @@
 
 #include <string>
 #include <vector>
+#include "../array_view.h"
 #include "generic_tag.h"
 
 class long_array_tag : public generic_tag {
@@ -55,13 +56,12 @@ public:
     /*
      * Long array tag constructor
      */
-    long_array_tag(std::vector<int64_t> value) : generic_tag(LONG_ARRAY) { this->value = value; }
+    long_array_tag(std::vector<int64_t> value) : generic_tag(LONG_ARRAY), value(std::move(value)) { return; }
 
     /*
      * Long array tag constructor
      */
-    long_array_tag(const std::string& name, std::vector<int64_t> value) : generic_tag(name,
-                                                                                      LONG_ARRAY) { this->value = value; }
+    long_array_tag(const std::string& name, std::vector<int64_t> value) : generic_tag(name, LONG_ARRAY), value(std::move(value)) { return; }
 
     /*
      * Long array tag destructor
@@ -103,11 +103,26 @@ public:
      */
     std::vector<char> get_data(bool list_ele);
 
+    /*
+     * Save a long array tag's data to a stream
+     */
+    void get_data(bool list_ele, byte_stream& stream);
+
+    /*
+     * Return the size of a long array tag's data. Equivaluent to get_data().size(), but faster;
+     */
+    unsigned int get_data_size(bool list_ele);
+
     /*
      * Return a integer array tag's value
      */
     std::vector<int64_t>& get_value(void) { return value; }
 
+    /*
+     * Return a view of a long array tag's value
+     */
+    array_view<const int64_t> get_view(void) const { return array_view<const int64_t>(value); }
+
     /*
      * Insert a integer into a integer array tag at a given index
      */
@@ -123,10 +138,15 @@ public:
      */
     void set_value(std::vector<int64_t>& value) { this->value = value; }
 
+    /*
+     * Set a long array tag's value
+     */
+    void set_value(std::vector<int64_t>&& value) { this->value = std::move(value); }
+
     /*
      * Returns a long array tag value's size
      */
-    size_t size(void) { return value.size(); }
+    size_t size(void) const { return value.size(); }
 
     /*
      * Return a string representation of a long array tag
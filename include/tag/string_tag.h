@@ -21,6 +21,7 @@
 #define STRING_TAG_H_
 
 #include <string>
+#include <string_view>
 #include <vector>
 #include "generic_tag.h"
 
@@ -52,7 +53,7 @@ public:
     /*
      * String tag constructor
      */
-    string_tag(const std::string& name, const std::string& value) : generic_tag(name, STRING) { this->value = value; }
+    string_tag(const std::string& name, std::string value) : generic_tag(name, STRING), value(std::move(value)) { return; }
 
     /*
      * String tag destructor
@@ -94,11 +95,21 @@ public:
      */
     std::string& get_value(void) { return value; }
 
+    /*
+     * Return a view of a string tag's value
+     */
+    std::string_view get_view(void) const { return value; }
+
     /*
      * Set a string tag's value
      */
     void set_value(std::string& value) { this->value = value; }
 
+    /*
+     * Set a string tag's value
+     */
+    void set_value(std::string&& value) { this->value = std::move(value); }
+
     /*
      * Return a string representation of a string tag
      */
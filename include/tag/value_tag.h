@@ -0,0 +1,185 @@
+/*
+ * value_tag.h
+ * Copyright (C) 2012 - 2019 David Jolly
+ * ----------------------
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef VALUE_TAG_H_
+#define VALUE_TAG_H_
+
+#include <cstdint>
+#include <string>
+#include <variant>
+#include <vector>
+#include "generic_tag.h"
+
+/*
+ * Devirtualized tag node. Scalars are stored inline, the tag type is the
+ * variant index (matching generic_tag::TYPE) and only compound entries carry
+ * a name, so list elements cost no more than their payload.
+ */
+class value_tag {
+public:
+
+    /*
+     * Named compound tag entry
+     */
+    struct entry;
+
+    /*
+     * Compound tag value
+     */
+    typedef std::vector<entry> compound_value;
+
+    /*
+     * List tag value
+     */
+    struct list_value {
+
+        /*
+         * List element type
+         */
+        char ele_type;
+
+        /*
+         * List elements
+         */
+        std::vector<value_tag> value;
+
+        /*
+         * List value equals operator
+         */
+        bool operator==(const list_value& other) const;
+    };
+
+    /*
+     * Tag value, indexed by generic_tag::TYPE
+     */
+    typedef std::variant<std::monostate, char, short, int, int64_t, float, double, std::vector<char>, std::string,
+        list_value, compound_value, std::vector<int>, std::vector<int64_t>> value_type;
+
+private:
+
+    /*
+     * Tag value
+     */
+    value_type value;
+
+public:
+
+    /*
+     * Value tag constructor
+     */
+    value_tag(void) { return; }
+
+    /*
+     * Value tag constructor
+     */
+    value_tag(const value_type& value) : value(value) { return; }
+
+    /*
+     * Value tag constructor
+     */
+    value_tag(value_type&& value) : value(std::move(value)) { return; }
+
+    /*
+     * Value tag equals operator
+     */
+    bool operator==(const value_tag& other) const;
+
+    /*
+     * Value tag not-equals operator
+     */
+    bool operator!=(const value_tag& other) const { return !(*this == other); }
+
+    /*
+     * Convert a generic tag (recursively) into a value tag
+     */
+    static value_tag from_generic(generic_tag* tag);
+
+    /*
+     * Save a value tag's data to a stream
+     */
+    void get_data(bool list_ele, const std::string& name, byte_stream& stream) const;
+
+    /*
+     * Return a value tag's data
+     */
+    std::vector<char> get_data(bool list_ele, const std::string& name) const;
+
+    /*
+     * Return the size of a value tag's data. Equivaluent to get_data().size(), but faster;
+     */
+    unsigned int get_data_size(bool list_ele, const std::string& name) const;
+
+    /*
+     * Returns the subtag with the given name. Returns NULL if not found or not a compound.
+     */
+    value_tag* get_subtag(const std::string& name);
+
+    /*
+     * Return a value tag's type
+     */
+    unsigned char get_type(void) const { return static_cast<unsigned char>(value.index()); }
+
+    /*
+     * Return a value tag's value
+     */
+    value_type& get_value(void) { return value; }
+
+    /*
+     * Return a value tag's value
+     */
+    const value_type& get_value(void) const { return value; }
+
+    /*
+     * Read a tag payload of a given type from a (big endian) stream
+     */
+    static value_tag parse(byte_stream& stream, char type);
+
+    /*
+     * Convert a value tag (recursively) into a newly allocated generic tag
+     */
+    generic_tag* to_generic(const std::string& name) const;
+
+    /*
+     * Return a string representation of a value tag
+     */
+    std::string to_string(unsigned int tab, const std::string& name) const;
+};
+
+/*
+ * Named compound tag entry
+ */
+struct value_tag::entry {
+
+    /*
+     * Entry name
+     */
+    std::string name;
+
+    /*
+     * Entry value
+     */
+    value_tag value;
+
+    /*
+     * Entry equals operator
+     */
+    bool operator==(const entry& other) const { return name == other.name && value == other.value; }
+};
+
+#endif // VALUE_TAG_H_
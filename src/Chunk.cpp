@@ -0,0 +1,328 @@
+//
+// Created by admin on 19.11.2019.
+//
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include "../include/Chunk.h"
+
+namespace {
+
+std::string const DEFAULT_NAMESPACE = "minecraft:";
+
+//! Drops the "minecraft:" namespace, as Block names historically did
+std::string shortName(std::string const& name) {
+    if (name.compare(0, DEFAULT_NAMESPACE.size(), DEFAULT_NAMESPACE) == 0) {
+        return name.substr(DEFAULT_NAMESPACE.size());
+    }
+    return name;
+}
+
+template<class T>
+void put(std::vector<char>& out, T value) {
+    char const* bytes = reinterpret_cast<char const*>(&value);
+    out.insert(out.end(), bytes, bytes + sizeof(T));
+}
+
+void putString(std::vector<char>& out, std::string const& value) {
+    put<uint16_t>(out, static_cast<uint16_t>(value.size()));
+    out.insert(out.end(), value.begin(), value.end());
+}
+
+//! Bounds checked reads over a writeSections buffer
+class SectionReader {
+public:
+    SectionReader(char const* data, size_t size)
+        : m_Data(data), m_Left(size) {
+    }
+
+    template<class T>
+    bool get(T& value) {
+        return getBytes(&value, sizeof(T));
+    }
+
+    bool getBytes(void* dest, size_t count) {
+        if (count > m_Left) {
+            return false;
+        }
+        std::memcpy(dest, m_Data, count);
+        m_Data += count;
+        m_Left -= count;
+        return true;
+    }
+
+    bool getString(std::string& value) {
+        uint16_t length;
+        if (!get(length) || length > m_Left) {
+            return false;
+        }
+        value.assign(m_Data, length);
+        m_Data += length;
+        m_Left -= length;
+        return true;
+    }
+
+    [[nodiscard]] bool done() const {
+        return !m_Left;
+    }
+
+    [[nodiscard]] size_t remaining() const {
+        return m_Left;
+    }
+
+private:
+    char const* m_Data;
+    size_t m_Left;
+};
+
+}
+
+void Chunk::addBlock(Block& block) {
+    auto const& pos = block.getPos();
+    int32_t localX = pos[0] - m_Origin[0];
+    int32_t localZ = pos[2] - m_Origin[1];
+    if (localX < 0 || localX >= 16 || localZ < 0 || localZ >= 16) {
+        throw std::out_of_range("Block outside of chunk");
+    }
+
+    // Short names come from getBlock, register them under the same state as decoded blocks
+    std::string const& name = block.getName();
+    uint32_t id = block_registry::get_instance().get_id(
+            name.find(':') == std::string::npos ? DEFAULT_NAMESPACE + name : name);
+    uint16_t value = paletteIndexOf(id);
+    Section& section = createSection(pos[1] >> 4);
+    if (!section.present) {
+        section.present = true;
+        section.uniform = paletteIndexOf(block_registry::AIR);
+    }
+    if (section.indices.empty()) {
+        if (section.uniform == value) {
+            return;
+        }
+        section.indices.assign(SECTION_BLOCKS, section.uniform);
+    }
+    section.indices[chunk_section::get_index(localX, pos[1] & 15, localZ)] = value;
+}
+
+void Chunk::addSection(chunk_section const& section) {
+    std::vector<uint32_t> const& palette = section.get_palette();
+    std::vector<uint16_t> remap(palette.size());
+    for (size_t i = 0; i < palette.size(); ++i) {
+        remap[i] = paletteIndexOf(palette[i]);
+    }
+
+    Section& dest = createSection(section.get_y());
+    dest.present = true;
+    if (palette.size() == 1) {
+        dest.uniform = remap[0];
+        dest.indices.clear();
+        dest.indices.shrink_to_fit();
+        return;
+    }
+    uint16_t const* indices = section.get_indices();
+    dest.indices.resize(SECTION_BLOCKS);
+    for (int32_t i = 0; i < SECTION_BLOCKS; ++i) {
+        dest.indices[i] = remap[indices[i]];
+    }
+}
+
+std::optional<uint32_t> Chunk::getBiomeIdAt(int32_t localX, int32_t y, int32_t localZ) const {
+    if (localX < 0 || localX >= 16 || localZ < 0 || localZ >= 16 || m_Biomes.get_cells().empty()) {
+        return {};
+    }
+    return m_Biomes.biome_at(localX, y, localZ);
+}
+
+std::optional<Block> Chunk::getBlock(std::array<int32_t, 3> const& coord) const {
+    auto view = getBlockAt(coord[0] - m_Origin[0], coord[1], coord[2] - m_Origin[1]);
+    if (!view) {
+        return {};
+    }
+
+    return Block(shortName(view->getName()), coord);
+}
+
+std::map<std::array<int32_t, 3>, Block> Chunk::getBlocks() const {
+    std::map<std::array<int32_t, 3>, Block> blocks;
+    for (BlockView view : *this) {
+        blocks.emplace(view.getPos(), Block(shortName(view.getName()), view.getPos()));
+    }
+    return blocks;
+}
+
+std::optional<BlockView> Chunk::getBlockAt(int32_t localX, int32_t y, int32_t localZ) const {
+    int32_t index = getPaletteIndexAt(localX, y, localZ);
+    if (index < 0) {
+        return {};
+    }
+    return BlockView(m_Palette[index], {m_Origin[0] + localX, y, m_Origin[1] + localZ});
+}
+
+std::optional<uint32_t> Chunk::getBlockIdAt(int32_t localX, int32_t y, int32_t localZ) const {
+    int32_t index = getPaletteIndexAt(localX, y, localZ);
+    if (index < 0) {
+        return {};
+    }
+    return m_Palette[index];
+}
+
+int32_t Chunk::getPaletteIndexAt(int32_t localX, int32_t y, int32_t localZ) const {
+    if (localX < 0 || localX >= 16 || localZ < 0 || localZ >= 16) {
+        return -1;
+    }
+    Section const* section = sectionAt(y >> 4);
+    if (!section) {
+        return -1;
+    }
+    if (section->indices.empty()) {
+        return section->uniform;
+    }
+    return section->indices[chunk_section::get_index(localX, y & 15, localZ)];
+}
+
+size_t Chunk::size() const {
+    return std::count_if(m_Sections.begin(), m_Sections.end(), [](Section const& s) { return s.present; }) *
+           static_cast<size_t>(SECTION_BLOCKS);
+}
+
+void Chunk::writeSections(std::vector<char>& out) const {
+    block_registry& registry = block_registry::get_instance();
+    put<int32_t>(out, m_Origin[0]);
+    put<int32_t>(out, m_Origin[1]);
+    put<int32_t>(out, m_MinSection);
+
+    put<uint32_t>(out, static_cast<uint32_t>(m_Palette.size()));
+    for (uint32_t id : m_Palette) {
+        block_state const& state = registry.get_state(id);
+        putString(out, state.get_name());
+        put<uint16_t>(out, static_cast<uint16_t>(state.get_properties().size()));
+        for (auto const& property : state.get_properties()) {
+            putString(out, property.first);
+            putString(out, property.second);
+        }
+    }
+
+    put<uint32_t>(out, static_cast<uint32_t>(m_Sections.size()));
+    for (Section const& section : m_Sections) {
+        put<uint8_t>(out, section.present);
+        put<uint8_t>(out, !section.indices.empty());
+        put<uint16_t>(out, section.uniform);
+        if (!section.indices.empty()) {
+            char const* bytes = reinterpret_cast<char const*>(section.indices.data());
+            out.insert(out.end(), bytes, bytes + SECTION_BLOCKS * sizeof(uint16_t));
+        }
+    }
+}
+
+bool Chunk::readSections(char const* data, size_t size) {
+    SectionReader reader(data, size);
+    std::array<int32_t, 2> origin;
+    int32_t minSection;
+    uint32_t paletteSize, sectionCount;
+    // Counts come from untrusted bytes, each entry needs at least 4 bytes so larger counts are never allocated
+    if (!reader.get(origin[0]) || !reader.get(origin[1]) || !reader.get(minSection) || !reader.get(paletteSize) ||
+        paletteSize > UINT16_MAX + 1u || paletteSize > reader.remaining() / 4) {
+        return false;
+    }
+
+    // Names are registered in this process, the indices refer to palette positions and need no remapping
+    block_registry& registry = block_registry::get_instance();
+    std::vector<uint32_t> palette(paletteSize);
+    for (uint32_t& id : palette) {
+        std::string name;
+        uint16_t propertyCount;
+        if (!reader.getString(name) || !reader.get(propertyCount)) {
+            return false;
+        }
+        block_registry::property_list properties(propertyCount);
+        for (auto& property : properties) {
+            if (!reader.getString(property.first) || !reader.getString(property.second)) {
+                return false;
+            }
+        }
+        id = registry.get_id(name, std::move(properties));
+    }
+
+    if (!reader.get(sectionCount) || sectionCount > reader.remaining() / 4) {
+        return false;
+    }
+    std::vector<Section> sections(sectionCount);
+    for (Section& section : sections) {
+        uint8_t present, dense;
+        if (!reader.get(present) || !reader.get(dense) || !reader.get(section.uniform) ||
+            (present && section.uniform >= paletteSize)) {
+            return false;
+        }
+        section.present = present;
+        if (dense) {
+            section.indices.resize(SECTION_BLOCKS);
+            if (!reader.getBytes(section.indices.data(), SECTION_BLOCKS * sizeof(uint16_t))) {
+                return false;
+            }
+
+            // A plain max reduction vectorizes, max_element does not
+            uint16_t maxIndex = 0;
+            for (uint16_t index : section.indices) {
+                maxIndex = std::max(maxIndex, index);
+            }
+            if (maxIndex >= paletteSize) {
+                return false;
+            }
+        }
+    }
+    if (!reader.done()) {
+        return false;
+    }
+
+    m_Origin = origin;
+    m_MinSection = minSection;
+    m_Palette = std::move(palette);
+    m_Sections = std::move(sections);
+    return true;
+}
+
+uint16_t Chunk::paletteIndexOf(uint32_t id) {
+    // Chunk palettes stay small, a linear scan is cheaper than a map
+    auto it = std::find(m_Palette.begin(), m_Palette.end(), id);
+    if (it != m_Palette.end()) {
+        return static_cast<uint16_t>(it - m_Palette.begin());
+    }
+    if (m_Palette.size() > UINT16_MAX) {
+        throw std::runtime_error("Chunk palette overflow");
+    }
+    m_Palette.push_back(id);
+    return static_cast<uint16_t>(m_Palette.size() - 1);
+}
+
+Chunk::Section& Chunk::createSection(int32_t sectionY) {
+    if (m_Sections.empty()) {
+        m_MinSection = sectionY;
+    }
+
+    // Grow the dense section table downwards or upwards as needed
+    if (sectionY < m_MinSection) {
+        m_Sections.insert(m_Sections.begin(), m_MinSection - sectionY, Section());
+        m_MinSection = sectionY;
+    }
+    size_t index = sectionY - m_MinSection;
+    if (index >= m_Sections.size()) {
+        m_Sections.resize(index + 1);
+    }
+    return m_Sections[index];
+}
+
+Chunk::Section const* Chunk::sectionAt(int32_t sectionY) const {
+    size_t index = static_cast<size_t>(sectionY - m_MinSection);
+    if (sectionY < m_MinSection || index >= m_Sections.size() || !m_Sections[index].present) {
+        return nullptr;
+    }
+    return &m_Sections[index];
+}
+
+BlockView Chunk::viewAt(size_t section, int32_t index) const {
+    Section const& sect = m_Sections[section];
+    uint16_t value = sect.indices.empty() ? sect.uniform : sect.indices[index];
+    return BlockView(m_Palette[value], {m_Origin[0] + (index & 15), m_MinSection * 16 + static_cast<int32_t>(section) * 16 + (index >> 8),
+                                        m_Origin[1] + ((index >> 4) & 15)});
+}
@@ -1,37 +1,158 @@
 #include "../include/ChunkRegistry.h"
 
-ChunkRegistry::ChunkRegistry(const std::string pathToRegionFolder)
-        : m_PathToRegionFolder(pathToRegionFolder) {}
+ChunkRegistry::ChunkRegistry(const std::string pathToRegionFolder, uint32_t fields)
+        : m_PathToRegionFolder(pathToRegionFolder), m_Fields(fields) {}
 
 std::shared_ptr<Chunk> ChunkRegistry::getChunkByBlockCoord(int32_t x, int32_t z) {
-    return getChunk(x / 16, z / 16);
+    return getChunk(region_dim::floor_div(x, region_dim::BLOCK_WIDTH), region_dim::floor_div(z, region_dim::BLOCK_WIDTH));
 }
 
 std::shared_ptr<Chunk> ChunkRegistry::getChunk(int32_t x, int32_t z) {
+    std::shared_ptr<Chunk> chunk;
+    chunk_status::check(tryGetChunk(x, z, chunk), region_dim::floor_mod(x, region_dim::CHUNK_WIDTH),
+                        region_dim::floor_mod(z, region_dim::CHUNK_WIDTH));
+    return chunk;
+}
+
+chunk_status::STATUS ChunkRegistry::tryGetChunk(int32_t x, int32_t z, std::shared_ptr<Chunk> &chunk) {
     auto it = loadedChunks.find({x, z});
     if (it != loadedChunks.end()) {
-        return it->second;
+        m_HotOrder.splice(m_HotOrder.begin(), m_HotOrder, it->second.lru);
+        ++m_Stats.hotHits;
+        chunk = it->second.chunk;
+        return chunk_status::OK;
     }
 
-    int32_t mcaFileX = x / 32;
-    int32_t mcaFileZ = z / 32;
+    // Round towards negative infinity, chunk -1 lives in r.-1.*.mca
+    int32_t mcaFileX = region_dim::floor_div(x, region_dim::CHUNK_WIDTH);
+    int32_t mcaFileZ = region_dim::floor_div(z, region_dim::CHUNK_WIDTH);
+    int32_t localX = region_dim::floor_mod(x, region_dim::CHUNK_WIDTH);
+    int32_t localZ = region_dim::floor_mod(z, region_dim::CHUNK_WIDTH);
     std::stringstream mcaFileName;
     mcaFileName << m_PathToRegionFolder << "/r." << mcaFileX << "." << mcaFileZ << ".mca";
     region_file_reader reader(mcaFileName.str());
-    reader.read(true);
+    reader.set_decode_and_drop(true);
 
-    auto chunk = reader.getChunkAt(x - mcaFileX * 32, z - mcaFileZ * 32);
-    loadedChunks[{x, z}] = chunk;
+    auto loaded = std::make_shared<Chunk>(std::array<int32_t, 2>{localX, localZ});
+    std::vector<char> compressed;
+    chunk_status::STATUS status;
+    shared_chunk_cache::key sharedKey{};
+    bool shared = false;
 
-    return chunk;
+    auto warm = m_WarmChunks.find({x, z});
+    if (warm != m_WarmChunks.end()) {
+        // Warm chunks are decoded from memory, the region file is not touched
+        compressed = std::move(warm->second.compressed);
+        m_WarmBytes -= compressed.size();
+        m_WarmOrder.erase(warm->second.lru);
+        m_WarmChunks.erase(warm);
+        ++m_Stats.warmHits;
+        status = reader.try_load_compressed(localX, localZ, compressed);
+    } else {
+        reader.read(true);
+
+        // Another process may have decoded this version of the chunk already
+        chunk_info* info = m_SharedCache && m_Fields == Chunk::BLOCKS
+                           ? reader.get_region().get_header().find_info_at(localZ * region_dim::CHUNK_WIDTH + localX)
+                           : nullptr;
+        if (info && !info->empty()) {
+            sharedKey = {m_Dimension, x, z, info->get_modified()};
+            shared = true;
+            array_view<const char> data = m_SharedCache->find(sharedKey);
+            if (!data.empty() && loaded->readSections(data.data(), data.size())) {
+                ++m_Stats.sharedHits;
+                addHot({x, z}, loaded, {});
+                chunk = loaded;
+                return chunk_status::OK;
+            }
+        }
+
+        ++m_Stats.misses;
+        status = reader.try_read_compressed(localX, localZ, compressed);
+        if (status == chunk_status::OK) {
+            status = reader.try_load_compressed(localX, localZ, compressed);
+        }
+    }
+
+    if (status == chunk_status::OK) {
+        status = reader.tryReadChunk(loaded, m_Fields);
+    }
+    if (status != chunk_status::OK) {
+        return status;
+    }
+
+    if (shared) {
+        std::vector<char> data;
+        loaded->writeSections(data);
+        m_SharedCache->insert(sharedKey, data);
+    }
+    addHot({x, z}, loaded, std::move(compressed));
+    chunk = loaded;
+
+    return chunk_status::OK;
 }
 
 std::optional<Block> ChunkRegistry::getBlock(const std::array<int32_t, 3> &coord) const {
-    auto it = loadedChunks.find({coord[0] / 16, coord[2] / 16});
+    auto it = loadedChunks.find({region_dim::floor_div(coord[0], region_dim::BLOCK_WIDTH),
+                                 region_dim::floor_div(coord[2], region_dim::BLOCK_WIDTH)});
 
     if (it == loadedChunks.end()) {
         return {};
     }
 
-    return it->second->getBlock(coord);
+    return it->second.chunk->getBlock(coord);
+}
+
+void ChunkRegistry::setSharedCache(std::shared_ptr<shared_chunk_cache> cache, int32_t dimension) {
+    m_SharedCache = std::move(cache);
+    m_Dimension = dimension;
+}
+
+void ChunkRegistry::setCacheLimits(size_t hotChunks, size_t warmBytes) {
+    m_HotLimit = hotChunks;
+    m_WarmLimit = warmBytes;
+    trim();
+}
+
+void ChunkRegistry::addHot(ChunkPos const& pos, std::shared_ptr<Chunk> const& chunk, std::vector<char> compressed) {
+    // Compressed bytes are only worth keeping if the chunk can be demoted to the warm tier
+    if (!m_HotLimit || compressed.size() > m_WarmLimit) {
+        compressed.clear();
+        compressed.shrink_to_fit();
+    }
+    m_HotBytes += compressed.size();
+    m_HotOrder.push_front(pos);
+    loadedChunks[pos] = HotChunk{chunk, std::move(compressed), m_HotOrder.begin()};
+    trim();
+}
+
+void ChunkRegistry::trim() {
+    while (m_HotLimit && loadedChunks.size() > m_HotLimit) {
+        ChunkPos pos = m_HotOrder.back();
+        m_HotOrder.pop_back();
+        auto it = loadedChunks.find(pos);
+        size_t size = it->second.compressed.size();
+        m_HotBytes -= size;
+        if (size) {
+            m_WarmOrder.push_front(pos);
+            m_WarmBytes += size;
+            m_WarmChunks[pos] = WarmChunk{std::move(it->second.compressed), m_WarmOrder.begin()};
+        }
+        loadedChunks.erase(it);
+    }
+
+    // Both tiers share the byte budget: warm chunks go first, then hot chunks lose their demotion copies
+    while (m_WarmBytes + m_HotBytes > m_WarmLimit && !m_WarmOrder.empty()) {
+        auto it = m_WarmChunks.find(m_WarmOrder.back());
+        m_WarmOrder.pop_back();
+        m_WarmBytes -= it->second.compressed.size();
+        m_WarmChunks.erase(it);
+    }
+    // The most recently used chunks give up their copies first, the next ones to be demoted keep them
+    for (auto pos = m_HotOrder.begin(); m_HotBytes > m_WarmLimit && pos != m_HotOrder.end(); ++pos) {
+        std::vector<char>& compressed = loadedChunks[*pos].compressed;
+        m_HotBytes -= compressed.size();
+        compressed.clear();
+        compressed.shrink_to_fit();
+    }
 }
@@ -1,7 +1,1787 @@
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 #include "zlib.h"
+#include "../include/Chunk.h"
+#include "../include/ChunkRegistry.h"
+#include "../include/array_view.h"
+#include "../include/biome_grid.h"
+#include "../include/biome_registry.h"
+#include "../include/block_histogram.h"
+#include "../include/block_registry.h"
+#include "../include/block_search.h"
+#include "../include/box_query.h"
+#include "../include/byte_stream.h"
+#include "../include/chunk_format.h"
+#include "../include/chunk_section.h"
+#include "../include/chunk_sidecar.h"
+#include "../include/chunk_status.h"
+#include "../include/chunk_surface.h"
+#include "../include/chunk_tag.h"
+#include "../include/chunk_view.h"
+#include "../include/compression.h"
+#include "../include/incremental_scan.h"
+#include "../include/legacy_section.h"
+#include "../include/nibble_array.h"
+#include "../include/packed_array.h"
+#include "../include/parallel.h"
+#include "../include/region_dim.h"
+#include "../include/region_file_reader.h"
+#include "../include/shared_chunk_cache.h"
+#include "../include/sparse_array.h"
+#include "../include/tag/byte_tag.h"
+#include "../include/tag/compound_tag.h"
+#include "../include/tag/long_array_tag.h"
+#include "../include/tag/string_tag.h"
+#include "../include/tag/value_tag.h"
+
+// Behavior checks for libanvil, run through ctest. Every failed check is reported, the exit code is the
+// number of failures (capped).
+
+namespace {
+
+int failures = 0;
+
+void check(bool passed, char const* expression, char const* file, int line) {
+    if (!passed) {
+        std::cerr << file << ":" << line << ": check failed: " << expression << std::endl;
+        ++failures;
+    }
+}
+
+#define CHECK(expression) check((expression), #expression, __FILE__, __LINE__)
+
+// NBT builders over value_tag
+value_tag::entry field(std::string const& name, value_tag value) {
+    return value_tag::entry{name, std::move(value)};
+}
+
+value_tag compound(std::vector<value_tag::entry> entries) {
+    return value_tag(value_tag::value_type(std::in_place_index<generic_tag::COMPOUND>, std::move(entries)));
+}
+
+value_tag list(char type, std::vector<value_tag> elements) {
+    return value_tag(value_tag::value_type(std::in_place_index<generic_tag::LIST>,
+                                           value_tag::list_value{type, std::move(elements)}));
+}
+
+template<size_t TYPE, class T>
+value_tag scalar(T value) {
+    return value_tag(value_tag::value_type(std::in_place_index<TYPE>, value));
+}
+
+value_tag sampleTree() {
+    return compound({
+            field("int", scalar<generic_tag::INT>(7)),
+            field("string", scalar<generic_tag::STRING>(std::string("stone"))),
+            field("list", list(generic_tag::INT, {scalar<generic_tag::INT>(1), scalar<generic_tag::INT>(2)})),
+            field("longs", scalar<generic_tag::LONG_ARRAY>(std::vector<int64_t>{1, -2, INT64_MAX})),
+            field("nested", compound({field("byte", scalar<generic_tag::BYTE>(char(3)))})),
+    });
+}
+
+// Pack indices the way the game does, one index at a time
+std::vector<int64_t> packReference(std::vector<uint16_t> const& values, unsigned int bits, bool padded) {
+    std::vector<uint64_t> longs;
+    if (padded) {
+        unsigned int perLong = 64 / bits;
+        longs.resize((values.size() + perLong - 1) / perLong);
+        for (size_t i = 0; i < values.size(); ++i) {
+            longs[i / perLong] |= static_cast<uint64_t>(values[i]) << (i % perLong * bits);
+        }
+    } else {
+        longs.resize((values.size() * bits + 63) / 64);
+        for (size_t i = 0; i < values.size(); ++i) {
+            size_t bit = i * bits;
+            longs[bit / 64] |= static_cast<uint64_t>(values[i]) << (bit % 64);
+            if (bit % 64 + bits > 64) {
+                longs[bit / 64 + 1] |= static_cast<uint64_t>(values[i]) >> (64 - bit % 64);
+            }
+        }
+    }
+    return std::vector<int64_t>(longs.begin(), longs.end());
+}
+
+unsigned int bitsFor(size_t paletteSize) {
+    unsigned int bits = 4;
+    while ((static_cast<size_t>(1) << bits) < paletteSize) {
+        ++bits;
+    }
+    return bits;
+}
+
+value_tag paletteEntry(std::string const& name, std::vector<std::pair<std::string, std::string>> const& properties = {}) {
+    std::vector<value_tag::entry> entries{field("Name", scalar<generic_tag::STRING>(name))};
+    if (!properties.empty()) {
+        std::vector<value_tag::entry> values;
+        for (auto const& property : properties) {
+            values.push_back(field(property.first, scalar<generic_tag::STRING>(property.second)));
+        }
+        entries.push_back(field("Properties", compound(std::move(values))));
+    }
+    return compound(std::move(entries));
+}
+
+// Section compound in a generation's layout, indices ordered (y * 16 + z) * 16 + x
+value_tag sectionTag(chunk_format::GENERATION generation, int y, std::vector<value_tag> palette,
+                     std::vector<uint16_t> const& indices) {
+    std::vector<int64_t> states = packReference(indices, bitsFor(palette.size()), generation >= chunk_format::PADDED);
+    bool single = palette.size() == 1;
+    value_tag paletteList = list(generic_tag::COMPOUND, std::move(palette));
+    std::vector<value_tag::entry> entries{field("Y", scalar<generic_tag::BYTE>(static_cast<char>(y)))};
+    if (generation == chunk_format::ROOT_SECTIONS) {
+        std::vector<value_tag::entry> blockStates{field("palette", std::move(paletteList))};
+        if (!single) {
+            blockStates.push_back(field("data", scalar<generic_tag::LONG_ARRAY>(std::move(states))));
+        }
+        entries.push_back(field("block_states", compound(std::move(blockStates))));
+    } else {
+        entries.push_back(field("Palette", std::move(paletteList)));
+        entries.push_back(field("BlockStates", scalar<generic_tag::LONG_ARRAY>(std::move(states))));
+    }
+    return compound(std::move(entries));
+}
+
+// Chunk root in the layout of a DataVersion, sections come from sectionTag
+value_tag chunkRoot(int dataVersion, int x, int z, std::vector<value_tag> sections) {
+    value_tag sectionList = list(generic_tag::COMPOUND, std::move(sections));
+    if (chunk_format::get_generation(dataVersion) == chunk_format::ROOT_SECTIONS) {
+        return compound({field("DataVersion", scalar<generic_tag::INT>(dataVersion)),
+                         field("xPos", scalar<generic_tag::INT>(x)), field("yPos", scalar<generic_tag::INT>(-4)),
+                         field("zPos", scalar<generic_tag::INT>(z)), field("sections", std::move(sectionList))});
+    }
+    return compound({field("DataVersion", scalar<generic_tag::INT>(dataVersion)),
+                     field("Level", compound({field("xPos", scalar<generic_tag::INT>(x)), field("zPos", scalar<generic_tag::INT>(z)),
+                                              field("Sections", std::move(sectionList))}))});
+}
+
+void addField(value_tag& compoundTag, std::string const& name, value_tag value) {
+    std::get<generic_tag::COMPOUND>(compoundTag.get_value()).push_back(field(name, std::move(value)));
+}
+
+// Chunk body as stored in a region file, after the length and compression type
+struct RegionChunk {
+    std::vector<char> payload;
+    char type = 2;
+    int32_t modified = 1;
+};
+
+RegionChunk zlibChunk(value_tag const& root, int32_t modified = 1) {
+    RegionChunk chunk;
+    chunk.payload = root.get_data(false, "");
+    compression::deflate_(chunk.payload);
+    chunk.modified = modified;
+    return chunk;
+}
+
+void putBigEndian(std::vector<char>& out, size_t offset, uint32_t value) {
+    for (int i = 0; i < 4; ++i) {
+        out[offset + i] = static_cast<char>(value >> (24 - i * 8));
+    }
+}
+
+// Writes a region file holding chunks by header index (x + z * 32), sectors are laid out in index order
+void writeRegion(std::string const& path, std::map<unsigned int, RegionChunk> const& chunks) {
+    std::vector<char> file(2 * 4096);
+    for (auto const& entry : chunks) {
+        size_t sector = file.size() / 4096;
+        size_t sectors = (entry.second.payload.size() + 5 + 4095) / 4096;
+        putBigEndian(file, entry.first * 4, static_cast<uint32_t>(sector << 8 | sectors));
+        putBigEndian(file, 4096 + entry.first * 4, static_cast<uint32_t>(entry.second.modified));
+        file.resize(file.size() + 5);
+        putBigEndian(file, file.size() - 5, static_cast<uint32_t>(entry.second.payload.size() + 1));
+        file.back() = entry.second.type;
+        file.insert(file.end(), entry.second.payload.begin(), entry.second.payload.end());
+        file.resize((sector + sectors) * 4096);
+    }
+    std::ofstream(path, std::ios::binary).write(file.data(), static_cast<std::streamsize>(file.size()));
+}
+
+// Per-run scratch directory, removed by main
+std::filesystem::path scratchDirectory() {
+    static std::filesystem::path directory = [] {
+        std::filesystem::path path = std::filesystem::temp_directory_path() / ("libanvil_test_" + std::to_string(::getpid()));
+        std::filesystem::create_directories(path);
+        return path;
+    }();
+    return directory;
+}
+
+std::string scratchPath(std::string const& name) {
+    return (scratchDirectory() / name).string();
+}
+
+// Decodes a section built with sectionTag, the exception type thrown (if any) is returned through error
+bool decodeSection(value_tag const& tag, chunk_format::GENERATION generation, chunk_section& section,
+                   std::string* error = nullptr) {
+    compound_tag* generic = static_cast<compound_tag*>(tag.to_generic(""));
+    bool decoded = false;
+    try {
+        decoded = chunk_section::decode(generic, generation, section);
+    } catch (std::out_of_range const&) {
+        if (error) {
+            *error = "out_of_range";
+        }
+    } catch (std::runtime_error const&) {
+        if (error) {
+            *error = "runtime_error";
+        }
+    }
+    chunk_tag::clean_tag(generic);
+    return decoded;
+}
+
+void testValueTag() {
+    value_tag root = sampleTree();
+
+    // serialized size matches the data, and the data parses back to an equal tree
+    std::vector<char> data = root.get_data(false, "root");
+    CHECK(data.size() == root.get_data_size(false, "root"));
+    std::vector<char> copy = data;
+    byte_stream stream(std::move(copy));
+    char type;
+    short nameLength;
+    stream >> type;
+    stream >> nameLength;
+    stream.set_position(stream.get_position() + nameLength);
+    CHECK(type == generic_tag::COMPOUND);
+    CHECK(value_tag::parse(stream, type) == root);
+
+    // conversion to generic tags and back is lossless
+    generic_tag* generic = root.to_generic("root");
+    CHECK(generic->get_data(false) == data);
+    CHECK(value_tag::from_generic(generic) == root);
+    chunk_tag::clean_tag(generic);
+
+    value_tag other = compound({field("int", scalar<generic_tag::INT>(8))});
+    CHECK(other != root);
+    CHECK(root.get_subtag("nested") != nullptr);
+    CHECK(root.get_subtag("missing") == nullptr);
+
+    // corrupt lengths and short reads fail with runtime_error, before anything is allocated
+    auto parseFails = [](std::vector<char> bytes, char type) {
+        byte_stream stream(std::move(bytes));
+        try {
+            value_tag::parse(stream, type);
+        } catch (std::runtime_error const&) {
+            return true;
+        }
+        return false;
+    };
+    CHECK(parseFails({0x7f, -1, -1, -1, 1, 2, 3}, generic_tag::BYTE_ARRAY));
+    CHECK(parseFails({-1, -1, -1, -1}, generic_tag::INT_ARRAY));
+    CHECK(parseFails({0, 0x10, 0, 0, 0, 0}, generic_tag::LONG_ARRAY));
+    CHECK(parseFails({generic_tag::INT, 0x7f, -1, -1, -1, 0, 0, 0, 1}, generic_tag::LIST));
+    CHECK(parseFails({0, 1}, generic_tag::INT));
+    CHECK(parseFails({0, 0, 0, 1, 0, 0}, generic_tag::LONG));
+}
+
+void testChunkTagSharing() {
+    value_tag tree = sampleTree();
+
+    // the constructor adopts the compound's subtrees instead of sharing them
+    compound_tag* root = static_cast<compound_tag*>(tree.to_generic(""));
+    chunk_tag original(*root);
+    delete root;
+    for (generic_tag* tag : original.get_root_tag().get_value()) {
+        CHECK(!tag->is_shared());
+    }
+
+    // copies share subtrees until one side asks for a unique tag
+    chunk_tag copy(original);
+    CHECK(original.get_root_tag().get_subtag("nested")->is_shared());
+    unsigned long revision = copy.get_revision();
+    generic_tag* byte = copy.get_unique_sub_tag({"nested", "byte"});
+    CHECK(byte != nullptr && byte->get_type() == generic_tag::BYTE);
+    static_cast<byte_tag*>(byte)->set_value(9);
+    CHECK(copy.get_revision() != revision);
+    CHECK(!original.get_root_tag().get_subtag("nested")->is_shared());
+    CHECK(original.get_root_tag().get_subtag("int")->is_shared());
+    CHECK(value_tag::from_generic(&original.get_root_tag()) == tree);
+    CHECK(value_tag::from_generic(&copy.get_root_tag()) != tree);
+    CHECK(copy.get_unique_sub_tag({"nested", "missing"}) == nullptr);
+
+    // set_root_tag adopts as well
+    chunk_tag adopted;
+    root = static_cast<compound_tag*>(tree.to_generic(""));
+    adopted.set_root_tag(*root);
+    delete root;
+    CHECK(!adopted.get_root_tag().get_subtag("nested")->is_shared());
+    CHECK(value_tag::from_generic(&adopted.get_root_tag()) == tree);
+}
+
+void testMoveAwareTags() {
+    // array payloads are moved into the tag and viewed in place
+    std::vector<int64_t> longs(1000, 42);
+    int64_t const* data = longs.data();
+    long_array_tag tag("states", std::move(longs));
+    array_view<const int64_t> view = tag.get_view();
+    CHECK(view.data() == data);
+    CHECK(view.size() == 1000 && view[999] == 42);
+    CHECK(view.sub_view(10, 5).data() == data + 10);
+    bool threw = false;
+    try {
+        (void) view.at(1000);
+    } catch (std::out_of_range const&) {
+        threw = true;
+    }
+    CHECK(threw);
+
+    string_tag name("Name", std::string("minecraft:stone"));
+    CHECK(name.get_view() == "minecraft:stone");
+
+    // deflate and inflate round trip in place
+    std::vector<char> payload(100000);
+    for (size_t i = 0; i < payload.size(); ++i) {
+        payload[i] = static_cast<char>((i * 7919) >> 5);
+    }
+    std::vector<char> packed = payload;
+    CHECK(compression::deflate_(packed));
+    CHECK(packed.size() < payload.size());
+    CHECK(compression::inflate_(packed));
+    CHECK(packed == payload);
+}
+
+void testSectionDecode() {
+    block_registry& registry = block_registry::get_instance();
+    std::vector<uint16_t> indices(chunk_section::BLOCK_COUNT);
+    for (size_t i = 0; i < indices.size(); ++i) {
+        indices[i] = static_cast<uint16_t>((i * 31 + i / 256) % 3);
+    }
+    uint32_t ids[] = {registry.get_id("minecraft:air"), registry.get_id("minecraft:stone"),
+                      registry.get_id("minecraft:oak_log", {{"axis", "y"}})};
+
+    for (chunk_format::GENERATION generation : {chunk_format::FLATTENED, chunk_format::PADDED, chunk_format::ROOT_SECTIONS}) {
+        value_tag tag = sectionTag(generation, -2, {paletteEntry("minecraft:air"), paletteEntry("minecraft:stone"),
+                                                     paletteEntry("minecraft:oak_log", {{"axis", "y"}})}, indices);
+        chunk_section section;
+        CHECK(decodeSection(tag, generation, section));
+        CHECK(section.get_y() == -2);
+        CHECK(section.get_palette() == std::vector<uint32_t>(ids, ids + 3));
+        bool same = true;
+        for (unsigned int y = 0; y < 16; ++y) {
+            for (unsigned int z = 0; z < 16; ++z) {
+                for (unsigned int x = 0; x < 16; ++x) {
+                    same &= section.get_id_at(x, y, z) == ids[indices[chunk_section::get_index(x, y, z)]];
+                }
+            }
+        }
+        CHECK(same);
+    }
+
+    // wide palettes span longs before 1.16
+    std::vector<value_tag> wide;
+    for (int i = 0; i < 40; ++i) {
+        wide.push_back(paletteEntry("test:block_" + std::to_string(i)));
+    }
+    std::vector<uint16_t> wideIndices(chunk_section::BLOCK_COUNT);
+    for (size_t i = 0; i < wideIndices.size(); ++i) {
+        wideIndices[i] = static_cast<uint16_t>(i * 13 % 40);
+    }
+    chunk_section section;
+    CHECK(decodeSection(sectionTag(chunk_format::FLATTENED, 3, wide, wideIndices), chunk_format::FLATTENED, section));
+    CHECK(std::equal(wideIndices.begin(), wideIndices.end(), section.get_indices()));
+
+    // single entry palettes carry no data
+    CHECK(decodeSection(sectionTag(chunk_format::ROOT_SECTIONS, 0, {paletteEntry("minecraft:stone")}, indices),
+                        chunk_format::ROOT_SECTIONS, section));
+    CHECK(section.get_id_at(5, 5, 5) == ids[1]);
+
+    // malformed sections throw
+    std::string error;
+    value_tag truncated = sectionTag(chunk_format::PADDED, 0, wide, wideIndices);
+    std::get<generic_tag::LONG_ARRAY>(truncated.get_subtag("BlockStates")->get_value()).pop_back();
+    CHECK(!decodeSection(truncated, chunk_format::PADDED, section, &error) && error == "runtime_error");
+    std::vector<uint16_t> outOfRange = indices;
+    outOfRange[100] = 3;
+    error.clear();
+    CHECK(!decodeSection(sectionTag(chunk_format::PADDED, 0, {paletteEntry("minecraft:air"), paletteEntry("minecraft:stone"),
+                                                              paletteEntry("minecraft:dirt")}, outOfRange),
+                         chunk_format::PADDED, section, &error) && error == "out_of_range");
+
+    // a Y of another type is skipped like a missing one
+    value_tag intY = sectionTag(chunk_format::ROOT_SECTIONS, 0, {paletteEntry("minecraft:air"), paletteEntry("minecraft:stone")},
+                                indices);
+    *intY.get_subtag("Y") = scalar<generic_tag::INT>(0);
+    error.clear();
+    CHECK(!decodeSection(intY, chunk_format::ROOT_SECTIONS, section, &error) && error.empty());
+    compound_tag* generic = static_cast<compound_tag*>(intY.to_generic(""));
+    std::vector<block_search::match> matches;
+    block_search::find_in_section(generic, chunk_format::ROOT_SECTIONS, 0, 0, {"minecraft:stone"}, matches);
+    chunk_tag::clean_tag(generic);
+    CHECK(matches.empty());
+}
+
+void testPackedArray() {
+    uint32_t seed = 12345;
+    auto next = [&seed]() {
+        seed = seed * 1103515245 + 12345;
+        return seed >> 8;
+    };
+
+    for (unsigned int bits = 1; bits <= packed_array::MAX_BITS; ++bits) {
+        for (bool padded : {false, true}) {
+            for (unsigned int count : {1u, 37u, 4096u}) {
+                std::vector<uint16_t> values(count);
+                for (uint16_t& value : values) {
+                    value = static_cast<uint16_t>(next() & ((1u << bits) - 1));
+                }
+                std::vector<int64_t> data = packReference(values, bits, padded);
+                CHECK(packed_array::long_count(bits, padded, count) == data.size());
+                std::vector<uint16_t> unpacked(count);
+                packed_array::unpack(data, bits, padded, unpacked.data(), count);
+                CHECK(unpacked == values);
+                bool same = true;
+                for (unsigned int i = 0; i < count; ++i) {
+                    same &= packed_array::get(data, bits, padded, i) == values[i];
+                }
+                CHECK(same);
+            }
+        }
+    }
+
+    // count and find against scalar loops, across the vector and fallback paths
+    std::vector<uint16_t> values(4099);
+    for (unsigned int range : {3u, packed_array::MAX_COUNT_VALUES, 300u, 5000u}) {
+        for (uint16_t& value : values) {
+            value = static_cast<uint16_t>(next() % range);
+        }
+        std::vector<uint32_t> tally(range, 1), expected(range, 1);
+        for (uint16_t value : values) {
+            ++expected[value];
+        }
+        packed_array::count(values.data(), static_cast<unsigned int>(values.size()), tally.data(), range);
+        CHECK(tally == expected);
+
+        for (unsigned int targetCount : {1u, 3u, packed_array::MAX_FIND_TARGETS, 12u}) {
+            std::vector<uint16_t> targets;
+            for (unsigned int i = 0; i < targetCount; ++i) {
+                targets.push_back(static_cast<uint16_t>(next() % range));
+            }
+            std::vector<uint32_t> found(values.size()), reference;
+            for (uint32_t i = 0; i < values.size(); ++i) {
+                if (std::find(targets.begin(), targets.end(), values[i]) != targets.end()) {
+                    reference.push_back(i);
+                }
+            }
+            found.resize(packed_array::find(values.data(), static_cast<unsigned int>(values.size()),
+                                            array_view<const uint16_t>(targets), found.data()));
+            CHECK(found == reference);
+        }
+    }
+
+    // long runs overflow signed 16-bit lane counters, and span more than one flush
+    std::vector<uint16_t> runs(16u * 65535u + 640000u, 0);
+    for (size_t i = 0; i < runs.size(); i += 3) {
+        runs[i] = 1;
+    }
+    uint32_t counted[2] = {}, ones = static_cast<uint32_t>((runs.size() + 2) / 3);
+    packed_array::count(runs.data(), static_cast<unsigned int>(runs.size()), counted, 2);
+    CHECK(counted[1] == ones && counted[0] == runs.size() - ones);
+    std::vector<uint16_t> zeros(640000, 0);
+    counted[0] = 0;
+    packed_array::count(zeros.data(), static_cast<unsigned int>(zeros.size()), counted, 1);
+    CHECK(counted[0] == zeros.size());
+}
+
+void testChunkFormat() {
+    CHECK(chunk_format::get_generation(-1) == chunk_format::LEGACY);
+    CHECK(chunk_format::get_generation(chunk_format::FLATTENED_VERSION - 1) == chunk_format::LEGACY);
+    CHECK(chunk_format::get_generation(chunk_format::FLATTENED_VERSION) == chunk_format::FLATTENED);
+    CHECK(chunk_format::get_generation(chunk_format::PADDED_VERSION - 1) == chunk_format::FLATTENED);
+    CHECK(chunk_format::get_generation(chunk_format::PADDED_VERSION) == chunk_format::PADDED);
+    CHECK(chunk_format::get_generation(chunk_format::ROOT_SECTIONS_VERSION - 1) == chunk_format::PADDED);
+    CHECK(chunk_format::get_generation(chunk_format::ROOT_SECTIONS_VERSION) == chunk_format::ROOT_SECTIONS);
+
+    for (int version : {chunk_format::FLATTENED_VERSION, chunk_format::ROOT_SECTIONS_VERSION}) {
+        compound_tag* root = static_cast<compound_tag*>(chunkRoot(version, -3, 7, {}).to_generic(""));
+        chunk_format::GENERATION generation = chunk_format::get_generation(chunk_format::get_data_version(*root));
+        int x = 0, z = 0, y = 1;
+        CHECK(chunk_format::get_data_version(*root) == version);
+        CHECK(chunk_format::get_position(*root, generation, x, z) && x == -3 && z == 7);
+        CHECK(chunk_format::get_sections(*root, generation) != nullptr);
+        CHECK(chunk_format::get_min_y(*root, generation, y) && y == (version == chunk_format::ROOT_SECTIONS_VERSION ? -64 : 0));
+        // the other layout finds nothing
+        CHECK(chunk_format::get_sections(*root, generation == chunk_format::ROOT_SECTIONS ? chunk_format::PADDED
+                                                                                           : chunk_format::ROOT_SECTIONS) == nullptr);
+        chunk_tag::clean_tag(root);
+    }
+
+    compound_tag* old = static_cast<compound_tag*>(compound({}).to_generic(""));
+    CHECK(chunk_format::get_data_version(*old) == -1);
+    chunk_tag::clean_tag(old);
+}
+
+void testChunkBlocks() {
+    block_registry& registry = block_registry::get_instance();
+    Chunk chunk({2, -1});
+    Block stone("stone", {33, 70, -10});
+    chunk.addBlock(stone);
+    CHECK(chunk.size() == static_cast<size_t>(Chunk::SECTION_BLOCKS));
+    CHECK(chunk.getBlockIdAt(1, 70, 6) == registry.get_id("minecraft:stone"));
+    CHECK(chunk.getBlockIdAt(0, 70, 6) == registry.get_id("minecraft:air"));
+    CHECK(!chunk.getBlockIdAt(1, 90, 6));
+
+    // names read back feed straight into addBlock
+    std::optional<Block> read = chunk.getBlock({33, 70, -10});
+    CHECK(read && read->getName() == "stone");
+    Block copy(read->getName(), {34, 70, -10});
+    chunk.addBlock(copy);
+    CHECK(chunk.getBlockIdAt(2, 70, 6) == registry.get_id("minecraft:stone"));
+    Block modded("mod:thing", {35, 70, -10});
+    chunk.addBlock(modded);
+    CHECK(chunk.getBlockAt(3, 70, 6)->getName() == "mod:thing");
+    CHECK(chunk.getPalette().size() == 3);
+
+    std::map<std::array<int32_t, 3>, Block> blocks = chunk.getBlocks();
+    CHECK(blocks.size() == chunk.size());
+    CHECK(blocks.at({34, 70, -10}).getName() == "stone");
+    CHECK(blocks.at({35, 70, -10}).getName() == "mod:thing");
+    size_t visited = 0;
+    for (BlockView view : chunk) {
+        visited += view.getPos()[1] == 70 && view.getPos()[2] == -10 && view.getPos()[0] <= 35 ? 1 : 0;
+    }
+    CHECK(visited == 4);
+
+    // sections are remapped into the chunk palette
+    std::vector<uint16_t> indices(chunk_section::BLOCK_COUNT);
+    for (size_t i = 0; i < indices.size(); ++i) {
+        indices[i] = static_cast<uint16_t>(i % 2);
+    }
+    chunk_section section;
+    CHECK(decodeSection(sectionTag(chunk_format::PADDED, 1, {paletteEntry("minecraft:dirt"), paletteEntry("mod:thing")}, indices),
+                        chunk_format::PADDED, section));
+    chunk.addSection(section);
+    CHECK(chunk.size() == 2 * static_cast<size_t>(Chunk::SECTION_BLOCKS));
+    CHECK(chunk.getPalette().size() == 4);
+    CHECK(chunk.getPaletteIndexAt(1, 16, 0) == 2);
+    CHECK(chunk.getBlock({32, 16, -16})->getName() == "dirt");
+}
+
+void testBlockRegistry() {
+    block_registry& registry = block_registry::get_instance();
+    CHECK(registry.get_id("minecraft:air") == block_registry::AIR);
+    CHECK(registry.is_air(block_registry::AIR));
+
+    size_t size = registry.size();
+    uint32_t id = registry.get_id("test:registry_block");
+    CHECK(id == size && registry.size() == size + 1);
+    CHECK(registry.get_id("test:registry_block") == id);
+    CHECK(registry.get_name(id) == "test:registry_block");
+    CHECK(registry.get_state(id).get_id() == id);
+
+    compound_tag* entry = static_cast<compound_tag*>(paletteEntry("test:registry_block").to_generic(""));
+    CHECK(registry.get_id(entry) == id);
+    chunk_tag::clean_tag(entry);
+
+    // concurrent registration hands every thread the same ids
+    std::vector<std::vector<uint32_t>> seen(4);
+    std::vector<std::thread> threads;
+    for (std::vector<uint32_t>& ids : seen) {
+        threads.emplace_back([&registry, &ids]() {
+            for (int i = 0; i < 200; ++i) {
+                ids.push_back(registry.get_id("test:threaded_" + std::to_string(i)));
+            }
+        });
+    }
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+    CHECK(seen[0] == seen[1] && seen[0] == seen[2] && seen[0] == seen[3]);
+    CHECK(registry.size() == size + 201);
+    CHECK(registry.get_name(seen[0][199]) == "test:threaded_199");
+}
+
+void testBlockStates() {
+    block_registry& registry = block_registry::get_instance();
+
+    // property order does not matter, entries are stored sorted
+    uint32_t id = registry.get_id("minecraft:oak_stairs", {{"half", "top"}, {"facing", "east"}, {"waterlogged", "false"}});
+    CHECK(registry.get_id("minecraft:oak_stairs", {{"waterlogged", "false"}, {"facing", "east"}, {"half", "top"}}) == id);
+    CHECK(registry.get_id("minecraft:oak_stairs", {{"half", "bottom"}, {"facing", "east"}, {"waterlogged", "false"}}) != id);
+    block_state const& state = registry.get_state(id);
+    CHECK(state.get_properties().front().first == "facing" && state.get_properties().back().first == "waterlogged");
+    CHECK(state.to_string() == "minecraft:oak_stairs[facing=east,half=top,waterlogged=false]");
+
+    block_state::key_type half = registry.find_key("half");
+    CHECK(half != block_registry::NO_KEY && registry.get_key_name(half) == "half");
+    CHECK(state.get_property(half) && *state.get_property(half) == "top");
+    CHECK(state.get_property("facing") && *state.get_property("facing") == "east");
+    CHECK(!state.get_property("axis"));
+    CHECK(registry.find_key("test:never_used") == block_registry::NO_KEY);
+
+    // palette entries decode to the same hash-consed state
+    compound_tag* entry = static_cast<compound_tag*>(paletteEntry("minecraft:oak_stairs",
+            {{"waterlogged", "false"}, {"half", "top"}, {"facing", "east"}}).to_generic(""));
+    CHECK(registry.get_id(entry) == id);
+    CHECK(&registry.get_state(registry.get_id(entry)) == &state);
+    chunk_tag::clean_tag(entry);
+
+    CHECK(registry.is_air(registry.get_id("minecraft:cave_air")));
+    CHECK(!registry.is_air(registry.get_id("minecraft:stone")));
+}
+
+void testBlockSearch() {
+    std::vector<uint16_t> indices(chunk_section::BLOCK_COUNT, 0);
+    indices[chunk_section::get_index(3, 4, 5)] = 1;
+    indices[chunk_section::get_index(15, 15, 15)] = 1;
+    indices[chunk_section::get_index(0, 0, 1)] = 2;
+    std::vector<uint16_t> flatIndices(chunk_section::BLOCK_COUNT, 1);
+    flatIndices[chunk_section::get_index(7, 2, 9)] = 0;
+
+    std::string first = scratchPath("r.0.0.mca"), second = scratchPath("r.-1.0.mca");
+    writeRegion(first, {
+        {1 + 2 * 32, zlibChunk(chunkRoot(chunk_format::ROOT_SECTIONS_VERSION, 1, 2, {
+                sectionTag(chunk_format::ROOT_SECTIONS, -1, {paletteEntry("minecraft:air"), paletteEntry("minecraft:diamond_ore"),
+                                                             paletteEntry("minecraft:stone")}, indices),
+                sectionTag(chunk_format::ROOT_SECTIONS, 0, {paletteEntry("minecraft:air")}, indices)}))},
+        {3, zlibChunk(chunkRoot(chunk_format::FLATTENED_VERSION, 3, 0, {
+                sectionTag(chunk_format::FLATTENED, 2, {paletteEntry("minecraft:diamond_ore"), paletteEntry("minecraft:stone")},
+                           flatIndices)}))},
+    });
+    writeRegion(second, {
+        {5 + 4 * 32, zlibChunk(chunkRoot(chunk_format::PADDED_VERSION, -27, 4, {
+                sectionTag(chunk_format::PADDED, 0, {paletteEntry("minecraft:stone"), paletteEntry("minecraft:diamond_ore")},
+                           flatIndices)}))},
+    });
+
+    std::vector<std::array<int32_t, 3>> expected{{19, -12, 37}, {31, -1, 47}, {55, 34, 9}};
+    std::vector<std::array<int32_t, 3>> expectedAll = expected;
+    for (uint16_t index = 0; index < chunk_section::BLOCK_COUNT; ++index) {
+        if (flatIndices[index]) {
+            expectedAll.push_back({-432 + (index & 15), index >> 8, 64 + ((index >> 4) & 15)});
+        }
+    }
+    auto positions = [](std::vector<block_search::match> const& matches) {
+        std::vector<std::array<int32_t, 3>> found;
+        for (block_search::match const& match : matches) {
+            if (match.id == block_registry::get_instance().get_id("minecraft:diamond_ore")) {
+                found.push_back(match.pos);
+            }
+        }
+        std::sort(found.begin(), found.end());
+        return found;
+    };
+    std::sort(expected.begin(), expected.end());
+    std::sort(expectedAll.begin(), expectedAll.end());
+
+    region_file_reader reader(first);
+    reader.read(true);
+    std::vector<block_search::match> matches = block_search::find_in_region(reader, {"minecraft:diamond_ore"});
+    CHECK(matches.size() == expected.size() && positions(matches) == expected);
+    CHECK(block_search::find_in_region(reader, {"minecraft:gold_ore"}).empty());
+    CHECK(positions(block_search::find_in_regions({first, second}, {"minecraft:diamond_ore"}, 2)) == expectedAll);
+
+    // only single entry palettes may omit their data
+    value_tag missing = compound({field("Y", scalar<generic_tag::BYTE>(static_cast<char>(0))),
+                                  field("block_states", compound({field("palette", list(generic_tag::COMPOUND,
+                                        {paletteEntry("minecraft:air"), paletteEntry("minecraft:diamond_ore")}))}))});
+    compound_tag* generic = static_cast<compound_tag*>(missing.to_generic(""));
+    bool rejected = false;
+    try {
+        block_search::find_in_section(generic, chunk_format::ROOT_SECTIONS, 0, 0, {"minecraft:diamond_ore"}, matches);
+    } catch (std::runtime_error const&) {
+        rejected = true;
+    }
+    chunk_tag::clean_tag(generic);
+    CHECK(rejected);
+}
+
+void testBlockHistogram() {
+    block_registry& registry = block_registry::get_instance();
+    std::vector<uint16_t> indices(chunk_section::BLOCK_COUNT);
+    for (size_t i = 0; i < indices.size(); ++i) {
+        indices[i] = static_cast<uint16_t>(i * 7 % 5 == 0 ? i % 3 : 3);
+    }
+    std::vector<value_tag> palette{paletteEntry("minecraft:air"), paletteEntry("minecraft:stone"),
+                                   paletteEntry("minecraft:dirt"), paletteEntry("minecraft:granite")};
+    uint32_t ids[] = {registry.get_id("minecraft:air"), registry.get_id("minecraft:stone"),
+                      registry.get_id("minecraft:dirt"), registry.get_id("minecraft:granite")};
+    uint64_t expected[4] = {}, expectedLayer[4] = {};
+    for (size_t i = 0; i < indices.size(); ++i) {
+        ++expected[indices[i]];
+        expectedLayer[indices[i]] += i >> 8 == 5 ? 1 : 0;
+    }
+
+    chunk_section section;
+    CHECK(decodeSection(sectionTag(chunk_format::ROOT_SECTIONS, 2, palette, indices), chunk_format::ROOT_SECTIONS, section));
+    block_histogram histogram(true);
+    histogram.add_section(section);
+    for (int i = 0; i < 4; ++i) {
+        CHECK(histogram.get_count(ids[i]) == expected[i]);
+        CHECK(histogram.get_count(ids[i], 37) == expectedLayer[i]);
+    }
+    CHECK(histogram.get_total() == chunk_section::BLOCK_COUNT);
+    CHECK(histogram.get_layers().size() == 16);
+
+    // chunks, region chunks and whole regions agree with the section counts
+    Chunk chunk({0, 0});
+    chunk.addSection(section);
+    block_histogram fromChunk;
+    fromChunk.add_chunk(chunk);
+    CHECK(fromChunk.get_counts() == histogram.get_counts());
+
+    std::string path = scratchPath("r.1.1.mca");
+    writeRegion(path, {
+        {0, zlibChunk(chunkRoot(chunk_format::ROOT_SECTIONS_VERSION, 32, 32, {sectionTag(chunk_format::ROOT_SECTIONS, 2, palette, indices)}))},
+        {33, zlibChunk(chunkRoot(chunk_format::PADDED_VERSION, 33, 33, {sectionTag(chunk_format::PADDED, 0, palette, indices),
+                                                                        sectionTag(chunk_format::PADDED, 1, palette, indices)}))},
+    });
+    region_file_reader reader(path);
+    reader.read(true);
+    block_histogram fromReader;
+    fromReader.add_chunk(reader, 1, 1);
+    CHECK(fromReader.get_count(ids[3]) == 2 * expected[3]);
+
+    block_histogram merged;
+    merged.merge(fromChunk);
+    merged.merge(fromReader);
+    block_histogram region = block_histogram::of_regions({path}, false, 2);
+    CHECK(region.get_counts() == merged.get_counts());
+    CHECK(region.get_total() == 3 * chunk_section::BLOCK_COUNT);
+}
+
+void testBlockVisitors() {
+    block_registry& registry = block_registry::get_instance();
+    std::vector<uint16_t> indices(chunk_section::BLOCK_COUNT);
+    for (size_t i = 0; i < indices.size(); ++i) {
+        indices[i] = static_cast<uint16_t>(i % 3 == 0);
+    }
+    std::string path = scratchPath("r.0.1.mca");
+    writeRegion(path, {
+        {2, zlibChunk(chunkRoot(chunk_format::ROOT_SECTIONS_VERSION, 2, 32, {
+                sectionTag(chunk_format::ROOT_SECTIONS, -4, {paletteEntry("minecraft:air"), paletteEntry("minecraft:stone")}, indices),
+                sectionTag(chunk_format::ROOT_SECTIONS, 3, {paletteEntry("minecraft:air"), paletteEntry("minecraft:stone")}, indices)}))},
+        {3 + 32, zlibChunk(chunkRoot(chunk_format::ROOT_SECTIONS_VERSION, 3, 33, {
+                sectionTag(chunk_format::ROOT_SECTIONS, 0, {paletteEntry("minecraft:dirt")}, indices)}))},
+    });
+    region_file_reader reader(path);
+    reader.read(true);
+
+    uint32_t stone = registry.get_id("minecraft:stone");
+    size_t visited = 0, mismatched = 0;
+    reader.visit_blocks_at(2, 0, [&](int32_t x, int32_t y, int32_t z, uint32_t id) {
+        int32_t localY = y < 0 ? y + 64 : y - 48;
+        uint16_t expected = indices[chunk_section::get_index(x - 32, static_cast<unsigned int>(localY), z - 512)];
+        mismatched += (id == stone) != (expected == 1) || x < 32 || x >= 48 || z < 512 || z >= 528 ? 1 : 0;
+        ++visited;
+    });
+    CHECK(visited == 2 * chunk_section::BLOCK_COUNT && mismatched == 0);
+    CHECK(!reader.is_loaded(2, 0));
+
+    size_t dirt = 0;
+    visited = 0;
+    reader.visit_blocks_in_range(0, 32, 0, 32, [&](int32_t, int32_t, int32_t, uint32_t id) {
+        dirt += id == registry.get_id("minecraft:dirt") ? 1 : 0;
+        ++visited;
+    });
+    CHECK(visited == 3 * chunk_section::BLOCK_COUNT && dirt == chunk_section::BLOCK_COUNT);
+
+    // the Block wrappers stream through the same visitor
+    std::vector<Block> blocks = reader.get_blocks_in_range(2, 3, 0, 1);
+    CHECK(blocks.size() == 2 * chunk_section::BLOCK_COUNT);
+    CHECK(blocks.front().getName() == "minecraft:stone" && blocks.front().getPos() == (std::array<int32_t, 3>{32, -64, 512}));
+}
+
+void testBoxQuery() {
+    block_registry& registry = block_registry::get_instance();
+    std::vector<uint16_t> indices(chunk_section::BLOCK_COUNT);
+    for (size_t i = 0; i < indices.size(); ++i) {
+        indices[i] = static_cast<uint16_t>(i % 2);
+    }
+    std::filesystem::path folder = scratchDirectory() / "box";
+    std::filesystem::create_directories(folder);
+    writeRegion(box_query::get_region_path(folder.string(), 0, 0), {
+        {0, zlibChunk(chunkRoot(chunk_format::ROOT_SECTIONS_VERSION, 0, 0, {
+                sectionTag(chunk_format::ROOT_SECTIONS, 0, {paletteEntry("minecraft:air"), paletteEntry("minecraft:stone")}, indices),
+                sectionTag(chunk_format::ROOT_SECTIONS, 1, {paletteEntry("minecraft:dirt")}, indices)}))},
+    });
+    writeRegion(box_query::get_region_path(folder.string(), -1, 0), {
+        {31, zlibChunk(chunkRoot(chunk_format::ROOT_SECTIONS_VERSION, -1, 0, {
+                sectionTag(chunk_format::ROOT_SECTIONS, 0, {paletteEntry("minecraft:stone"), paletteEntry("minecraft:air")}, indices)}))},
+    });
+
+    // corners in any order, the box reaches into region -1, -1 which has no file
+    box_query query(folder.string(), {4, 12, -2}, {-3, 10, 5});
+    CHECK(query.get_min() == (std::array<int32_t, 3>{-3, 10, -2}) && query.get_max() == (std::array<int32_t, 3>{4, 12, 5}));
+    uint32_t stone = registry.get_id("minecraft:stone");
+    std::vector<std::pair<std::array<int32_t, 3>, bool>> expected, found;
+    for (int32_t y = 10; y <= 12; ++y) {
+        for (int32_t z = 0; z <= 5; ++z) {
+            for (int32_t x = -3; x <= 4; ++x) {
+                bool odd = indices[chunk_section::get_index(static_cast<unsigned int>(x & 15), y, z)] == 1;
+                expected.push_back({{x, y, z}, x < 0 ? !odd : odd});
+            }
+        }
+    }
+    for (block_search::match const& match : query.get_blocks(2)) {
+        found.push_back({match.pos, match.id == stone});
+    }
+    std::sort(expected.begin(), expected.end());
+    std::sort(found.begin(), found.end());
+    CHECK(found == expected);
+
+    size_t visited = 0, outside = 0;
+    query.visit_blocks([&](int32_t x, int32_t y, int32_t z, uint32_t, unsigned int) {
+        outside += query.contains(x, y, z) ? 0 : 1;
+        ++visited;
+    }, 1);
+    CHECK(visited == expected.size() && outside == 0);
+
+    // only sections overlapping the box are decoded
+    box_query high(folder.string(), {0, 20, 0}, {3, 20, 3});
+    std::vector<block_search::match> dirt = high.get_blocks(1);
+    CHECK(dirt.size() == 16 && dirt.front().id == registry.get_id("minecraft:dirt"));
+}
+
+void testSkippedChunks() {
+    std::vector<uint16_t> indices(chunk_section::BLOCK_COUNT);
+    for (size_t i = 0; i < indices.size(); ++i) {
+        indices[i] = static_cast<uint16_t>(i % 2);
+    }
+    std::vector<value_tag> palette{paletteEntry("minecraft:air"), paletteEntry("minecraft:diamond_ore")};
+    value_tag truncated = sectionTag(chunk_format::PADDED, 0, palette, indices);
+    std::get<generic_tag::LONG_ARRAY>(truncated.get_subtag("BlockStates")->get_value()).pop_back();
+    RegionChunk garbage, gzip = zlibChunk(chunkRoot(chunk_format::PADDED_VERSION, 3, 0, {}));
+    garbage.payload.assign(300, 'x');
+    gzip.type = 1;
+
+    // one good chunk, then a malformed section, undecompressable data and gzip data
+    std::filesystem::path folder = scratchDirectory() / "skipped";
+    std::filesystem::create_directories(folder);
+    std::string path = box_query::get_region_path(folder.string(), 0, 0);
+    writeRegion(path, {
+        {0, zlibChunk(chunkRoot(chunk_format::PADDED_VERSION, 0, 0, {sectionTag(chunk_format::PADDED, 0, palette, indices)}))},
+        {1, zlibChunk(chunkRoot(chunk_format::PADDED_VERSION, 1, 0, {sectionTag(chunk_format::PADDED, 1, palette, indices),
+                                                                     truncated}))},
+        {2, garbage},
+        {3, gzip},
+    });
+    std::mutex lock;
+    std::vector<std::pair<unsigned int, chunk_status::STATUS>> skipped;
+    parallel::skip_work skip = [&](region_file_reader&, unsigned int x, unsigned int z, chunk_status::STATUS status) {
+        std::lock_guard<std::mutex> guard(lock);
+        skipped.push_back({x + z * 32, status});
+    };
+    std::vector<std::pair<unsigned int, chunk_status::STATUS>> expected{
+        {1, chunk_status::CORRUPT}, {2, chunk_status::CORRUPT}, {3, chunk_status::UNSUPPORTED_COMPRESSION}};
+    auto reported = [&]() {
+        std::sort(skipped.begin(), skipped.end());
+        bool same = skipped == expected;
+        skipped.clear();
+        return same;
+    };
+
+    // scans go on past the skipped chunks, a corrupt chunk's matches are dropped
+    CHECK(block_search::find_in_regions({path}, {"minecraft:diamond_ore"}, 2, skip).size() == chunk_section::BLOCK_COUNT / 2);
+    CHECK(reported());
+    region_file_reader reader(path);
+    reader.read(true);
+    CHECK(block_search::find_in_region(reader, {"minecraft:diamond_ore"}, skip).size() == chunk_section::BLOCK_COUNT / 2);
+    CHECK(reported());
+    CHECK(block_search::find_in_regions({path}, {"minecraft:diamond_ore"}, 2).size() == chunk_section::BLOCK_COUNT / 2);
+    std::vector<block_search::match> matches;
+    CHECK(block_search::try_find_in_chunk(reader, 1, 0, {"minecraft:diamond_ore"}, matches) == chunk_status::CORRUPT);
+    CHECK(matches.empty());
+
+    // a corrupt chunk keeps the sections counted before the error
+    CHECK(block_histogram::of_regions({path}, false, 2, skip).get_total() == 2 * chunk_section::BLOCK_COUNT);
+    CHECK(reported());
+    block_histogram histogram;
+    CHECK(histogram.try_add_chunk(reader, 2, 0) == chunk_status::CORRUPT && histogram.get_total() == 0);
+
+    size_t visited = 0;
+    box_query query(folder.string(), {0, 0, 0}, {63, 31, 15});
+    query.visit_sections([&](const chunk_section&, int, int, unsigned int) {
+        std::lock_guard<std::mutex> guard(lock);
+        ++visited;
+    }, 2, skip);
+    CHECK(visited == 2 && reported());
+    CHECK(query.get_blocks(1).size() == 2 * chunk_section::BLOCK_COUNT);
+}
+
+void testChunkSurface() {
+    block_registry& registry = block_registry::get_instance();
+    std::vector<uint16_t> lower(chunk_section::BLOCK_COUNT), upper(chunk_section::BLOCK_COUNT);
+    int32_t expected[chunk_surface::COLUMN_COUNT];
+    for (unsigned int z = 0; z < 16; ++z) {
+        for (unsigned int x = 0; x < 16; ++x) {
+            // column tops climb from y 0 to 28, the last column is empty
+            int32_t top = x == 15 && z == 15 ? chunk_surface::NO_HEIGHT : static_cast<int32_t>(x + z);
+            expected[chunk_surface::get_index(x, z)] = top;
+            for (int32_t y = 0; y < 32; ++y) {
+                std::vector<uint16_t>& indices = y < 16 ? lower : upper;
+                indices[chunk_section::get_index(x, y % 16, z)] = top == chunk_surface::NO_HEIGHT || y > top ? 0 : y == top ? 2 : 1;
+            }
+        }
+    }
+    auto surfaceRoot = [&](std::vector<uint16_t> const* heights) {
+        std::vector<value_tag> palette{paletteEntry("minecraft:air"), paletteEntry("minecraft:stone"), paletteEntry("minecraft:grass_block")};
+        value_tag root = chunkRoot(chunk_format::ROOT_SECTIONS_VERSION, 0, 0, {
+                sectionTag(chunk_format::ROOT_SECTIONS, 0, palette, lower), sectionTag(chunk_format::ROOT_SECTIONS, 1, palette, upper),
+                sectionTag(chunk_format::ROOT_SECTIONS, 2, {paletteEntry("minecraft:air")}, lower)});
+        if (heights) {
+            addField(root, "Heightmaps", compound({field("WORLD_SURFACE", scalar<generic_tag::LONG_ARRAY>(
+                    packReference(*heights, chunk_format::HEIGHTMAP_BITS, true)))}));
+        }
+        return root;
+    };
+    auto matches = [&](chunk_surface const& surface) {
+        bool same = true;
+        for (unsigned int i = 0; i < chunk_surface::COLUMN_COUNT; ++i) {
+            same &= surface.get_heights()[i] == expected[i];
+            same &= surface.get_ids()[i] == registry.get_id(expected[i] == chunk_surface::NO_HEIGHT ? "minecraft:air"
+                                                                                                   : "minecraft:grass_block");
+        }
+        return same;
+    };
+
+    // without a heightmap, with a matching one, and with a stale one
+    std::vector<uint16_t> heights(chunk_surface::COLUMN_COUNT), stale(chunk_surface::COLUMN_COUNT, 100);
+    for (unsigned int i = 0; i < chunk_surface::COLUMN_COUNT; ++i) {
+        heights[i] = static_cast<uint16_t>(expected[i] == chunk_surface::NO_HEIGHT ? 0 : expected[i] + 64 + 1);
+    }
+    std::vector<value_tag> roots{surfaceRoot(nullptr), surfaceRoot(&heights), surfaceRoot(&stale)};
+    for (value_tag const& tag : roots) {
+        compound_tag* root = static_cast<compound_tag*>(tag.to_generic(""));
+        chunk_surface surface;
+        CHECK(surface.extract(*root) && matches(surface));
+        chunk_tag::clean_tag(root);
+    }
+
+    std::string path = scratchPath("r.2.0.mca");
+    writeRegion(path, {{0, zlibChunk(roots[1])}});
+    region_file_reader reader(path);
+    reader.read(true);
+    chunk_surface surface;
+    CHECK(surface.extract(reader, 0, 0) && matches(surface) && surface.get_height_at(3, 4) == 7);
+    CHECK(!reader.is_loaded(0, 0));
+    CHECK(!surface.extract(reader, 1, 0));
+}
+
+void testLightAndHeightmaps() {
+    std::vector<char> light(nibble_array::SECTION_SIZE);
+    for (size_t i = 0; i < light.size(); ++i) {
+        light[i] = static_cast<char>(i * 37 + 11);
+    }
+    std::vector<uint8_t> unpacked(chunk_section::BLOCK_COUNT);
+    nibble_array::unpack(light, unpacked.data(), chunk_section::BLOCK_COUNT);
+    bool same = true;
+    for (unsigned int i = 0; i < chunk_section::BLOCK_COUNT; ++i) {
+        uint8_t value = static_cast<uint8_t>(light[i / 2]);
+        uint8_t expected = i % 2 ? value >> 4 : value & 15;
+        same &= unpacked[i] == expected && nibble_array::get(light, i) == expected;
+    }
+    CHECK(same);
+
+    // heightmaps of both packings, and light arrays read in place
+    std::vector<uint16_t> heights(region_dim::BLOCK_COUNT), indices(chunk_section::BLOCK_COUNT, 0);
+    for (size_t i = 0; i < heights.size(); ++i) {
+        heights[i] = static_cast<uint16_t>(i * 3 % 385);
+    }
+    std::map<unsigned int, RegionChunk> chunks;
+    for (int version : {chunk_format::FLATTENED_VERSION, chunk_format::PADDED_VERSION}) {
+        value_tag section = sectionTag(chunk_format::get_generation(version), 1, {paletteEntry("minecraft:air"),
+                                                                                  paletteEntry("minecraft:stone")}, indices);
+        addField(section, "BlockLight", scalar<generic_tag::BYTE_ARRAY>(light));
+        value_tag root = chunkRoot(version, static_cast<int>(chunks.size()), 0, {section});
+        addField(*root.get_subtag("Level"), "Heightmaps", compound({field("MOTION_BLOCKING", scalar<generic_tag::LONG_ARRAY>(
+                packReference(heights, chunk_format::HEIGHTMAP_BITS, version >= chunk_format::PADDED_VERSION)))}));
+        chunks.emplace(static_cast<unsigned int>(chunks.size()), zlibChunk(root));
+    }
+    value_tag truncated = chunkRoot(chunk_format::PADDED_VERSION, 2, 0, {});
+    addField(*truncated.get_subtag("Level"), "Heightmaps", compound({field("MOTION_BLOCKING",
+            scalar<generic_tag::LONG_ARRAY>(std::vector<int64_t>(10)))}));
+    chunks.emplace(2, zlibChunk(truncated));
+    std::string path = scratchPath("r.3.0.mca");
+    writeRegion(path, chunks);
+
+    region_file_reader reader(path);
+    reader.read(true);
+    for (unsigned int x = 0; x < 2; ++x) {
+        std::vector<uint16_t> decoded(region_dim::BLOCK_COUNT);
+        CHECK(reader.get_heightmap_at(x, 0, "MOTION_BLOCKING", decoded.data()) && decoded == heights);
+        CHECK(!reader.get_heightmap_at(x, 0, "WORLD_SURFACE", decoded.data()));
+        array_view<const char> blockLight = reader.get_block_light_at(x, 0, 1);
+        CHECK(blockLight.size() == light.size() && std::equal(light.begin(), light.end(), blockLight.data()));
+        CHECK(reader.get_sky_light_at(x, 0, 1).empty() && reader.get_block_light_at(x, 0, 0).empty());
+    }
+    std::vector<uint16_t> decoded(region_dim::BLOCK_COUNT);
+    bool threw = false;
+    try {
+        reader.get_heightmap_at(2, 0, "MOTION_BLOCKING", decoded.data());
+    } catch (std::runtime_error const&) {
+        threw = true;
+    }
+    CHECK(threw);
+}
+
+void testBiomeGrid() {
+    biome_registry& registry = biome_registry::get_instance();
+    uint32_t plains = registry.get_id("minecraft:plains"), desert = registry.get_id("minecraft:desert"),
+             forest = registry.get_id("minecraft:forest"), ocean = registry.get_id("minecraft:ocean");
+    uint32_t cycle[] = {plains, desert, forest};
+
+    // 1.18+ sections, the middle one holds no biomes
+    std::vector<uint16_t> cells(64), blocks(chunk_section::BLOCK_COUNT);
+    for (size_t i = 0; i < cells.size(); ++i) {
+        cells[i] = static_cast<uint16_t>(i % 3);
+    }
+    std::vector<value_tag> sections{sectionTag(chunk_format::ROOT_SECTIONS, -1, {paletteEntry("minecraft:air")}, blocks),
+                                    sectionTag(chunk_format::ROOT_SECTIONS, 0, {paletteEntry("minecraft:air")}, blocks),
+                                    sectionTag(chunk_format::ROOT_SECTIONS, 1, {paletteEntry("minecraft:air")}, blocks)};
+    addField(sections[0], "biomes", compound({
+            field("palette", list(generic_tag::STRING, {scalar<generic_tag::STRING>(std::string("minecraft:plains")),
+                                                        scalar<generic_tag::STRING>(std::string("minecraft:desert")),
+                                                        scalar<generic_tag::STRING>(std::string("minecraft:forest"))})),
+            field("data", scalar<generic_tag::LONG_ARRAY>(packReference(cells, 2, true)))}));
+    addField(sections[2], "biomes", compound({
+            field("palette", list(generic_tag::STRING, {scalar<generic_tag::STRING>(std::string("minecraft:ocean"))}))}));
+    value_tag modern = chunkRoot(chunk_format::ROOT_SECTIONS_VERSION, 0, 0, sections);
+    compound_tag* root = static_cast<compound_tag*>(modern.to_generic(""));
+    biome_grid grid;
+    CHECK(grid.decode(*root));
+    CHECK(grid.get_shift() == 2 && grid.get_layers() == 12 && grid.get_min_y() == -16);
+    bool same = true;
+    for (int y = -20; y < 36; ++y) {
+        for (unsigned int z = 0; z < 16; ++z) {
+            for (unsigned int x = 0; x < 16; ++x) {
+                uint32_t expected = y >= 16 ? ocean : y >= 0 ? biome_registry::NONE
+                                  : cycle[cells[((std::max(y, -16) + 16) / 4 * 4 + z / 4) * 4 + x / 4]];
+                same &= grid.biome_at(x, y, z) == expected;
+            }
+        }
+    }
+    CHECK(same);
+    chunk_tag::clean_tag(root);
+
+    // pre-1.13 byte biomes per column, 1.15+ int biomes per 4x4x4 cell
+    std::vector<char> columns(region_dim::BLOCK_COUNT);
+    std::vector<int> volume(1024);
+    for (size_t i = 0; i < columns.size(); ++i) {
+        columns[i] = static_cast<char>(i % 4);
+    }
+    for (size_t i = 0; i < volume.size(); ++i) {
+        volume[i] = static_cast<int>(i / 16 % 2 ? 2 : 1);
+    }
+    value_tag legacy = chunkRoot(1343, 0, 0, {}), flattened = chunkRoot(2230, 1, 0, {});
+    addField(*legacy.get_subtag("Level"), "Biomes", scalar<generic_tag::BYTE_ARRAY>(columns));
+    addField(*flattened.get_subtag("Level"), "Biomes", scalar<generic_tag::INT_ARRAY>(volume));
+    value_tag truncated = chunkRoot(2230, 2, 0, {});
+    addField(*truncated.get_subtag("Level"), "Biomes", scalar<generic_tag::INT_ARRAY>(std::vector<int>(100)));
+    std::string path = scratchPath("r.4.0.mca");
+    writeRegion(path, {{0, zlibChunk(legacy)}, {1, zlibChunk(flattened)}, {2, zlibChunk(truncated)}});
+    region_file_reader reader(path);
+    reader.read(true);
+
+    CHECK(grid.decode(reader, 0, 0) && grid.get_shift() == 0 && grid.get_layers() == 1);
+    CHECK(grid.biome_at(3, 70, 0) == registry.get_legacy_id(3) && grid.biome_at(1, -5, 2) == registry.get_legacy_id(1));
+    CHECK(registry.get_legacy_id(1) == registry.get_id(biome_registry::get_legacy_name(1)));
+    CHECK(grid.decode(reader, 1, 0) && grid.get_shift() == 2 && grid.get_layers() == 64);
+    CHECK(grid.biome_at(0, 0, 0) == registry.get_legacy_id(1) && grid.biome_at(0, 4, 0) == registry.get_legacy_id(2));
+    CHECK(grid.to_ids().size() == volume.size());
+    CHECK(!reader.is_loaded(1, 0));
+    bool threw = false;
+    try {
+        grid.decode(reader, 2, 0);
+    } catch (std::runtime_error const&) {
+        threw = true;
+    }
+    CHECK(threw && !grid.decode(reader, 3, 0));
+}
+
+value_tag legacySectionTag(int y, std::vector<char> const& blocks, std::vector<char> const* add, std::vector<char> const& data) {
+    value_tag section = compound({field("Y", scalar<generic_tag::BYTE>(static_cast<char>(y))),
+                                  field("Blocks", scalar<generic_tag::BYTE_ARRAY>(blocks)),
+                                  field("Data", scalar<generic_tag::BYTE_ARRAY>(data))});
+    if (add) {
+        addField(section, "Add", scalar<generic_tag::BYTE_ARRAY>(*add));
+    }
+    return section;
+}
+
+void testLegacySection() {
+    std::vector<char> blocks(chunk_section::BLOCK_COUNT), add(nibble_array::SECTION_SIZE), data(nibble_array::SECTION_SIZE);
+    for (size_t i = 0; i < blocks.size(); ++i) {
+        blocks[i] = static_cast<char>(i * 7);
+    }
+    for (size_t i = 0; i < add.size(); ++i) {
+        add[i] = static_cast<char>(i * 13 + 1);
+        data[i] = static_cast<char>(i * 5 + 3);
+    }
+    auto expected = [&](size_t i, bool withAdd) {
+        unsigned int shift = i % 2 * 4;
+        uint16_t high = withAdd ? (static_cast<uint8_t>(add[i / 2]) >> shift) & 15 : 0;
+        return static_cast<uint16_t>(high << 12 | static_cast<uint8_t>(blocks[i]) << 4 | ((static_cast<uint8_t>(data[i / 2]) >> shift) & 15));
+    };
+
+    for (bool withAdd : {true, false}) {
+        compound_tag* tag = static_cast<compound_tag*>(legacySectionTag(5, blocks, withAdd ? &add : nullptr, data).to_generic(""));
+        legacy_section section;
+        CHECK(legacy_section::decode(tag, section) && section.get_y() == 5);
+        bool same = true;
+        for (unsigned int i = 0; i < chunk_section::BLOCK_COUNT; ++i) {
+            same &= section.get_values()[i] == expected(i, withAdd);
+        }
+        CHECK(same);
+        CHECK(section.get_block_id_at(1, 0, 0) == expected(1, withAdd) >> 4 && section.get_data_at(1, 0, 0) == (expected(1, withAdd) & 15));
+        chunk_tag::clean_tag(tag);
+    }
+
+    std::vector<char> shortData(100);
+    compound_tag* tag = static_cast<compound_tag*>(legacySectionTag(0, blocks, nullptr, shortData).to_generic(""));
+    legacy_section section;
+    bool threw = false;
+    try {
+        legacy_section::decode(tag, section);
+    } catch (std::runtime_error const&) {
+        threw = true;
+    }
+    CHECK(threw);
+    chunk_tag::clean_tag(tag);
+
+    // region lookups go through the decoded sections
+    std::string path = scratchPath("r.5.0.mca");
+    writeRegion(path, {{0, zlibChunk(chunkRoot(1343, 160, 0, {legacySectionTag(2, blocks, &add, data)}))}});
+    region_file_reader reader(path);
+    reader.read(true);
+    size_t index = chunk_section::get_index(3, 9, 4);
+    CHECK(reader.get_block_at(0, 0, 3, 41, 4) == expected(index, true) >> 4);
+    CHECK(reader.get_block_data_at(0, 0, 3, 41, 4) == (expected(index, true) & 15));
+    CHECK(reader.get_block_at(0, 0, 3, 9, 4) == 0);
+}
+
+void testChunkView() {
+    block_registry& registry = block_registry::get_instance();
+    std::vector<uint16_t> indices(chunk_section::BLOCK_COUNT);
+    for (size_t i = 0; i < indices.size(); ++i) {
+        indices[i] = static_cast<uint16_t>(i % 2);
+    }
+    value_tag tag = chunkRoot(chunk_format::ROOT_SECTIONS_VERSION, 6, -2, {
+            sectionTag(chunk_format::ROOT_SECTIONS, -3, {paletteEntry("minecraft:air"), paletteEntry("minecraft:stone")}, indices),
+            sectionTag(chunk_format::ROOT_SECTIONS, 2, {paletteEntry("minecraft:dirt")}, indices)});
+    compound_tag* root = static_cast<compound_tag*>(tag.to_generic(""));
+    {
+        chunk_view view(*root);
+        CHECK(view.get_generation() == chunk_format::ROOT_SECTIONS && view.get_level() == root);
+        CHECK(view.has_position() && view.get_x_pos() == 6 && view.get_z_pos() == -2);
+        CHECK(view.get_section_tag(-3) && view.get_section_tag(2) && !view.get_section_tag(0) && !view.get_section_tag(9));
+
+        // sections are decoded once and kept
+        const chunk_section* section = view.get_section(-3);
+        CHECK(section && section == view.get_section(-3) && section->get_y() == -3);
+        CHECK(!view.get_section(0));
+        CHECK(view.get_block_id_at(1, -48, 0) == registry.get_id("minecraft:stone"));
+        CHECK(view.get_block_id_at(0, -48, 0) == block_registry::AIR);
+        CHECK(view.get_block_id_at(5, 40, 5) == registry.get_id("minecraft:dirt"));
+        CHECK(view.get_block_id_at(5, 0, 5) == block_registry::AIR);
+    }
+    chunk_tag::clean_tag(root);
+
+    // the reader's view follows the chunk's tags
+    std::string path = scratchPath("r.0.-1.mca");
+    writeRegion(path, {{0, zlibChunk(tag)}});
+    region_file_reader reader(path);
+    reader.read(true);
+    chunk_view& view = reader.get_chunk_view(0, 0);
+    CHECK(&view == &reader.get_chunk_view(0, 0));
+    CHECK(view.get_level() == &reader.get_chunk_tag_at(0, 0).get_root_tag());
+    reader.get_chunk_tag_at(0, 0).clean_root();
+    chunk_view& reloaded = reader.get_chunk_view(0, 0);
+    CHECK(reloaded.get_level() == &reader.get_chunk_tag_at(0, 0).get_root_tag());
+    CHECK(reloaded.get_block_id_at(1, -48, 0) == registry.get_id("minecraft:stone"));
+}
+
+void testChunkStatus() {
+    std::vector<uint16_t> indices(chunk_section::BLOCK_COUNT);
+    for (size_t i = 0; i < indices.size(); ++i) {
+        indices[i] = static_cast<uint16_t>(i % 2);
+    }
+    std::vector<value_tag> palette{paletteEntry("minecraft:air"), paletteEntry("minecraft:stone")};
+    value_tag truncated = sectionTag(chunk_format::PADDED, 0, palette, indices);
+    std::get<generic_tag::LONG_ARRAY>(truncated.get_subtag("BlockStates")->get_value()).pop_back();
+    std::vector<uint16_t> outOfRange = indices;
+    outOfRange[7] = 5;
+    RegionChunk garbage, gzip = zlibChunk(chunkRoot(chunk_format::PADDED_VERSION, 3, 0, {}));
+    garbage.payload.assign(300, 'x');
+    gzip.type = 1;
+
+    std::filesystem::path folder = scratchDirectory() / "status";
+    std::filesystem::create_directories(folder);
+    std::string path = (folder / "r.0.0.mca").string();
+    writeRegion(path, {
+        {0, zlibChunk(chunkRoot(chunk_format::PADDED_VERSION, 0, 0, {sectionTag(chunk_format::PADDED, 0, palette, indices)}))},
+        {1, zlibChunk(chunkRoot(chunk_format::PADDED_VERSION, 1, 0, {truncated}))},
+        {2, garbage},
+        {3, gzip},
+        {5, zlibChunk(compound({field("DataVersion", scalar<generic_tag::INT>(chunk_format::PADDED_VERSION)),
+                                field("Level", compound({field("xPos", scalar<generic_tag::INT>(5)),
+                                                         field("zPos", scalar<generic_tag::INT>(0))}))}))},
+        {6, zlibChunk(compound({field("DataVersion", scalar<generic_tag::INT>(chunk_format::PADDED_VERSION)),
+                                field("Level", compound({}))}))},
+        {7, zlibChunk(chunkRoot(chunk_format::PADDED_VERSION, 7, 0, {sectionTag(chunk_format::PADDED, 0, palette, outOfRange)}))},
+    });
+    chunk_status::STATUS expected[] = {chunk_status::OK, chunk_status::CORRUPT, chunk_status::CORRUPT,
+                                       chunk_status::UNSUPPORTED_COMPRESSION, chunk_status::EMPTY, chunk_status::EMPTY,
+                                       chunk_status::CORRUPT, chunk_status::CORRUPT};
+
+    region_file_reader reader(path);
+    reader.set_decode_and_drop(true);
+    reader.read(true);
+    for (int x = 0; x < 8; ++x) {
+        std::shared_ptr<Chunk> chunk = std::make_shared<Chunk>(std::array<int32_t, 2>{x, 0});
+        CHECK(reader.tryReadChunk(chunk) == expected[x]);
+        CHECK(!reader.is_loaded(x, 0));
+        CHECK(!chunk_status::to_string(expected[x]).empty());
+    }
+
+    // the registry reports the same, and only throws from getChunk
+    ChunkRegistry registry(folder.string());
+    for (int x = 0; x < 8; ++x) {
+        std::shared_ptr<Chunk> chunk;
+        CHECK(registry.tryGetChunk(x, 0, chunk) == expected[x]);
+        CHECK((chunk != nullptr) == (expected[x] == chunk_status::OK));
+    }
+    bool empty = false, corrupt = false;
+    try {
+        registry.getChunk(4, 0);
+    } catch (std::out_of_range const&) {
+        empty = true;
+    }
+    try {
+        registry.getChunk(2, 0);
+    } catch (std::runtime_error const&) {
+        corrupt = true;
+    }
+    CHECK(empty && corrupt);
+
+    // lengths past the stream and truncated trees load as corrupt, without escaping exceptions
+    auto loads = [&reader](std::vector<char> body) {
+        std::vector<char> raw{generic_tag::COMPOUND, 0, 0};
+        raw.insert(raw.end(), body.begin(), body.end());
+        compression::deflate_(raw);
+        return reader.try_load_compressed(0, 0, std::move(raw));
+    };
+    char const ff = -1;
+    CHECK(loads({generic_tag::BYTE_ARRAY, 0, 1, 'a', ff, ff, ff, ff}) == chunk_status::CORRUPT);
+    CHECK(loads({generic_tag::BYTE_ARRAY, 0, 1, 'a', 0x7f, ff, ff, ff}) == chunk_status::CORRUPT);
+    CHECK(loads({generic_tag::LONG_ARRAY, 0, 1, 'a', 0x7f, ff, ff, ff}) == chunk_status::CORRUPT);
+    CHECK(loads({generic_tag::LIST, 0, 1, 'a', generic_tag::INT, 0x7f, ff, ff, ff}) == chunk_status::CORRUPT);
+    CHECK(loads({generic_tag::COMPOUND, 0, 1, 'c', generic_tag::LIST, 0, 1, 'l', generic_tag::INT, 0, 0, 0, 2, 0, 0, 0, 1, 0})
+          == chunk_status::CORRUPT);
+    CHECK(loads({generic_tag::INT, 0, 1, 'i', 0, 0}) == chunk_status::CORRUPT);
+    CHECK(loads({generic_tag::INT, 0, 1, 'i', 0, 0, 0, 1, generic_tag::END}) == chunk_status::OK);
+    CHECK(reader.get_chunk_tag_at(0, 0).get_root_tag().size() == 1);
+}
+
+void testSparseArray() {
+    sparse_array<int, 1024> array;
+    std::map<unsigned int, int> reference;
+    std::map<unsigned int, int*> addresses;
+    uint32_t seed = 99;
+    auto next = [&seed]() {
+        seed = seed * 1103515245 + 12345;
+        return seed >> 8;
+    };
+
+    // random inserts and erases against an ordered map, checking rank-derived lookups as we go
+    bool consistent = true;
+    for (int step = 0; step < 20000; ++step) {
+        unsigned int index = next() % sparse_array<int, 1024>::capacity();
+        if (next() % 3) {
+            array.at(index) = step;
+            reference[index] = step;
+            addresses[index] = &array.at(index);
+        } else {
+            array.erase(index);
+            reference.erase(index);
+            addresses.erase(index);
+        }
+        if (step % 500 == 0) {
+            consistent &= array.size() == reference.size();
+            for (unsigned int i = 0; i < sparse_array<int, 1024>::capacity(); ++i) {
+                auto found = reference.find(i);
+                consistent &= array.contains(i) == (found != reference.end());
+                consistent &= found == reference.end() ? !array.find(i) : array.find(i) && *array.find(i) == found->second;
+            }
+        }
+    }
+    CHECK(consistent);
+
+    // elements stay put while neighbours come and go, and are visited in index order
+    bool stable = true;
+    for (auto const& entry : addresses) {
+        stable &= array.find(entry.first) == entry.second;
+    }
+    CHECK(stable);
+    std::vector<std::pair<unsigned int, int>> visited;
+    array.for_each([&visited](unsigned int index, int value) { visited.push_back({index, value}); });
+    std::vector<std::pair<unsigned int, int>> ordered(reference.begin(), reference.end());
+    CHECK(visited == ordered);
+
+    sparse_array<int, 1024> copy(array);
+    CHECK(copy == array && copy.size() == array.size());
+    copy.at(reference.begin()->first) += 1;
+    CHECK(copy != array);
+    copy.clear();
+    CHECK(copy.size() == 0 && !copy.contains(reference.begin()->first));
+
+    bool threw = false;
+    try {
+        array.contains(1024);
+    } catch (std::out_of_range const&) {
+        threw = true;
+    }
+    CHECK(threw);
+}
+
+void testDecodeAndDrop() {
+    block_registry& registry = block_registry::get_instance();
+    std::vector<uint16_t> indices(chunk_section::BLOCK_COUNT);
+    for (size_t i = 0; i < indices.size(); ++i) {
+        indices[i] = static_cast<uint16_t>(i % 2);
+    }
+    std::string path = scratchPath("r.6.0.mca");
+    writeRegion(path, {
+        {0, zlibChunk(chunkRoot(chunk_format::ROOT_SECTIONS_VERSION, 192, 0, {
+                sectionTag(chunk_format::ROOT_SECTIONS, 0, {paletteEntry("minecraft:air"), paletteEntry("minecraft:stone")}, indices)}))},
+    });
+
+    for (bool drop : {true, false}) {
+        region_file_reader reader(path);
+        reader.set_decode_and_drop(drop);
+        reader.read(true);
+        CHECK(region_file_reader(reader).is_decode_and_drop() == drop);
+        std::shared_ptr<Chunk> chunk = std::make_shared<Chunk>(std::array<int32_t, 2>{0, 0});
+        CHECK(reader.tryReadChunk(chunk) == chunk_status::OK);
+        CHECK(reader.is_loaded(0, 0) != drop);
+
+        // decoded blocks outlive the tags
+        CHECK(chunk->getOrigin() == (std::array<int32_t, 2>{3072, 0}));
+        CHECK(chunk->getBlockIdAt(1, 0, 0) == registry.get_id("minecraft:stone"));
+        CHECK(chunk->getBlockIdAt(0, 0, 0) == block_registry::AIR);
+    }
+
+    // visits only drop the tags they loaded themselves
+    region_file_reader reader(path);
+    reader.read(true);
+    size_t sections = 0;
+    reader.visit_sections_at(0, 0, [&sections](chunk_section const&, int, int) { ++sections; });
+    CHECK(sections == 1 && !reader.is_loaded(0, 0));
+    compound_tag* root = nullptr;
+    CHECK(reader.try_load_root(0, 0, root) == chunk_status::OK && reader.is_loaded(0, 0));
+    reader.visit_sections_at(0, 0, [&sections](chunk_section const&, int, int) { ++sections; });
+    CHECK(sections == 2 && reader.is_loaded(0, 0));
+}
+
+void testChunkCacheTiers() {
+    block_registry& registry = block_registry::get_instance();
+    std::vector<value_tag> palette;
+    for (int i = 0; i < 16; ++i) {
+        palette.push_back(paletteEntry("test:tier_" + std::to_string(i)));
+    }
+    std::filesystem::path folder = scratchDirectory() / "tiers";
+    std::filesystem::create_directories(folder);
+    std::map<unsigned int, RegionChunk> chunks;
+    size_t largest = 0;
+    uint32_t seed = 7;
+    for (int x = 0; x < 8; ++x) {
+        std::vector<uint16_t> indices(chunk_section::BLOCK_COUNT);
+        for (uint16_t& index : indices) {
+            seed = seed * 1103515245 + 12345;
+            index = static_cast<uint16_t>(seed >> 28);
+        }
+        indices[0] = static_cast<uint16_t>(x);
+        chunks.emplace(x, zlibChunk(chunkRoot(chunk_format::ROOT_SECTIONS_VERSION, x, 0,
+                                              {sectionTag(chunk_format::ROOT_SECTIONS, 0, palette, indices)})));
+        largest = std::max(largest, chunks[x].payload.size());
+    }
+    writeRegion((folder / "r.0.0.mca").string(), chunks);
+    auto firstBlock = [&registry](std::shared_ptr<Chunk> const& chunk) {
+        return registry.get_name(*chunk->getBlockIdAt(0, 0, 0));
+    };
+
+    // two decoded chunks, room for three compressed ones
+    size_t budget = 3 * largest;
+    ChunkRegistry cache(folder.string());
+    cache.setCacheLimits(2, budget);
+    bool bounded = true;
+    for (int x = 0; x < 8; ++x) {
+        CHECK(firstBlock(cache.getChunk(x, 0)) == "test:tier_" + std::to_string(x));
+        bounded &= cache.getCompressedBytes() <= budget;
+    }
+    CHECK(bounded && cache.getStats().misses == 8);
+    CHECK(cache.getChunk(7, 0) && cache.getStats().hotHits == 1);
+    CHECK(cache.getWarmBytes() > 0 && cache.getWarmBytes() <= cache.getCompressedBytes());
+
+    // demoted chunks come back from memory intact, evicted ones from disk
+    CHECK(firstBlock(cache.getChunk(5, 0)) == "test:tier_5" && cache.getStats().warmHits == 1);
+    CHECK(firstBlock(cache.getChunk(0, 0)) == "test:tier_0" && cache.getStats().misses == 9);
+    CHECK(cache.getCompressedBytes() <= budget);
+
+    // shrinking the budget trims both tiers at once
+    cache.setCacheLimits(2, largest / 2);
+    CHECK(cache.getCompressedBytes() == 0);
+    cache.setCacheLimits(1, 0);
+    size_t misses = cache.getStats().misses;
+    cache.getChunk(3, 0);
+    cache.getChunk(4, 0);
+    CHECK(cache.getChunk(3, 0) && cache.getStats().misses == misses + 3 && cache.getCompressedBytes() == 0);
+
+    // without limits every chunk stays decoded and no bytes are kept
+    ChunkRegistry unbounded(folder.string());
+    for (int x = 0; x < 8; ++x) {
+        unbounded.getChunk(x, 0);
+    }
+    for (int x = 0; x < 8; ++x) {
+        unbounded.getChunk(x, 0);
+    }
+    CHECK(unbounded.getStats().hotHits == 8 && unbounded.getCompressedBytes() == 0);
+    CHECK(unbounded.getBlock({2 * 16, 0, 0}) && unbounded.getBlock({2 * 16, 0, 0})->getName() == "test:tier_2");
+}
+
+// Map a shared segment directly to tamper with it, see the layout in shared_chunk_cache.cpp
+char* mapSegment(std::string const& name, size_t& size) {
+    int fd = shm_open(name.c_str(), O_RDWR, 0600);
+    struct stat info;
+    if (fd < 0 || fstat(fd, &info)) {
+        return nullptr;
+    }
+    size = static_cast<size_t>(info.st_size);
+    void* base = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    return base == MAP_FAILED ? nullptr : static_cast<char*>(base);
+}
+
+void testSectionSerialization() {
+    block_registry& registry = block_registry::get_instance();
+    std::vector<uint16_t> indices(chunk_section::BLOCK_COUNT);
+    for (size_t i = 0; i < indices.size(); ++i) {
+        indices[i] = static_cast<uint16_t>(i * 5 % 3);
+    }
+    chunk_section dense, uniform;
+    CHECK(decodeSection(sectionTag(chunk_format::PADDED, -2, {paletteEntry("minecraft:air"), paletteEntry("minecraft:stone"),
+                                                              paletteEntry("minecraft:oak_log", {{"axis", "x"}})}, indices),
+                        chunk_format::PADDED, dense));
+    CHECK(decodeSection(sectionTag(chunk_format::ROOT_SECTIONS, 3, {paletteEntry("minecraft:dirt")}, indices),
+                        chunk_format::ROOT_SECTIONS, uniform));
+    Chunk chunk({4, 5});
+    chunk.addSection(dense);
+    chunk.addSection(uniform);
+    Block glass("glass", {64 + 3, 200, 80 + 9});
+    chunk.addBlock(glass);
+    std::vector<char> data;
+    chunk.writeSections(data);
+
+    // round trip
+    Chunk copy({4, 5});
+    CHECK(copy.readSections(data.data(), data.size()));
+    CHECK(copy.getOrigin() == chunk.getOrigin() && copy.getPalette() == chunk.getPalette() && copy.size() == chunk.size());
+    bool same = true;
+    for (int32_t y = -48; y < 224; ++y) {
+        for (int32_t i = 0; i < 256; i += 7) {
+            same &= copy.getBlockIdAt(i & 15, y, i >> 4) == chunk.getBlockIdAt(i & 15, y, i >> 4);
+        }
+    }
+    CHECK(same);
+    CHECK(copy.getBlock({67, 200, 89})->getName() == "glass");
+    CHECK(registry.get_state(*copy.getBlockIdAt(0, -32, 1)).to_string() == "minecraft:oak_log[axis=x]");
+
+    // truncated input is rejected and leaves the chunk untouched
+    bool rejected = true;
+    Chunk target({0, 0});
+    for (size_t size = 0; size < data.size(); size += size < 256 ? 1 : 509) {
+        rejected &= !target.readSections(data.data(), size);
+    }
+    CHECK(rejected && target.size() == 0 && target.getPalette().empty());
+    std::vector<char> trailing = data;
+    trailing.push_back(0);
+    CHECK(!target.readSections(trailing.data(), trailing.size()));
+
+    // corrupt counts and indices, the counts are native order uint32 after the origin and min section
+    std::vector<char> corrupt = data;
+    uint32_t huge = 0xfffffff0u;
+    std::memcpy(corrupt.data() + 12, &huge, sizeof(huge));
+    CHECK(!target.readSections(corrupt.data(), corrupt.size()));
+    Chunk plain({0, 0});
+    plain.addSection(uniform);
+    std::vector<char> small;
+    plain.writeSections(small);
+    CHECK(target.readSections(small.data(), small.size()) && target.size() == chunk_section::BLOCK_COUNT);
+    corrupt = small;
+    std::memcpy(corrupt.data() + corrupt.size() - 8, &huge, sizeof(huge));  // section count, one 4 byte section follows
+    CHECK(!target.readSections(corrupt.data(), corrupt.size()));
+    corrupt = small;
+    corrupt[corrupt.size() - 2] = 9;  // uniform palette index past the palette
+    CHECK(!target.readSections(corrupt.data(), corrupt.size()));
+    std::vector<char> badDense = data;
+    badDense[badDense.size() - 1] = 0x7f;  // last dense index of the glass section
+    CHECK(!target.readSections(badDense.data(), badDense.size()));
+    CHECK(target.size() == chunk_section::BLOCK_COUNT);
+}
+
+void testSharedChunkCache() {
+    std::string name = "/libanvil_test_" + std::to_string(::getpid());
+    shared_chunk_cache::remove(name);
+    std::vector<char> payload(1000);
+    for (size_t i = 0; i < payload.size(); ++i) {
+        payload[i] = static_cast<char>(i * 3);
+    }
+    shared_chunk_cache::key key{0, 4, -5, 1234}, other{0, 4, -5, 1235};
+    {
+        shared_chunk_cache cache(name, 4096, 10);
+        CHECK(cache.get_slot_count() == 16 && cache.get_capacity() == 4096 && cache.get_used() == 0);
+        CHECK(cache.insert(key, payload) && !cache.insert(other, std::vector<char>()));
+        array_view<const char> found = cache.find(key);
+        CHECK(found.size() == payload.size() && std::equal(payload.begin(), payload.end(), found.data()));
+        CHECK(cache.find(other).empty());
+        CHECK(!cache.insert(other, std::vector<char>(8192)));
+
+        // a second mapping keeps the creator's layout and sees its payloads
+        shared_chunk_cache attached(name, 1, 1);
+        CHECK(attached.get_slot_count() == 16 && attached.get_capacity() == 4096);
+        CHECK(attached.find(key).size() == payload.size());
+
+        // a payload location pointing outside the arena is never returned
+        size_t size = 0;
+        char* base = mapSegment(name, size);
+        CHECK(base != nullptr);
+        if (base) {
+            for (char* slot = base + 64; slot + 40 <= base + size && slot < base + 64 + 16 * 40; slot += 40) {
+                uint32_t state;
+                std::memcpy(&state, slot, sizeof(state));
+                if (state == 2) {
+                    uint64_t offset = 4000;
+                    std::memcpy(slot + 24, &offset, sizeof(offset));
+                }
+            }
+            CHECK(cache.find(key).empty() && attached.find(key).empty());
+
+            // a zero slot count in the header is refused on attach
+            uint64_t zero = 0;
+            std::memcpy(base + 8, &zero, sizeof(zero));
+            munmap(base, size);
+        }
+        bool threw = false;
+        try {
+            shared_chunk_cache broken(name, 4096, 16);
+        } catch (std::runtime_error const&) {
+            threw = true;
+        }
+        CHECK(threw);
+    }
+    shared_chunk_cache::remove(name);
+
+    // registries publish decoded chunks for each other
+    std::vector<uint16_t> indices(chunk_section::BLOCK_COUNT);
+    for (size_t i = 0; i < indices.size(); ++i) {
+        indices[i] = static_cast<uint16_t>(i % 2);
+    }
+    std::filesystem::path folder = scratchDirectory() / "shared";
+    std::filesystem::create_directories(folder);
+    writeRegion((folder / "r.0.0.mca").string(), {
+        {0, zlibChunk(chunkRoot(chunk_format::ROOT_SECTIONS_VERSION, 0, 0, {
+                sectionTag(chunk_format::ROOT_SECTIONS, 0, {paletteEntry("minecraft:air"), paletteEntry("minecraft:stone")}, indices)}))},
+    });
+    auto shared = std::make_shared<shared_chunk_cache>(name, 1 << 20, 64);
+    ChunkRegistry first(folder.string()), second(folder.string());
+    first.setSharedCache(shared, 0);
+    second.setSharedCache(shared, 0);
+    std::shared_ptr<Chunk> decoded = first.getChunk(0, 0), reused = second.getChunk(0, 0);
+    CHECK(first.getStats().misses == 1 && second.getStats().sharedHits == 1 && second.getStats().misses == 0);
+    CHECK(reused->getBlockIdAt(1, 0, 0) == decoded->getBlockIdAt(1, 0, 0) && reused->size() == decoded->size());
+    shared_chunk_cache::remove(name);
+}
+
+void testChunkSidecar() {
+    std::string region = scratchPath("r.7.0.mca"), path = chunk_sidecar::get_default_path(region);
+    std::vector<char> payload{1, 2, 3, 4, 5};
+    {
+        chunk_sidecar sidecar(path, region);
+        CHECK(!sidecar.is_dirty() && sidecar.find(3, 10, 8197).empty());
+        sidecar.insert(3, 10, 8197, payload);
+        CHECK(sidecar.is_dirty() && sidecar.find(3, 10, 8197).size() == payload.size());
+        CHECK(sidecar.find(3, 11, 8197).empty() && sidecar.find(3, 10, 12293).empty() && sidecar.find(4, 10, 8197).empty());
+        sidecar.save();
+        CHECK(!sidecar.is_dirty());
+    }
+
+    // saved entries are read back, and only for the same region and chunk version
+    {
+        chunk_sidecar sidecar(path, region);
+        array_view<const char> found = sidecar.find(3, 10, 8197);
+        CHECK(found.size() == payload.size() && std::equal(payload.begin(), payload.end(), found.data()));
+        CHECK(sidecar.find(3, 11, 8197).empty() && sidecar.find(3, 10, 12293).empty());
+        chunk_sidecar other(path, scratchPath("r.8.0.mca"));
+        CHECK(other.find(3, 10, 8197).empty());
+    }
+    std::vector<char> bytes;
+    {
+        std::ifstream file(path, std::ios::binary);
+        bytes.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    }
+    std::vector<char> corrupt = bytes;
+    corrupt[4] ^= 0x55;  // version
+    std::ofstream(path, std::ios::binary).write(corrupt.data(), static_cast<std::streamsize>(corrupt.size()));
+    CHECK(chunk_sidecar(path, region).find(3, 10, 8197).empty());
+    std::ofstream(path, std::ios::binary).write(bytes.data(), static_cast<std::streamsize>(bytes.size() / 2));
+    CHECK(chunk_sidecar(path, region).find(3, 10, 8197).empty());
+    std::filesystem::remove(path);
+
+    // readers serve chunks from the sidecar until the header says the chunk moved or changed
+    std::vector<uint16_t> indices(chunk_section::BLOCK_COUNT, 1);
+    auto chunkOf = [&indices](char const* name, int32_t modified) {
+        return zlibChunk(chunkRoot(chunk_format::ROOT_SECTIONS_VERSION, 225, 0, {
+                sectionTag(chunk_format::ROOT_SECTIONS, 0, {paletteEntry("minecraft:air"), paletteEntry(name)}, indices)}), modified);
+    };
+    RegionChunk filler = chunkOf("minecraft:air", 1), wideFiller = filler;
+    wideFiller.payload.resize(wideFiller.payload.size() + 2 * 4096);
+    auto readSecond = [&region, &path]() {
+        region_file_reader reader(region);
+        reader.set_decode_and_drop(true);
+        reader.read(true);
+        reader.set_sidecar(std::make_shared<chunk_sidecar>(path, region));
+        std::shared_ptr<Chunk> chunk = std::make_shared<Chunk>(std::array<int32_t, 2>{1, 0});
+        std::string name = reader.tryReadChunk(chunk) == chunk_status::OK
+                           ? block_registry::get_instance().get_name(*chunk->getBlockIdAt(0, 0, 0)) : "";
+        if (reader.get_sidecar()->is_dirty()) {
+            reader.get_sidecar()->save();
+        }
+        return name;
+    };
+    writeRegion(region, {{0, filler}, {1, chunkOf("minecraft:stone", 100)}});
+    CHECK(readSecond() == "minecraft:stone");
+    writeRegion(region, {{0, filler}, {1, chunkOf("minecraft:dirt", 100)}});
+    CHECK(readSecond() == "minecraft:stone");
+    writeRegion(region, {{0, filler}, {1, chunkOf("minecraft:dirt", 101)}});
+    CHECK(readSecond() == "minecraft:dirt");
+    writeRegion(region, {{0, wideFiller}, {1, chunkOf("minecraft:sand", 101)}});
+    CHECK(readSecond() == "minecraft:sand");
+    CHECK(readSecond() == "minecraft:sand");
+}
+
+void testIncrementalScan() {
+    std::vector<uint16_t> indices(chunk_section::BLOCK_COUNT, 0);
+    auto chunkAt = [&indices](int x, int32_t modified) {
+        return zlibChunk(chunkRoot(chunk_format::ROOT_SECTIONS_VERSION, x, 0,
+                                   {sectionTag(chunk_format::ROOT_SECTIONS, 0, {paletteEntry("minecraft:stone")}, indices)}), modified);
+    };
+    std::filesystem::path folder = scratchDirectory() / "scan";
+    std::filesystem::create_directories(folder);
+    std::string region = (folder / "r.0.0.mca").string(), other = (folder / "r.1.0.mca").string(),
+                manifest = (folder / "manifest.txt").string();
+    writeRegion(region, {{0, chunkAt(0, 1)}, {1, chunkAt(1, 1)}, {2, chunkAt(2, 1)}});
+    writeRegion(other, {{0, chunkAt(32, 1)}});
+
+    std::vector<std::string> events;
+    bool readable = true;
+    auto track = [&](incremental_scan& scanner) {
+        scanner.set_added([&](region_file_reader& reader, unsigned int x, unsigned int z) {
+            readable &= reader.is_filled(x, z);
+            events.push_back("added " + std::to_string(x) + " " + std::to_string(z));
+        });
+        scanner.set_changed([&](region_file_reader&, unsigned int x, unsigned int) {
+            events.push_back("changed " + std::to_string(x));
+        });
+        scanner.set_removed([&](std::string const& path, unsigned int x, unsigned int) {
+            events.push_back("removed " + std::to_string(x) + (path == region ? "" : " other"));
+        });
+    };
+
+    incremental_scan scanner;
+    track(scanner);
+    scanner.scan({region, other});
+    CHECK(readable && events == (std::vector<std::string>{"added 0 0", "added 1 0", "added 2 0", "added 0 0"}));
+    events.clear();
+    scanner.scan({region, other});
+    CHECK(events.empty());
+
+    // a new timestamp, a moved chunk with the old timestamp, a removed and an added chunk
+    RegionChunk wide = chunkAt(0, 2);
+    wide.payload.resize(wide.payload.size() + 2 * 4096);
+    writeRegion(region, {{0, wide}, {1, chunkAt(1, 1)}, {3, chunkAt(3, 1)}});
+    scanner.scan({region});
+    CHECK(events == (std::vector<std::string>{"changed 0", "changed 1", "added 3 0", "removed 2"}));
+    CHECK(scanner.get_manifest().size() == 2 && scanner.get_manifest().at(region).size() == 3);
+
+    // the manifest survives a restart
+    scanner.save(manifest);
+    incremental_scan restarted;
+    track(restarted);
+    restarted.load(manifest);
+    events.clear();
+    restarted.scan({region, other});
+    CHECK(events.empty() && restarted.get_manifest().at(region).size() == 3);
+
+    // a deleted region reports all its chunks, unlisted regions on disk are kept
+    std::filesystem::remove(region);
+    restarted.scan({});
+    CHECK(events == (std::vector<std::string>{"removed 0", "removed 1", "removed 3"}));
+    CHECK(restarted.get_manifest().size() == 1 && restarted.get_manifest().count(other));
+
+    std::ofstream(manifest) << "libanvil-manifest 1\n5 6 7\n";
+    bool threw = false;
+    try {
+        restarted.load(manifest);
+    } catch (std::runtime_error const&) {
+        threw = true;
+    }
+    CHECK(threw);
+}
+
+}
 
-// Simple compilation test to check if zlib is correctly linked
 int main(int /* argc */, char ** /* argv */) {
+    // zlib is linked
     z_stream zs;
-    return 0;
-}
\ No newline at end of file
+    (void) zs;
+
+    testValueTag();
+    testChunkTagSharing();
+    testMoveAwareTags();
+    testSectionDecode();
+    testPackedArray();
+    testChunkFormat();
+    testChunkBlocks();
+    testBlockRegistry();
+    testBlockStates();
+    testBlockSearch();
+    testBlockHistogram();
+    testBlockVisitors();
+    testBoxQuery();
+    testSkippedChunks();
+    testChunkSurface();
+    testLightAndHeightmaps();
+    testBiomeGrid();
+    testLegacySection();
+    testChunkView();
+    testChunkStatus();
+    testSparseArray();
+    testDecodeAndDrop();
+    testChunkCacheTiers();
+    testSectionSerialization();
+    testSharedChunkCache();
+    testChunkSidecar();
+    testIncrementalScan();
+
+    std::filesystem::remove_all(scratchDirectory());
+    if (failures) {
+        std::cerr << failures << " check(s) failed" << std::endl;
+    }
+    return failures > 125 ? 125 : failures;
+}
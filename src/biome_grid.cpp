@@ -0,0 +1,222 @@
+/*
+ * biome_grid.cpp
+ * Copyright (C) 2012 - 2019 David Jolly
+ * ----------------------
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+#include <stdexcept>
+#include "../include/biome_grid.h"
+#include "../include/chunk_format.h"
+#include "../include/region_dim.h"
+#include "../include/packed_array.h"
+#include "../include/region_file_reader.h"
+#include "../include/tag/byte_array_tag.h"
+#include "../include/tag/int_array_tag.h"
+#include "../include/tag/long_array_tag.h"
+#include "../include/tag/string_tag.h"
+
+/*
+ * Number of cells in a 1.18+ section
+ */
+static const unsigned int SECTION_CELLS = 64;
+
+/*
+ * Decode the biomes of a chunk's root compound. Returns false if it holds none.
+ */
+bool biome_grid::decode(compound_tag& root) {
+    int legacy_index[256];
+    int min_section = INT32_MAX, max_section = INT32_MIN;
+    uint16_t indices[SECTION_CELLS];
+    chunk_format::GENERATION generation = chunk_format::get_generation(chunk_format::get_data_version(root));
+    biome_registry& registry = biome_registry::get_instance();
+
+    cells.clear();
+    palette.clear();
+    layers = 0;
+    if (generation == chunk_format::ROOT_SECTIONS) {
+        std::vector<std::pair<int, compound_tag*>> sections;
+        list_tag* list = chunk_format::get_sections(root, generation);
+        if (!list)
+            return false;
+
+        // collect sections holding biomes, the grid spans from the lowest to the highest one
+        for (generic_tag* entry : list->get_view()) {
+            compound_tag* section = static_cast<compound_tag*>(entry);
+            generic_tag* biomes = section->get_subtag("biomes");
+            int y;
+            if (!chunk_format::get_section_y(section, y) || !biomes || biomes->get_type() != generic_tag::COMPOUND)
+                continue;
+            min_section = std::min(min_section, y);
+            max_section = std::max(max_section, y);
+            sections.push_back(std::make_pair(y, static_cast<compound_tag*>(biomes)));
+        }
+        if (sections.empty())
+            return false;
+        resize(2, static_cast<unsigned int>(max_section - min_section + 1) * 4, min_section * 16);
+
+        // section cells are ordered like grid layers, each section fills 4 consecutive layers
+        for (const std::pair<int, compound_tag*>& section : sections) {
+            generic_tag* palette_tag = section.second->get_subtag("palette"), * data_tag = section.second->get_subtag("data");
+            if (!palette_tag || palette_tag->get_type() != generic_tag::LIST)
+                throw std::runtime_error("Biomes without palette");
+            array_view<generic_tag* const> entries = static_cast<list_tag*>(palette_tag)->get_view();
+            if (entries.empty())
+                continue;
+            std::vector<uint8_t> remap(entries.size());
+            for (size_t i = 0; i < entries.size(); ++i) {
+                if (entries[i]->get_type() != generic_tag::STRING)
+                    throw std::runtime_error("Unexpected biome palette entry type");
+                remap[i] = get_palette_index(registry.get_id(static_cast<string_tag*>(entries[i])->get_value()));
+            }
+            uint8_t* out = cells.data() + static_cast<size_t>(section.first - min_section) * SECTION_CELLS;
+
+            // single entry palettes carry no data, widths have no 4 bit minimum
+            if (entries.size() == 1) {
+                std::fill(out, out + SECTION_CELLS, remap[0]);
+                continue;
+            }
+            unsigned int bits = 1;
+            while ((static_cast<size_t>(1) << bits) < entries.size()) {
+                ++bits;
+            }
+            if (!data_tag || data_tag->get_type() != generic_tag::LONG_ARRAY)
+                throw std::runtime_error("Missing biome data");
+            array_view<const int64_t> data = static_cast<long_array_tag*>(data_tag)->get_view();
+            if (data.size() != packed_array::long_count(bits, true, SECTION_CELLS))
+                throw std::runtime_error("Unexpected biome data length");
+            packed_array::unpack(data, bits, true, indices, SECTION_CELLS);
+            for (unsigned int i = 0; i < SECTION_CELLS; ++i) {
+                if (indices[i] >= remap.size())
+                    throw std::out_of_range("Biome palette index out-of-range");
+                out[i] = remap[indices[i]];
+            }
+        }
+        return true;
+    }
+
+    // older chunks hold numeric ids in Level.Biomes
+    compound_tag* level = chunk_format::get_level(root, generation);
+    generic_tag* biomes = level ? level->get_subtag("Biomes") : NULL;
+    if (!biomes)
+        return false;
+    std::fill(legacy_index, legacy_index + 256, -1);
+    auto map_legacy = [&](int value) {
+        int& index = legacy_index[value & 255];
+        if (index < 0)
+            index = get_palette_index(registry.get_legacy_id(value));
+        return static_cast<uint8_t>(index);
+    };
+    if (biomes->get_type() == generic_tag::BYTE_ARRAY) {
+        array_view<const char> values = static_cast<byte_array_tag*>(biomes)->get_view();
+        if (values.empty())
+            return false;
+        if (values.size() != region_dim::BLOCK_COUNT)
+            throw std::runtime_error("Unexpected Biomes length");
+        resize(0, 1, 0);
+        for (size_t i = 0; i < values.size(); ++i) {
+            cells[i] = map_legacy(static_cast<uint8_t>(values[i]));
+        }
+        return true;
+    }
+    if (biomes->get_type() != generic_tag::INT_ARRAY)
+        throw std::runtime_error("Unexpected Biomes type");
+
+    // 256 values per column (pre-1.15) or 4x4 cells per 4 block layer (1.15+)
+    const std::vector<int>& values = static_cast<int_array_tag*>(biomes)->get_value();
+    if (values.empty())
+        return false;
+    if (values.size() == region_dim::BLOCK_COUNT)
+        resize(0, 1, 0);
+    else if (values.size() % 16 == 0)
+        resize(2, static_cast<unsigned int>(values.size() / 16), 0);
+    else
+        throw std::runtime_error("Unexpected Biomes length");
+    for (size_t i = 0; i < values.size(); ++i) {
+        cells[i] = map_legacy(values[i]);
+    }
+    return true;
+}
+
+/*
+ * Decode the biomes of a region's chunk at a given x, z coord. Returns false if the chunk is
+ * empty or holds no biomes. Chunk tags read by the call are dropped afterwards.
+ */
+bool biome_grid::decode(region_file_reader& reader, unsigned int x, unsigned int z) {
+    bool result = false;
+    compound_tag* root;
+
+    cells.clear();
+    palette.clear();
+    layers = 0;
+    if (!reader.is_filled(x, z))
+        return false;
+    chunk_tag& tag = reader.get_chunk_tag_at(x, z);
+    bool loaded = !tag.get_root_tag().empty();
+    try {
+        chunk_status::STATUS status = reader.try_load_root(x, z, root);
+        if (status != chunk_status::EMPTY) {
+            chunk_status::check(status, x, z);
+            result = decode(*root);
+        }
+    } catch (...) {
+        if (!loaded)
+            tag.clean_root();
+        throw;
+    }
+    if (!loaded)
+        tag.clean_root();
+    return result;
+}
+
+/*
+ * Returns the palette index of a biome id, adding it if needed
+ */
+uint8_t biome_grid::get_palette_index(uint32_t id) {
+    auto iter = std::find(palette.begin(), palette.end(), id);
+
+    if (iter != palette.end())
+        return static_cast<uint8_t>(iter - palette.begin());
+    if (palette.size() > UINT8_MAX)
+        throw std::runtime_error("Biome palette overflow");
+    palette.push_back(id);
+    return static_cast<uint8_t>(palette.size() - 1);
+}
+
+/*
+ * Size the grid for a given cell shift, layer count and lowest y, cells start out as NONE
+ */
+void biome_grid::resize(unsigned int shift, unsigned int layers, int min_y) {
+    unsigned int width = 16 >> shift;
+
+    this->shift = shift;
+    this->layers = layers;
+    this->min_y = min_y;
+    palette.assign(1, biome_registry::NONE);
+    cells.assign(static_cast<size_t>(layers) * width * width, 0);
+}
+
+/*
+ * Return every cell's biome id, ordered like get_cells
+ */
+std::vector<uint32_t> biome_grid::to_ids(void) const {
+    std::vector<uint32_t> ids(cells.size());
+
+    for (size_t i = 0; i < cells.size(); ++i) {
+        ids[i] = palette[cells[i]];
+    }
+    return ids;
+}
@@ -0,0 +1,149 @@
+/*
+ * biome_registry.cpp
+ * Copyright (C) 2012 - 2019 David Jolly
+ * ----------------------
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+#include <mutex>
+#include <stdexcept>
+#include "../include/biome_registry.h"
+
+/*
+ * Names of numeric biome ids (1.13 - 1.17 names), NULL where unused
+ */
+static const char* LEGACY_NAMES[] = {
+    "ocean", "plains", "desert", "mountains", "forest", "taiga", "swamp", "river", "nether_wastes", "the_end",
+    "frozen_ocean", "frozen_river", "snowy_tundra", "snowy_mountains", "mushroom_fields", "mushroom_field_shore",
+    "beach", "desert_hills", "wooded_hills", "taiga_hills", "mountain_edge", "jungle", "jungle_hills", "jungle_edge",
+    "deep_ocean", "stone_shore", "snowy_beach", "birch_forest", "birch_forest_hills", "dark_forest", "snowy_taiga",
+    "snowy_taiga_hills", "giant_tree_taiga", "giant_tree_taiga_hills", "wooded_mountains", "savanna",
+    "savanna_plateau", "badlands", "wooded_badlands_plateau", "badlands_plateau", "small_end_islands", "end_midlands",
+    "end_highlands", "end_barrens", "warm_ocean", "lukewarm_ocean", "cold_ocean", "deep_warm_ocean",
+    "deep_lukewarm_ocean", "deep_cold_ocean", "deep_frozen_ocean", // 0 - 50
+};
+
+/*
+ * Names of numeric biome ids from 127 on (variants and 1.14+ additions), NULL where unused
+ */
+static const char* LEGACY_VARIANT_NAMES[] = {
+    "the_void", NULL, "sunflower_plains", "desert_lakes", "gravelly_mountains", "flower_forest", "taiga_mountains",
+    "swamp_hills", NULL, NULL, NULL, NULL, NULL, "ice_spikes", NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL,
+    "modified_jungle", NULL, "modified_jungle_edge", NULL, NULL, NULL, "tall_birch_forest", "tall_birch_hills",
+    "dark_forest_hills", "snowy_taiga_mountains", NULL, "giant_spruce_taiga", "giant_spruce_taiga_hills",
+    "modified_gravelly_mountains", "shattered_savanna", "shattered_savanna_plateau", "eroded_badlands",
+    "modified_wooded_badlands_plateau", "modified_badlands_plateau", "bamboo_jungle", "bamboo_jungle_hills",
+    "soul_sand_valley", "crimson_forest", "warped_forest", "basalt_deltas", "dripstone_caves", "lush_caves", // 127 - 175
+};
+
+/*
+ * First numeric id of LEGACY_VARIANT_NAMES
+ */
+static const int LEGACY_VARIANT_BASE = 127;
+
+/*
+ * Biome registry constructor
+ */
+biome_registry::biome_registry(void) {
+    std::fill(legacy_ids, legacy_ids + 256, UINT32_MAX);
+    get_id("");
+}
+
+/*
+ * Returns the process-wide registry
+ */
+biome_registry& biome_registry::get_instance(void) {
+    static biome_registry instance;
+    return instance;
+}
+
+/*
+ * Returns the id of a namespaced biome name, registering it if needed
+ */
+uint32_t biome_registry::get_id(const std::string& name) {
+    {
+        std::shared_lock<std::shared_mutex> lock(mutex);
+        auto iter = ids.find(name);
+        if (iter != ids.end())
+            return iter->second;
+    }
+    std::unique_lock<std::shared_mutex> lock(mutex);
+    return get_id_locked(name);
+}
+
+/*
+ * Returns the id of a biome name, the exclusive lock must be held
+ */
+uint32_t biome_registry::get_id_locked(const std::string& name) {
+    auto iter = ids.find(name);
+
+    if (iter != ids.end())
+        return iter->second;
+    uint32_t id = static_cast<uint32_t>(names.size());
+    names.push_back(name);
+    ids.emplace(name, id);
+    return id;
+}
+
+/*
+ * Returns the id of a numeric (pre-1.18) biome id, registering it if needed
+ */
+uint32_t biome_registry::get_legacy_id(int legacy) {
+    legacy &= 255; // stored as unsigned bytes in the oldest chunks
+    {
+        std::shared_lock<std::shared_mutex> lock(mutex);
+        if (legacy_ids[legacy] != UINT32_MAX)
+            return legacy_ids[legacy];
+    }
+    std::unique_lock<std::shared_mutex> lock(mutex);
+    if (legacy_ids[legacy] == UINT32_MAX)
+        legacy_ids[legacy] = get_id_locked(get_legacy_name(legacy));
+    return legacy_ids[legacy];
+}
+
+/*
+ * Returns the namespaced name of a numeric (pre-1.18) biome id (minecraft:unknown_<id> if unknown)
+ */
+std::string biome_registry::get_legacy_name(int legacy) {
+    const char* name = NULL;
+    const int name_count = static_cast<int>(sizeof(LEGACY_NAMES) / sizeof(LEGACY_NAMES[0])),
+        variant_count = static_cast<int>(sizeof(LEGACY_VARIANT_NAMES) / sizeof(LEGACY_VARIANT_NAMES[0]));
+
+    if (legacy >= 0 && legacy < name_count)
+        name = LEGACY_NAMES[legacy];
+    else if (legacy >= LEGACY_VARIANT_BASE && legacy < LEGACY_VARIANT_BASE + variant_count)
+        name = LEGACY_VARIANT_NAMES[legacy - LEGACY_VARIANT_BASE];
+    return name ? std::string("minecraft:") + name : "minecraft:unknown_" + std::to_string(legacy);
+}
+
+/*
+ * Returns the namespaced name of an id
+ */
+const std::string& biome_registry::get_name(uint32_t id) const {
+    std::shared_lock<std::shared_mutex> lock(mutex);
+
+    if (id >= names.size())
+        throw std::out_of_range("Biome id out-of-range");
+    return names[id];
+}
+
+/*
+ * Returns the number of registered biomes
+ */
+size_t biome_registry::size(void) const {
+    std::shared_lock<std::shared_mutex> lock(mutex);
+    return names.size();
+}
@@ -0,0 +1,227 @@
+/*
+ * block_histogram.cpp
+ * Copyright (C) 2012 - 2019 David Jolly
+ * ----------------------
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "../include/block_histogram.h"
+#include "../include/packed_array.h"
+#include "../include/parallel.h"
+
+/*
+ * Number of blocks in a section layer
+ */
+static const unsigned int LAYER_COUNT = 256;
+
+/*
+ * Add count blocks of a given id to a count vector
+ */
+void block_histogram::add_to(std::vector<uint64_t>& dest, uint32_t id, uint64_t count) {
+    if (id >= dest.size())
+        dest.resize(id + 1, 0);
+    dest[id] += count;
+}
+
+/*
+ * Count palette indices and add them through the palette, optionally to a layer
+ */
+void block_histogram::add_indices(const uint16_t* indices, unsigned int count, const uint32_t* palette, unsigned int palette_size,
+        int32_t y) {
+    tally.assign(palette_size, 0);
+    packed_array::count(indices, count, tally.data(), palette_size);
+    for (unsigned int i = 0; i < palette_size; ++i) {
+        if (!tally[i])
+            continue;
+        add_to(counts, palette[i], tally[i]);
+        if (per_y)
+            add_to(layers[y], palette[i], tally[i]);
+    }
+}
+
+/*
+ * Add count blocks of a given id at a given world y (ignored unless per_y)
+ */
+void block_histogram::add(uint32_t id, int32_t y, uint64_t count) {
+    add_to(counts, id, count);
+    if (per_y)
+        add_to(layers[y], id, count);
+}
+
+/*
+ * Add every block of a loaded chunk
+ */
+void block_histogram::add_chunk(const Chunk& chunk) {
+    const std::vector<uint32_t>& palette = chunk.getPalette();
+
+    chunk.visitSections([&](int32_t section_y, const uint16_t* indices, uint16_t uniform) {
+
+        // uniform sections count in O(1)
+        if (!indices) {
+            for (int32_t y = 0; y < (per_y ? 16 : 1); ++y) {
+                add(palette[uniform], section_y * 16 + y, per_y ? LAYER_COUNT : chunk_section::BLOCK_COUNT);
+            }
+            return;
+        }
+        if (!per_y) {
+            add_indices(indices, chunk_section::BLOCK_COUNT, palette.data(), static_cast<unsigned int>(palette.size()), 0);
+            return;
+        }
+        for (unsigned int y = 0; y < 16; ++y) {
+            add_indices(indices + y * LAYER_COUNT, LAYER_COUNT, palette.data(), static_cast<unsigned int>(palette.size()),
+                section_y * 16 + static_cast<int32_t>(y));
+        }
+    });
+}
+
+/*
+ * Add every block of a region's chunk at a given x, z coord
+ */
+void block_histogram::add_chunk(region_file_reader& reader, unsigned int x, unsigned int z) {
+
+    // chunks without sections are skipped without unwinding
+    chunk_status::STATUS status = try_add_chunk(reader, x, z);
+    if (status != chunk_status::EMPTY)
+        chunk_status::check(status, x, z);
+}
+
+/*
+ * Add every block of a decoded section
+ */
+void block_histogram::add_section(const chunk_section& section) {
+    const std::vector<uint32_t>& palette = section.get_palette();
+    int32_t base_y = section.get_y() * 16;
+
+    // single entry palettes count in O(1)
+    if (palette.size() == 1) {
+        for (int32_t y = 0; y < (per_y ? 16 : 1); ++y) {
+            add(palette[0], base_y + y, per_y ? LAYER_COUNT : chunk_section::BLOCK_COUNT);
+        }
+        return;
+    }
+    if (!per_y) {
+        add_indices(section.get_indices(), chunk_section::BLOCK_COUNT, palette.data(), static_cast<unsigned int>(palette.size()), 0);
+        return;
+    }
+    for (unsigned int y = 0; y < 16; ++y) {
+        add_indices(section.get_indices() + y * LAYER_COUNT, LAYER_COUNT, palette.data(), static_cast<unsigned int>(palette.size()),
+            base_y + static_cast<int32_t>(y));
+    }
+}
+
+/*
+ * Returns the count of a given id at a given world y (per_y only)
+ */
+uint64_t block_histogram::get_count(uint32_t id, int32_t y) const {
+    auto iter = layers.find(y);
+
+    if (iter == layers.end() || id >= iter->second.size())
+        return 0;
+    return iter->second[id];
+}
+
+/*
+ * Returns every non-zero (id, count) pair, ordered by id
+ */
+std::vector<std::pair<uint32_t, uint64_t>> block_histogram::get_counts(void) const {
+    std::vector<std::pair<uint32_t, uint64_t>> result;
+
+    for (uint32_t id = 0; id < counts.size(); ++id) {
+        if (counts[id])
+            result.emplace_back(id, counts[id]);
+    }
+    return result;
+}
+
+/*
+ * Returns the total number of counted blocks
+ */
+uint64_t block_histogram::get_total(void) const {
+    uint64_t total = 0;
+
+    for (uint64_t count : counts) {
+        total += count;
+    }
+    return total;
+}
+
+/*
+ * Add another histogram's counts
+ */
+void block_histogram::merge(const block_histogram& other) {
+    for (uint32_t id = 0; id < other.counts.size(); ++id) {
+        if (other.counts[id])
+            add_to(counts, id, other.counts[id]);
+    }
+    if (!per_y)
+        return;
+    for (const auto& layer : other.layers) {
+        std::vector<uint64_t>& dest = layers[layer.first];
+        for (uint32_t id = 0; id < layer.second.size(); ++id) {
+            if (layer.second[id])
+                add_to(dest, id, layer.second[id]);
+        }
+    }
+}
+
+/*
+ * Count every chunk of region files, in parallel across chunks and regions
+ * (thread_count 0 for one thread per core). Corrupt and unsupported chunks are skipped
+ * and passed to skipped, if set, concurrently from worker threads.
+ */
+block_histogram block_histogram::of_regions(const std::vector<std::string>& paths, bool per_y, unsigned int thread_count,
+        const parallel::skip_work& skipped) {
+    block_histogram result(per_y);
+
+    // one histogram per thread, merged once all are done
+    thread_count = parallel::get_thread_count(thread_count);
+    std::vector<block_histogram> partial(thread_count, block_histogram(per_y));
+    parallel::for_each_chunk(paths, thread_count,
+        [&](region_file_reader& reader, unsigned int x, unsigned int z, size_t, unsigned int thread) {
+            chunk_status::STATUS status = partial[thread].try_add_chunk(reader, x, z);
+            if (status != chunk_status::OK && status != chunk_status::EMPTY && skipped)
+                skipped(reader, x, z, status);
+        });
+    for (const block_histogram& histogram : partial) {
+        result.merge(histogram);
+    }
+    return result;
+}
+
+/*
+ * Non-throwing add_chunk: empty, corrupt and unsupported chunks are reported through the status.
+ * A corrupt chunk keeps the sections counted before the error was found.
+ */
+chunk_status::STATUS block_histogram::try_add_chunk(region_file_reader& reader, unsigned int x, unsigned int z) {
+    int x_pos, z_pos;
+    chunk_format::GENERATION generation;
+    chunk_section section;
+    list_tag* sections;
+
+    chunk_status::STATUS status = reader.try_get_chunk_sections(x, z, generation, x_pos, z_pos, sections);
+    if (status != chunk_status::OK)
+        return status;
+    try {
+        for (generic_tag* entry : sections->get_view()) {
+            if (chunk_section::decode(static_cast<compound_tag*>(entry), generation, section))
+                add_section(section);
+        }
+    } catch (const std::runtime_error&) {
+        return chunk_status::CORRUPT; // malformed block states
+    } catch (const std::out_of_range&) {
+        return chunk_status::CORRUPT; // palette index past the palette
+    }
+    return chunk_status::OK;
+}
@@ -0,0 +1,178 @@
+/*
+ * block_registry.cpp
+ * Copyright (C) 2012 - 2019 David Jolly
+ * ----------------------
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+#include <mutex>
+#include <stdexcept>
+#include "../include/block_registry.h"
+#include "../include/tag/string_tag.h"
+
+/*
+ * Block registry constructor
+ */
+block_registry::block_registry(void) {
+    get_id("minecraft:air");
+}
+
+/*
+ * Returns the process-wide registry
+ */
+block_registry& block_registry::get_instance(void) {
+    static block_registry instance;
+    return instance;
+}
+
+/*
+ * Returns the canonical state string of a name and (sorted) properties
+ */
+std::string block_registry::get_state_string(const std::string& name, const property_list& properties) {
+    std::string state = name;
+
+    if (!properties.empty()) {
+        state += '[';
+        for (size_t i = 0; i < properties.size(); ++i) {
+            if (i)
+                state += ',';
+            state += properties[i].first;
+            state += '=';
+            state += properties[i].second;
+        }
+        state += ']';
+    }
+    return state;
+}
+
+/*
+ * Returns the key of a property name, or NO_KEY if it was never interned
+ */
+block_state::key_type block_registry::find_key(const std::string& key) const {
+    std::shared_lock<std::shared_mutex> lock(mutex);
+    auto iter = keys.find(key);
+
+    return iter != keys.end() ? iter->second : NO_KEY;
+}
+
+/*
+ * Returns the id of a block state, registering it if needed
+ */
+uint32_t block_registry::get_id(const std::string& name, property_list properties) {
+    std::vector<block_state::key_type> state_keys;
+
+    std::sort(properties.begin(), properties.end());
+    std::string state = get_state_string(name, properties);
+
+    // most lookups hit an existing state
+    {
+        std::shared_lock<std::shared_mutex> lock(mutex);
+        auto iter = ids.find(state);
+        if (iter != ids.end())
+            return iter->second;
+    }
+
+    // register under the exclusive lock, another thread may have won the race
+    std::unique_lock<std::shared_mutex> lock(mutex);
+    auto iter = ids.find(state);
+    if (iter != ids.end())
+        return iter->second;
+    state_keys.reserve(properties.size());
+    for (const auto& property : properties) {
+        state_keys.push_back(intern_key_locked(property.first));
+    }
+    uint32_t id = static_cast<uint32_t>(states.size());
+    states.emplace_back(id, name, std::move(properties), std::move(state_keys), std::string(state));
+    ids.emplace(std::move(state), id);
+    return id;
+}
+
+/*
+ * Returns the id of a palette entry compound (Name, Properties), registering it if needed
+ */
+uint32_t block_registry::get_id(compound_tag* palette_entry) {
+    property_list properties;
+    generic_tag* name = palette_entry->get_subtag("Name");
+
+    if (!name || name->get_type() != generic_tag::STRING)
+        throw std::runtime_error("Palette entry without name");
+
+    // property values are stored as strings
+    generic_tag* props = palette_entry->get_subtag("Properties");
+    if (props && props->get_type() == generic_tag::COMPOUND) {
+        for (generic_tag* prop : static_cast<compound_tag*>(props)->get_value()) {
+            if (prop->get_type() == generic_tag::STRING)
+                properties.emplace_back(prop->get_name(), static_cast<string_tag*>(prop)->get_value());
+        }
+    }
+    return get_id(static_cast<string_tag*>(name)->get_value(), std::move(properties));
+}
+
+/*
+ * Returns the name of an interned property key
+ */
+const std::string& block_registry::get_key_name(block_state::key_type key) const {
+    std::shared_lock<std::shared_mutex> lock(mutex);
+
+    if (key >= key_names.size())
+        throw std::out_of_range("Property key out-of-range");
+    return key_names[key];
+}
+
+/*
+ * Returns the block state of an id
+ */
+const block_state& block_registry::get_state(uint32_t id) const {
+    std::shared_lock<std::shared_mutex> lock(mutex);
+
+    if (id >= states.size())
+        throw std::out_of_range("Block state id out-of-range");
+    return states[id];
+}
+
+/*
+ * Intern a property key
+ */
+block_state::key_type block_registry::intern_key(const std::string& key) {
+    block_state::key_type found = find_key(key);
+
+    if (found != NO_KEY)
+        return found;
+    std::unique_lock<std::shared_mutex> lock(mutex);
+    return intern_key_locked(key);
+}
+
+/*
+ * Intern a property key, the exclusive lock must be held
+ */
+block_state::key_type block_registry::intern_key_locked(const std::string& key) {
+    auto iter = keys.find(key);
+
+    if (iter != keys.end())
+        return iter->second;
+    block_state::key_type result = static_cast<block_state::key_type>(key_names.size());
+    key_names.push_back(key);
+    keys.emplace(key, result);
+    return result;
+}
+
+/*
+ * Returns the number of registered states
+ */
+size_t block_registry::size(void) const {
+    std::shared_lock<std::shared_mutex> lock(mutex);
+    return states.size();
+}
@@ -0,0 +1,180 @@
+/*
+ * block_search.cpp
+ * Copyright (C) 2012 - 2019 David Jolly
+ * ----------------------
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+#include <stdexcept>
+#include "../include/block_registry.h"
+#include "../include/block_search.h"
+#include "../include/chunk_section.h"
+#include "../include/packed_array.h"
+#include "../include/parallel.h"
+#include "../include/region_dim.h"
+#include "../include/tag/string_tag.h"
+
+/*
+ * Find blocks with one of the given names in a section compound. Chunk x, z are in chunks.
+ */
+void block_search::find_in_section(compound_tag* section, chunk_format::GENERATION generation, int chunk_x, int chunk_z,
+        const std::vector<std::string>& names, std::vector<match>& matches) {
+    list_tag* palette;
+    long_array_tag* states;
+    std::vector<uint16_t> targets;
+    std::vector<uint32_t> ids;
+    uint16_t indices[chunk_section::BLOCK_COUNT];
+    uint32_t positions[chunk_section::BLOCK_COUNT];
+    unsigned int found;
+
+    int section_y;
+    if (!chunk_format::get_section_y(section, section_y)
+            || !chunk_section::get_block_states(section, generation, palette, states))
+        return;
+
+    // check the palette first, only matching entries are registered
+    array_view<generic_tag* const> entries = palette->get_view();
+    ids.resize(entries.size());
+    for (size_t i = 0; i < entries.size(); ++i) {
+        generic_tag* name = static_cast<compound_tag*>(entries[i])->get_subtag("Name");
+        if (!name || name->get_type() != generic_tag::STRING)
+            throw std::runtime_error("Palette entry without name");
+        std::string_view view = static_cast<string_tag*>(name)->get_view();
+        if (std::find(names.begin(), names.end(), view) != names.end()) {
+            targets.push_back(static_cast<uint16_t>(i));
+            ids[i] = block_registry::get_instance().get_id(static_cast<compound_tag*>(entries[i]));
+        }
+    }
+    if (targets.empty())
+        return;
+
+    // single entry palettes (1.18+ without data) match every block without unpacking
+    if (entries.size() == 1) {
+        std::fill(indices, indices + chunk_section::BLOCK_COUNT, 0);
+        found = chunk_section::BLOCK_COUNT;
+        for (unsigned int i = 0; i < found; ++i) {
+            positions[i] = i;
+        }
+    } else {
+        if (!states)
+            throw std::runtime_error("Missing block state data");
+        unsigned int bits = chunk_section::get_bits(entries.size());
+        bool padded = generation >= chunk_format::PADDED;
+        array_view<const int64_t> data = states->get_view();
+        if (data.size() != packed_array::long_count(bits, padded, chunk_section::BLOCK_COUNT))
+            throw std::runtime_error("Unexpected BlockStates length");
+        packed_array::unpack(data, bits, padded, indices, chunk_section::BLOCK_COUNT);
+        found = packed_array::find(indices, chunk_section::BLOCK_COUNT, targets, positions);
+    }
+
+    // emit matches in world coords
+    int base_y = section_y * 16;
+    matches.reserve(matches.size() + found);
+    for (unsigned int i = 0; i < found; ++i) {
+        uint32_t index = positions[i];
+        matches.push_back({ { chunk_x * 16 + static_cast<int32_t>(index & 15), base_y + static_cast<int32_t>(index >> 8),
+            chunk_z * 16 + static_cast<int32_t>((index >> 4) & 15) }, ids[indices[index]] });
+    }
+}
+
+/*
+ * Find blocks with one of the given names in a region's chunk at a given x, z coord
+ */
+void block_search::find_in_chunk(region_file_reader& reader, unsigned int x, unsigned int z, const std::vector<std::string>& names,
+        std::vector<match>& matches) {
+
+    // chunks without sections are skipped without unwinding
+    chunk_status::STATUS status = try_find_in_chunk(reader, x, z, names, matches);
+    if (status != chunk_status::EMPTY)
+        chunk_status::check(status, x, z);
+}
+
+/*
+ * Find blocks with one of the given names in every chunk of a region. Corrupt and unsupported
+ * chunks are skipped and passed to skipped, if set.
+ */
+std::vector<block_search::match> block_search::find_in_region(region_file_reader& reader, const std::vector<std::string>& names,
+        const parallel::skip_work& skipped) {
+    std::vector<match> matches;
+
+    for (unsigned int z = 0; z < region_dim::CHUNK_WIDTH; ++z) {
+        for (unsigned int x = 0; x < region_dim::CHUNK_WIDTH; ++x) {
+            if (!reader.is_filled(x, z))
+                continue;
+            chunk_status::STATUS status = try_find_in_chunk(reader, x, z, names, matches);
+            if (status != chunk_status::OK && status != chunk_status::EMPTY && skipped)
+                skipped(reader, x, z, status);
+        }
+    }
+    return matches;
+}
+
+/*
+ * Find blocks with one of the given names in region files, in parallel across chunks and regions
+ * (thread_count 0 for one thread per core). Matches are ordered by region, then chunk. Corrupt and
+ * unsupported chunks are skipped and passed to skipped, if set, concurrently from worker threads.
+ */
+std::vector<block_search::match> block_search::find_in_regions(const std::vector<std::string>& paths,
+        const std::vector<std::string>& names, unsigned int thread_count, const parallel::skip_work& skipped) {
+    std::vector<std::vector<match>> item_matches(paths.size() * parallel::ITEMS_PER_REGION);
+    std::vector<match> matches;
+
+    parallel::for_each_chunk(paths, thread_count,
+        [&](region_file_reader& reader, unsigned int x, unsigned int z, size_t item, unsigned int) {
+            chunk_status::STATUS status = try_find_in_chunk(reader, x, z, names, item_matches[item]);
+            if (status != chunk_status::OK && status != chunk_status::EMPTY && skipped)
+                skipped(reader, x, z, status);
+        });
+
+    // concatenate per-item results in item order
+    size_t total = 0;
+    for (const std::vector<match>& item : item_matches) {
+        total += item.size();
+    }
+    matches.reserve(total);
+    for (const std::vector<match>& item : item_matches) {
+        matches.insert(matches.end(), item.begin(), item.end());
+    }
+    return matches;
+}
+
+/*
+ * Non-throwing find_in_chunk: empty, corrupt and unsupported chunks are reported through the status.
+ * Matches of a corrupt chunk are dropped.
+ */
+chunk_status::STATUS block_search::try_find_in_chunk(region_file_reader& reader, unsigned int x, unsigned int z,
+        const std::vector<std::string>& names, std::vector<match>& matches) {
+    int x_pos, z_pos;
+    list_tag* sections;
+    chunk_format::GENERATION generation;
+    size_t found = matches.size();
+
+    chunk_status::STATUS status = reader.try_get_chunk_sections(x, z, generation, x_pos, z_pos, sections);
+    if (status != chunk_status::OK)
+        return status;
+    try {
+        for (generic_tag* section : sections->get_view()) {
+            find_in_section(static_cast<compound_tag*>(section), generation, x_pos, z_pos, names, matches);
+        }
+    } catch (const std::runtime_error&) {
+        status = chunk_status::CORRUPT; // malformed palette or block states
+    } catch (const std::out_of_range&) {
+        status = chunk_status::CORRUPT; // palette index past the palette
+    }
+    if (status != chunk_status::OK)
+        matches.resize(found);
+    return status;
+}
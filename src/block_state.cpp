@@ -0,0 +1,32 @@
+/*
+ * block_state.cpp
+ * Copyright (C) 2012 - 2019 David Jolly
+ * ----------------------
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "../include/block_registry.h"
+#include "../include/block_state.h"
+
+/*
+ * Returns the value of a property. Returns NULL if not found.
+ */
+const std::string* block_state::get_property(const std::string& key) const {
+    key_type found = block_registry::get_instance().find_key(key);
+
+    if (found == block_registry::NO_KEY)
+        return NULL;
+    return get_property(found);
+}
@@ -0,0 +1,182 @@
+/*
+ * box_query.cpp
+ * Copyright (C) 2012 - 2019 David Jolly
+ * ----------------------
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include "../include/box_query.h"
+
+/*
+ * Box query constructor. Corners are inclusive world coords, in any order.
+ */
+box_query::box_query(const std::string& folder, const std::array<int32_t, 3>& from, const std::array<int32_t, 3>& to)
+        : folder(folder) {
+    for (size_t i = 0; i < 3; ++i) {
+        min[i] = std::min(from[i], to[i]);
+        max[i] = std::max(from[i], to[i]);
+    }
+}
+
+/*
+ * Call visit for every section of the planned chunks overlapping the box, along with the index
+ * of its chunk in the plan. Corrupt and unsupported chunks are passed to skipped, if set.
+ */
+void box_query::for_each_section(const std::vector<std::string>& paths, const std::vector<parallel::chunk_item>& chunks,
+        const item_visitor& visit, unsigned int thread_count, const parallel::skip_work& skipped) const {
+    int section_min = region_dim::floor_div(min[1], region_dim::BLOCK_WIDTH),
+        section_max = region_dim::floor_div(max[1], region_dim::BLOCK_WIDTH);
+
+    std::vector<chunk_section> sections(parallel::get_thread_count(thread_count));
+    parallel::for_each_chunk(paths, chunks, thread_count,
+        [&](region_file_reader& reader, unsigned int x, unsigned int z, size_t item, unsigned int thread) {
+            int x_pos, z_pos;
+            list_tag* list;
+            chunk_format::GENERATION generation;
+            chunk_section& section = sections[thread];
+
+            chunk_status::STATUS status = reader.try_get_chunk_sections(x, z, generation, x_pos, z_pos, list);
+            if (status == chunk_status::OK) {
+                for (generic_tag* entry : list->get_view()) {
+                    compound_tag* tag = static_cast<compound_tag*>(entry);
+                    int y;
+
+                    // the section y is checked before its block states are unpacked
+                    if (!chunk_format::get_section_y(tag, y) || y < section_min || y > section_max)
+                        continue;
+
+                    // only decoding errors mark the chunk corrupt, exceptions from visit propagate
+                    bool decoded;
+                    try {
+                        decoded = chunk_section::decode(tag, generation, section);
+                    } catch (const std::runtime_error&) {
+                        status = chunk_status::CORRUPT;
+                        break;
+                    } catch (const std::out_of_range&) {
+                        status = chunk_status::CORRUPT;
+                        break;
+                    }
+                    if (decoded)
+                        visit(section, x_pos, z_pos, item, thread);
+                }
+            }
+            if (status != chunk_status::OK && status != chunk_status::EMPTY && skipped)
+                skipped(reader, x, z, status);
+        });
+}
+
+/*
+ * Returns every block in the box, in parallel (thread_count 0 for one thread per core).
+ * Blocks are ordered by region, then chunk, then section. Corrupt and unsupported chunks
+ * are skipped and passed to skipped, if set, concurrently from worker threads.
+ */
+std::vector<block_search::match> box_query::get_blocks(unsigned int thread_count, const parallel::skip_work& skipped) const {
+    std::vector<std::string> paths;
+    std::vector<parallel::chunk_item> chunks;
+    std::vector<block_search::match> blocks;
+
+    plan(paths, chunks);
+    std::vector<std::vector<block_search::match>> item_blocks(chunks.size());
+    for_each_section(paths, chunks, [&](const chunk_section& section, int chunk_x, int chunk_z, size_t item, unsigned int) {
+        int32_t base_x = chunk_x * static_cast<int32_t>(region_dim::BLOCK_WIDTH),
+            base_y = section.get_y() * static_cast<int32_t>(region_dim::BLOCK_WIDTH),
+            base_z = chunk_z * static_cast<int32_t>(region_dim::BLOCK_WIDTH);
+        std::vector<block_search::match>& found = item_blocks[item];
+
+        for (int32_t y = std::max(min[1], base_y); y <= std::min(max[1], base_y + 15); ++y) {
+            for (int32_t z = std::max(min[2], base_z); z <= std::min(max[2], base_z + 15); ++z) {
+                for (int32_t x = std::max(min[0], base_x); x <= std::min(max[0], base_x + 15); ++x) {
+                    found.push_back({{x, y, z}, section.get_id_at(x - base_x, y - base_y, z - base_z)});
+                }
+            }
+        }
+    }, thread_count, skipped);
+
+    // concatenate per-item results in item order
+    size_t total = 0;
+    for (const std::vector<block_search::match>& item : item_blocks) {
+        total += item.size();
+    }
+    blocks.reserve(total);
+    for (const std::vector<block_search::match>& item : item_blocks) {
+        blocks.insert(blocks.end(), item.begin(), item.end());
+    }
+    return blocks;
+}
+
+/*
+ * Returns the path of the region file at a given region x, z coord
+ */
+std::string box_query::get_region_path(const std::string& folder, int region_x, int region_z) {
+    std::stringstream path;
+
+    path << folder << "/r." << region_x << "." << region_z << ".mca";
+    return path.str();
+}
+
+/*
+ * Collect the existing region files and the chunks intersecting the box, grouped by region
+ */
+void box_query::plan(std::vector<std::string>& paths, std::vector<parallel::chunk_item>& chunks) const {
+    int chunk_min_x = region_dim::floor_div(min[0], region_dim::BLOCK_WIDTH),
+        chunk_max_x = region_dim::floor_div(max[0], region_dim::BLOCK_WIDTH),
+        chunk_min_z = region_dim::floor_div(min[2], region_dim::BLOCK_WIDTH),
+        chunk_max_z = region_dim::floor_div(max[2], region_dim::BLOCK_WIDTH);
+
+    for (int region_z = region_dim::floor_div(chunk_min_z, region_dim::CHUNK_WIDTH);
+            region_z <= region_dim::floor_div(chunk_max_z, region_dim::CHUNK_WIDTH); ++region_z) {
+        for (int region_x = region_dim::floor_div(chunk_min_x, region_dim::CHUNK_WIDTH);
+                region_x <= region_dim::floor_div(chunk_max_x, region_dim::CHUNK_WIDTH); ++region_x) {
+
+            // regions that were never generated have no file
+            std::string path = get_region_path(folder, region_x, region_z);
+            if (!std::ifstream(path).good())
+                continue;
+
+            // clip the chunk range to the region
+            int base_x = region_x * static_cast<int>(region_dim::CHUNK_WIDTH),
+                base_z = region_z * static_cast<int>(region_dim::CHUNK_WIDTH);
+            int lower_x = std::max(chunk_min_x, base_x) - base_x,
+                upper_x = std::min(chunk_max_x, base_x + static_cast<int>(region_dim::CHUNK_WIDTH) - 1) - base_x,
+                lower_z = std::max(chunk_min_z, base_z) - base_z,
+                upper_z = std::min(chunk_max_z, base_z + static_cast<int>(region_dim::CHUNK_WIDTH) - 1) - base_z;
+            for (int z = lower_z; z <= upper_z; ++z) {
+                for (int x = lower_x; x <= upper_x; ++x) {
+                    chunks.push_back({paths.size(), static_cast<unsigned int>(x), static_cast<unsigned int>(z)});
+                }
+            }
+            paths.push_back(path);
+        }
+    }
+}
+
+/*
+ * Call visit for every section overlapping the box, in parallel (thread_count 0 for one
+ * thread per core). Sections outside the box's y range are skipped before decoding.
+ * Corrupt and unsupported chunks are skipped and passed to skipped, if set, concurrently
+ * from worker threads.
+ */
+void box_query::visit_sections(const section_visitor& visit, unsigned int thread_count, const parallel::skip_work& skipped) const {
+    std::vector<std::string> paths;
+    std::vector<parallel::chunk_item> chunks;
+
+    plan(paths, chunks);
+    for_each_section(paths, chunks, [&](const chunk_section& section, int chunk_x, int chunk_z, size_t, unsigned int thread) {
+        visit(section, chunk_x, chunk_z, thread);
+    }, thread_count, skipped);
+}
@@ -43,6 +43,15 @@ byte_stream::byte_stream(std::vector<char>& buff) {
     numberOfEntries = buff.size();
 }
 
+/*
+ * Byte stream constructor (takes ownership of buff)
+ */
+byte_stream::byte_stream(std::vector<char>&& buff) : buff(std::move(buff)) {
+    pos = 0;
+    swap = NO_SWAP_ENDIAN;
+    numberOfEntries = this->buff.size();
+}
+
 /*
  * Byte stream assignment
  */
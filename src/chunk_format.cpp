@@ -0,0 +1,143 @@
+/*
+ * chunk_format.cpp
+ * Copyright (C) 2012 - 2019 David Jolly
+ * ----------------------
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "../include/chunk_format.h"
+#include "../include/tag/byte_tag.h"
+#include "../include/tag/int_tag.h"
+
+/*
+ * Returns a chunk's DataVersion, or -1 if it has none (pre-1.9)
+ */
+int chunk_format::get_data_version(compound_tag& root) {
+    generic_tag* version = root.get_subtag("DataVersion");
+
+    if (!version || version->get_type() != generic_tag::INT)
+        return -1;
+    return static_cast<int_tag*>(version)->get_value();
+}
+
+/*
+ * Returns the layout used by a given DataVersion
+ */
+chunk_format::GENERATION chunk_format::get_generation(int data_version) {
+    if (data_version >= ROOT_SECTIONS_VERSION)
+        return ROOT_SECTIONS;
+    else if (data_version >= PADDED_VERSION)
+        return PADDED;
+    else if (data_version >= FLATTENED_VERSION)
+        return FLATTENED;
+    return LEGACY;
+}
+
+/*
+ * Returns a packed heightmap (e.g. WORLD_SURFACE, MOTION_BLOCKING) from a chunk's Heightmaps.
+ * Returns NULL if not found.
+ */
+long_array_tag* chunk_format::get_heightmap(compound_tag& root, GENERATION generation, const std::string& name) {
+    generic_tag* heightmaps, * heightmap;
+    compound_tag* level = get_level(root, generation);
+
+    if (!level || generation == LEGACY)
+        return NULL;
+    heightmaps = level->get_subtag("Heightmaps");
+    if (!heightmaps || heightmaps->get_type() != generic_tag::COMPOUND)
+        return NULL;
+    heightmap = static_cast<compound_tag*>(heightmaps)->get_subtag(name);
+    if (!heightmap || heightmap->get_type() != generic_tag::LONG_ARRAY)
+        return NULL;
+    return static_cast<long_array_tag*>(heightmap);
+}
+
+/*
+ * Returns the compound holding a chunk's position and sections (Level, or the root for 1.18+).
+ * Returns NULL if not found.
+ */
+compound_tag* chunk_format::get_level(compound_tag& root, GENERATION generation) {
+    generic_tag* level;
+
+    if (generation == ROOT_SECTIONS)
+        return &root;
+    level = root.get_subtag("Level");
+    if (!level || level->get_type() != generic_tag::COMPOUND)
+        return NULL;
+    return static_cast<compound_tag*>(level);
+}
+
+/*
+ * Retrieve the lowest block y of a chunk, heightmap values are relative to it. Returns false
+ * if it cannot be told (1.18+ chunks without yPos).
+ */
+bool chunk_format::get_min_y(compound_tag& root, GENERATION generation, int& y) {
+    generic_tag* y_pos;
+
+    if (generation != ROOT_SECTIONS) {
+        y = 0;
+        return true;
+    }
+    y_pos = root.get_subtag("yPos");
+    if (!y_pos || y_pos->get_type() != generic_tag::INT)
+        return false;
+    y = static_cast<int_tag*>(y_pos)->get_value() * 16;
+    return true;
+}
+
+/*
+ * Retrieve a chunk's x, z position (in chunks). Returns false if not found.
+ */
+bool chunk_format::get_position(compound_tag& root, GENERATION generation, int& x, int& z) {
+    generic_tag* x_pos, * z_pos;
+    compound_tag* level = get_level(root, generation);
+
+    if (!level)
+        return false;
+    x_pos = level->get_subtag("xPos");
+    z_pos = level->get_subtag("zPos");
+    if (!x_pos || !z_pos || x_pos->get_type() != generic_tag::INT || z_pos->get_type() != generic_tag::INT)
+        return false;
+    x = static_cast<int_tag*>(x_pos)->get_value();
+    z = static_cast<int_tag*>(z_pos)->get_value();
+    return true;
+}
+
+/*
+ * Retrieve a section's y (in sections). Returns false if it has no Y byte.
+ */
+bool chunk_format::get_section_y(compound_tag* section, int& y) {
+    generic_tag* y_tag = section->get_subtag("Y");
+
+    if (!y_tag || y_tag->get_type() != generic_tag::BYTE)
+        return false;
+    y = static_cast<byte_tag*>(y_tag)->get_value();
+    return true;
+}
+
+/*
+ * Returns a chunk's section list. Returns NULL if not found.
+ */
+list_tag* chunk_format::get_sections(compound_tag& root, GENERATION generation) {
+    generic_tag* sections;
+    compound_tag* level = get_level(root, generation);
+
+    if (!level)
+        return NULL;
+    sections = level->get_subtag(generation == ROOT_SECTIONS ? "sections" : "Sections");
+    if (!sections || sections->get_type() != generic_tag::LIST)
+        return NULL;
+    return static_cast<list_tag*>(sections);
+}
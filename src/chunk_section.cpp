@@ -0,0 +1,134 @@
+/*
+ * chunk_section.cpp
+ * Copyright (C) 2012 - 2019 David Jolly
+ * ----------------------
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+#include <stdexcept>
+#include "../include/block_registry.h"
+#include "../include/chunk_section.h"
+#include "../include/packed_array.h"
+#include "../include/tag/list_tag.h"
+#include "../include/tag/long_array_tag.h"
+
+/*
+ * Decode a section compound of a given layout in a single pass.
+ * Returns false if the section holds no block data.
+ */
+bool chunk_section::decode(compound_tag* section, chunk_format::GENERATION generation, chunk_section& sect) {
+    unsigned int bits;
+    uint16_t max_index = 0;
+    list_tag* palette_tag;
+    long_array_tag* states_tag;
+
+    // collect section tags
+    if (!chunk_format::get_section_y(section, sect.y) || !get_block_states(section, generation, palette_tag, states_tag))
+        return false; // air-only sections are empty
+
+    // resolve the palette entries to block state ids once
+    array_view<generic_tag* const> entries = palette_tag->get_view();
+    if (entries.empty())
+        return false;
+    block_registry& registry = block_registry::get_instance();
+    sect.palette.clear();
+    sect.palette.reserve(entries.size());
+    for (generic_tag* entry : entries) {
+        sect.palette.push_back(registry.get_id(static_cast<compound_tag*>(entry)));
+    }
+
+    // single entry palettes (1.18+) carry no data
+    if (!states_tag) {
+        if (sect.palette.size() != 1)
+            throw std::runtime_error("Missing block state data");
+        std::fill(sect.indices, sect.indices + BLOCK_COUNT, 0);
+        return true;
+    }
+
+    // the packing rule follows from the layout, the length must match it exactly
+    bits = get_bits(sect.palette.size());
+    bool padded = generation >= chunk_format::PADDED;
+    array_view<const int64_t> states = states_tag->get_view();
+    if (states.size() != packed_array::long_count(bits, padded, BLOCK_COUNT))
+        throw std::runtime_error("Unexpected BlockStates length");
+    packed_array::unpack(states, bits, padded, sect.indices, BLOCK_COUNT);
+
+    // validate indices against the palette
+    for (unsigned int i = 0; i < BLOCK_COUNT; ++i) {
+        max_index = std::max(max_index, sect.indices[i]);
+    }
+    if (max_index >= sect.palette.size())
+        throw std::out_of_range("Palette index out-of-range");
+    return true;
+}
+
+/*
+ * Return the block name at a given x, y, z coord (relative to the section)
+ */
+const std::string& chunk_section::get_name_at(unsigned int x, unsigned int y, unsigned int z) const {
+    return block_registry::get_instance().get_name(get_id_at(x, y, z));
+}
+
+/*
+ * Returns the number of bits per block index for a given palette size
+ */
+unsigned int chunk_section::get_bits(size_t palette_size) {
+    unsigned int bits = 4;
+
+    // the number of bits per index depends on the palette size (4 minimum)
+    while ((static_cast<size_t>(1) << bits) < palette_size) {
+        ++bits;
+    }
+    return bits;
+}
+
+/*
+ * Retrieve a section's palette and packed block states for a given layout. States are
+ * NULL when a 1.18+ palette holds a single entry. Returns false if the section holds no block data.
+ */
+bool chunk_section::get_block_states(compound_tag* section, chunk_format::GENERATION generation, list_tag*& palette,
+        long_array_tag*& states) {
+    generic_tag* palette_tag, * states_tag;
+    compound_tag* container = section;
+
+    switch (generation) {
+        case chunk_format::FLATTENED:
+        case chunk_format::PADDED:
+            palette_tag = section->get_subtag("Palette");
+            states_tag = section->get_subtag("BlockStates");
+            if (!states_tag)
+                return false;
+            break;
+        case chunk_format::ROOT_SECTIONS:
+            container = static_cast<compound_tag*>(section->get_subtag("block_states"));
+            if (!container || container->get_type() != generic_tag::COMPOUND)
+                return false;
+            palette_tag = container->get_subtag("palette");
+            states_tag = container->get_subtag("data");
+            break;
+        default:
+            return false; // numeric block ids have no palette
+    }
+
+    // check tag types
+    if (!palette_tag || palette_tag->get_type() != generic_tag::LIST)
+        return false;
+    if (states_tag && states_tag->get_type() != generic_tag::LONG_ARRAY)
+        throw std::runtime_error("Unexpected BlockStates type");
+    palette = static_cast<list_tag*>(palette_tag);
+    states = static_cast<long_array_tag*>(states_tag);
+    return true;
+}
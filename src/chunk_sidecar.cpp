@@ -0,0 +1,263 @@
+/*
+ * chunk_sidecar.cpp
+ * Copyright (C) 2012 - 2019 David Jolly
+ * ----------------------
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+#include "../include/chunk_sidecar.h"
+#include "../include/region_dim.h"
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define CHUNK_SIDECAR_MMAP
+#endif
+
+namespace {
+
+/*
+ * Sidecar file magic
+ */
+const char SIDECAR_MAGIC[4] = { 'A', 'C', 'S', 'D' };
+
+/*
+ * Written as is, a file of the other byte order reads it swapped
+ */
+const uint32_t BYTE_ORDER_MARK = 0x01020304;
+
+/*
+ * Alignment of the entry table and every payload
+ */
+const size_t ALIGNMENT = 8;
+
+size_t align(size_t value) {
+    return (value + ALIGNMENT - 1) & ~(ALIGNMENT - 1);
+}
+}
+
+/*
+ * Sidecar file header, followed by the region path (padded to ALIGNMENT)
+ */
+struct chunk_sidecar::file_header {
+    char magic[4];
+    uint32_t version;
+    uint32_t byte_order;
+    uint32_t entry_count;
+    uint64_t region_path_length;
+};
+
+/*
+ * Sidecar table entry, empty if size is 0. Data offsets are relative to the start of the file.
+ */
+struct chunk_sidecar::file_entry {
+    uint32_t modified;
+    uint32_t reserved;
+    uint64_t offset;
+    uint64_t data_offset;
+    uint64_t size;
+};
+
+/*
+ * Chunk sidecar constructor, loading path if it holds a valid sidecar for region_path
+ */
+chunk_sidecar::chunk_sidecar(const std::string& path, const std::string& region_path)
+        : path(path), region_path(region_path), mapped(NULL), mapped_size(0), entries(NULL) {
+    load();
+}
+
+/*
+ * Chunk sidecar destructor, unsaved entries are dropped
+ */
+chunk_sidecar::~chunk_sidecar(void) {
+    unload();
+}
+
+/*
+ * Returns the payload cached for a chunk index, empty if missing or stale (the timestamp
+ * or data offset differ). Valid until the next insert or save.
+ */
+array_view<const char> chunk_sidecar::find(unsigned int index, uint32_t modified, uint64_t offset) const {
+    if (index >= region_dim::CHUNK_COUNT)
+        throw std::out_of_range("index out-of-range");
+
+    // entries added during this run supersede the file's
+    auto iter = pending.find(index);
+    if (iter != pending.end()) {
+        if (iter->second.modified != modified || iter->second.offset != offset)
+            return array_view<const char>();
+        return array_view<const char>(iter->second.payload);
+    }
+    if (!entries)
+        return array_view<const char>();
+    const file_entry& entry = entries[index];
+    if (!entry.size || entry.modified != modified || entry.offset != offset)
+        return array_view<const char>();
+    return array_view<const char>(mapped + entry.data_offset, entry.size);
+}
+
+/*
+ * Add or replace the payload of a chunk index
+ */
+void chunk_sidecar::insert(unsigned int index, uint32_t modified, uint64_t offset, std::vector<char> payload) {
+    if (index >= region_dim::CHUNK_COUNT)
+        throw std::out_of_range("index out-of-range");
+    pending[index] = pending_entry{ modified, offset, std::move(payload) };
+}
+
+/*
+ * Map the sidecar file, ignoring it if missing, of another version or written for another region
+ */
+void chunk_sidecar::load(void) {
+    unload();
+
+#ifdef CHUNK_SIDECAR_MMAP
+    struct stat info;
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+        return;
+    if (fstat(fd, &info) || info.st_size < static_cast<off_t>(sizeof(file_header))) {
+        close(fd);
+        return;
+    }
+    void* base = mmap(NULL, static_cast<size_t>(info.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED)
+        return;
+    mapped = static_cast<const char*>(base);
+    mapped_size = static_cast<size_t>(info.st_size);
+#else
+    std::ifstream file(path.c_str(), std::ios::in | std::ios::binary);
+    if (!file.is_open())
+        return;
+    buffer.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    if (buffer.size() < sizeof(file_header)) {
+        buffer.clear();
+        return;
+    }
+    mapped = buffer.data();
+    mapped_size = buffer.size();
+#endif
+
+    // check the header and that every entry lies within the file
+    const file_header* header = reinterpret_cast<const file_header*>(mapped);
+    size_t table = align(sizeof(file_header) + header->region_path_length);
+    bool valid = !std::memcmp(header->magic, SIDECAR_MAGIC, sizeof(SIDECAR_MAGIC))
+        && header->version == VERSION
+        && header->byte_order == BYTE_ORDER_MARK
+        && header->entry_count == region_dim::CHUNK_COUNT
+        && header->region_path_length == region_path.size()
+        && table + region_dim::CHUNK_COUNT * sizeof(file_entry) <= mapped_size
+        && !region_path.compare(0, std::string::npos, mapped + sizeof(file_header), region_path.size());
+    if (valid) {
+        const file_entry* table_entries = reinterpret_cast<const file_entry*>(mapped + table);
+        for (unsigned int i = 0; valid && i < region_dim::CHUNK_COUNT; ++i) {
+            valid = table_entries[i].data_offset <= mapped_size
+                && table_entries[i].size <= mapped_size - table_entries[i].data_offset;
+        }
+        entries = table_entries;
+    }
+    if (!valid)
+        unload();
+}
+
+/*
+ * Write the sidecar file, merging loaded and added entries. The file is written next to
+ * its path and renamed into place. Throws std::runtime_error on failure.
+ */
+void chunk_sidecar::save(void) {
+    static const char padding[ALIGNMENT] = {};
+    std::string temp_path = path + ".tmp";
+    std::vector<file_entry> table(region_dim::CHUNK_COUNT);
+    std::vector<array_view<const char>> payloads(region_dim::CHUNK_COUNT);
+    file_header header;
+
+    // lay out the payloads after the table, added entries replace loaded ones
+    size_t table_offset = align(sizeof(file_header) + region_path.size());
+    uint64_t data_offset = table_offset + region_dim::CHUNK_COUNT * sizeof(file_entry);
+    for (unsigned int i = 0; i < region_dim::CHUNK_COUNT; ++i) {
+        file_entry& entry = table[i];
+        auto iter = pending.find(i);
+        if (iter != pending.end()) {
+            entry.modified = iter->second.modified;
+            entry.offset = iter->second.offset;
+            payloads[i] = array_view<const char>(iter->second.payload);
+        } else if (entries && entries[i].size) {
+            entry.modified = entries[i].modified;
+            entry.offset = entries[i].offset;
+            payloads[i] = array_view<const char>(mapped + entries[i].data_offset, entries[i].size);
+        }
+        entry.size = payloads[i].size();
+        entry.data_offset = entry.size ? data_offset : 0;
+        data_offset += align(entry.size);
+    }
+
+    // write everything to a temporary file first, readers never see a partial sidecar
+    std::memcpy(header.magic, SIDECAR_MAGIC, sizeof(SIDECAR_MAGIC));
+    header.version = VERSION;
+    header.byte_order = BYTE_ORDER_MARK;
+    header.entry_count = region_dim::CHUNK_COUNT;
+    header.region_path_length = region_path.size();
+    std::ofstream file(temp_path.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+    if (!file.is_open())
+        throw std::runtime_error("Failed to open sidecar file");
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    file.write(region_path.data(), region_path.size());
+    file.write(padding, table_offset - sizeof(header) - region_path.size());
+    file.write(reinterpret_cast<const char*>(table.data()), table.size() * sizeof(file_entry));
+    for (const array_view<const char>& payload : payloads) {
+        file.write(payload.data(), payload.size());
+        file.write(padding, align(payload.size()) - payload.size());
+    }
+    file.close();
+    if (!file) {
+        std::remove(temp_path.c_str());
+        throw std::runtime_error("Failed to write sidecar file");
+    }
+
+    // rename over the old file (which has to be removed first on some platforms)
+    unload();
+    if (std::rename(temp_path.c_str(), path.c_str())) {
+        std::remove(path.c_str());
+        if (std::rename(temp_path.c_str(), path.c_str())) {
+            std::remove(temp_path.c_str());
+            throw std::runtime_error("Failed to replace sidecar file");
+        }
+    }
+    pending.clear();
+    load();
+}
+
+/*
+ * Release the mapped sidecar file
+ */
+void chunk_sidecar::unload(void) {
+#ifdef CHUNK_SIDECAR_MMAP
+    if (mapped)
+        munmap(const_cast<char*>(mapped), mapped_size);
+#endif
+    buffer.clear();
+    buffer.shrink_to_fit();
+    mapped = NULL;
+    mapped_size = 0;
+    entries = NULL;
+}
@@ -0,0 +1,56 @@
+/*
+ * chunk_status.cpp
+ * Copyright (C) 2012 - 2019 David Jolly
+ * ----------------------
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdexcept>
+#include "../include/chunk_status.h"
+
+/*
+ * Throw the exception matching a non-OK status for a chunk at a given x, z coord
+ * (std::out_of_range if empty, std::runtime_error otherwise)
+ */
+void chunk_status::check(STATUS status, unsigned int x, unsigned int z) {
+    switch (status) {
+        case OK:
+            return;
+        case EMPTY:
+            throw std::out_of_range("Chunk at " + std::to_string(x) + "|" + std::to_string(z) + " is empty");
+        case UNSUPPORTED_COMPRESSION:
+            throw std::runtime_error("Unsupported compression type");
+        default:
+            throw std::runtime_error("Chunk at " + std::to_string(x) + "|" + std::to_string(z) + " is corrupt");
+    }
+}
+
+/*
+ * Returns a string representation of a status
+ */
+std::string chunk_status::to_string(STATUS status) {
+    switch (status) {
+        case OK:
+            return "ok";
+        case EMPTY:
+            return "empty";
+        case CORRUPT:
+            return "corrupt";
+        case UNSUPPORTED_COMPRESSION:
+            return "unsupported compression";
+        default:
+            return "unknown";
+    }
+}
@@ -0,0 +1,176 @@
+/*
+ * chunk_surface.cpp
+ * Copyright (C) 2012 - 2019 David Jolly
+ * ----------------------
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+#include <vector>
+#include "../include/block_registry.h"
+#include "../include/chunk_section.h"
+#include "../include/chunk_surface.h"
+#include "../include/packed_array.h"
+#include "../include/region_dim.h"
+#include "../include/tag/string_tag.h"
+
+/*
+ * Mark every column as holding no block
+ */
+void chunk_surface::clear(void) {
+    std::fill(ids, ids + COLUMN_COUNT, block_registry::AIR);
+    std::fill(heights, heights + COLUMN_COUNT, NO_HEIGHT);
+}
+
+/*
+ * Extract the surface of a chunk's root compound. Returns false if the chunk has no sections.
+ */
+bool chunk_surface::extract(compound_tag& root) {
+    int min_y, top = INT_MIN;
+    int32_t hints[COLUMN_COUNT];
+    uint16_t values[COLUMN_COUNT];
+    chunk_format::GENERATION generation = chunk_format::get_generation(chunk_format::get_data_version(root));
+    list_tag* sections = chunk_format::get_sections(root, generation);
+
+    clear();
+    if (!sections)
+        return false;
+
+    // WORLD_SURFACE holds the top block y + 1, relative to the chunk's lowest y (0 if empty)
+    long_array_tag* heightmap = chunk_format::get_heightmap(root, generation, "WORLD_SURFACE");
+    bool padded = generation >= chunk_format::PADDED;
+    if (heightmap && chunk_format::get_min_y(root, generation, min_y)
+            && heightmap->size() == packed_array::long_count(chunk_format::HEIGHTMAP_BITS, padded, COLUMN_COUNT)) {
+        packed_array::unpack(heightmap->get_view(), chunk_format::HEIGHTMAP_BITS, padded, values, COLUMN_COUNT);
+        for (unsigned int i = 0; i < COLUMN_COUNT; ++i) {
+            hints[i] = values[i] ? min_y + values[i] - 1 : NO_HEIGHT;
+            top = std::max(top, hints[i]);
+        }
+
+        // sections above the highest hinted block are never decoded
+        if (top != NO_HEIGHT && scan(sections, generation, region_dim::floor_div(top, 16), hints))
+            return true;
+        clear(); // stale heightmap
+    }
+    scan(sections, generation, INT_MAX, NULL);
+    return true;
+}
+
+/*
+ * Extract the surface of a region's chunk at a given x, z coord. Returns false if the chunk is
+ * empty. Chunk tags read by the call are dropped afterwards.
+ */
+bool chunk_surface::extract(region_file_reader& reader, unsigned int x, unsigned int z) {
+    bool result = false;
+    int x_pos, z_pos;
+    list_tag* sections;
+    chunk_format::GENERATION generation;
+
+    clear();
+    if (!reader.is_filled(x, z))
+        return false;
+    chunk_tag& tag = reader.get_chunk_tag_at(x, z);
+    bool loaded = !tag.get_root_tag().empty();
+    try {
+        chunk_status::STATUS status = reader.try_get_chunk_sections(x, z, generation, x_pos, z_pos, sections);
+        if (status != chunk_status::EMPTY) {
+            chunk_status::check(status, x, z);
+            result = extract(tag.get_root_tag());
+        }
+    } catch (...) {
+        if (!loaded)
+            tag.clean_root();
+        throw;
+    }
+    if (!loaded)
+        tag.clean_root();
+    return result;
+}
+
+/*
+ * Resolve columns from the top down, starting at a given section y. Returns false if a
+ * column disagrees with its hinted height (hints may be NULL).
+ */
+bool chunk_surface::scan(list_tag* sections, chunk_format::GENERATION generation, int top_section, const int32_t* hints) {
+    list_tag* palette;
+    long_array_tag* states;
+    chunk_section section;
+    std::vector<std::pair<int, compound_tag*>> ordered;
+    std::vector<uint16_t> pending(COLUMN_COUNT);
+    std::vector<char> air;
+    block_registry& registry = block_registry::get_instance();
+
+    // order sections from the top down, skipping those above the start and those holding only air
+    for (generic_tag* entry : sections->get_view()) {
+        compound_tag* tag = static_cast<compound_tag*>(entry);
+        int y;
+        if (!chunk_format::get_section_y(tag, y) || y > top_section
+                || !chunk_section::get_block_states(tag, generation, palette, states))
+            continue;
+        for (generic_tag* palette_entry : palette->get_view()) {
+            generic_tag* name = static_cast<compound_tag*>(palette_entry)->get_subtag("Name");
+            if (!name || name->get_type() != generic_tag::STRING
+                    || !block_state::is_air_name(static_cast<string_tag*>(name)->get_view())) {
+                ordered.push_back(std::make_pair(y, tag));
+                break;
+            }
+        }
+    }
+    std::sort(ordered.begin(), ordered.end(),
+        [](const std::pair<int, compound_tag*>& a, const std::pair<int, compound_tag*>& b) { return a.first > b.first; });
+
+    for (unsigned int i = 0; i < COLUMN_COUNT; ++i) {
+        pending[i] = static_cast<uint16_t>(i);
+    }
+    for (const std::pair<int, compound_tag*>& entry : ordered) {
+        if (!chunk_section::decode(entry.second, generation, section))
+            continue;
+        const std::vector<uint32_t>& state_ids = section.get_palette();
+        air.resize(state_ids.size());
+        for (size_t i = 0; i < state_ids.size(); ++i) {
+            air[i] = registry.is_air(state_ids[i]);
+        }
+
+        // walk the section's layers down, keeping only unresolved columns
+        const uint16_t* indices = section.get_indices();
+        for (int y = 15; y >= 0; --y) {
+            const uint16_t* layer = indices + chunk_section::get_index(0, y, 0);
+            size_t remaining = 0;
+            for (uint16_t column : pending) {
+                uint16_t index = layer[column];
+                if (air[index]) {
+                    pending[remaining++] = column;
+                    continue;
+                }
+                ids[column] = state_ids[index];
+                heights[column] = section.get_y() * 16 + y;
+                if (hints && heights[column] != hints[column])
+                    return false;
+            }
+            pending.resize(remaining);
+            if (pending.empty())
+                return true;
+        }
+    }
+
+    // columns left unresolved must be empty according to the hints too
+    if (hints) {
+        for (uint16_t column : pending) {
+            if (hints[column] != NO_HEIGHT)
+                return false;
+        }
+    }
+    return true;
+}
@@ -17,6 +17,8 @@
  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <atomic>
+#include <cstdlib>
 #include <stdexcept>
 #include "../include/chunk_tag.h"
 #include "../include/tag/byte_tag.h"
@@ -28,6 +30,7 @@
 #include "../include/tag/int_array_tag.h"
 #include "../include/tag/list_tag.h"
 #include "../include/tag/long_tag.h"
+#include "../include/tag/long_array_tag.h"
 #include "../include/tag/short_tag.h"
 #include "../include/tag/string_tag.h"
 
@@ -40,8 +43,10 @@ chunk_tag& chunk_tag::operator=(const chunk_tag& other) {
     if (this == &other)
         return *this;
 
-    // assign attributes
+    // drop old subtrees and share the new ones
+    clean_root();
     root = other.root;
+    retain_root();
     return *this;
 }
 
@@ -62,12 +67,10 @@ bool chunk_tag::operator==(const chunk_tag& other) {
  * Copy chunk tag
  */
 void chunk_tag::copy(chunk_tag& other) {
-    std::vector<generic_tag*> value;
-
     // clear old tag and assign new tag
     clean_root();
     root.set_name(other.get_root_tag().get_name());
-    value = other.get_root_tag().get_value();
+    std::vector<generic_tag*>& value = other.get_root_tag().get_value();
     for (unsigned int i = 0; i < value.size(); ++i) {
         generic_tag* sub_tag = NULL;
         sub_tag = copy_tag(value.at(i));
@@ -135,6 +138,44 @@ generic_tag* chunk_tag::copy_tag(generic_tag* src) {
         case generic_tag::INT_ARRAY:
             tag = copy_tag_helper<int_array_tag>(src);
             break;
+        case generic_tag::LONG_ARRAY:
+            tag = copy_tag_helper<long_array_tag>(src);
+            break;
+    }
+    return tag;
+}
+
+/*
+ * Copy a single chunk tag level, compound/list sub-tags are shared with src
+ */
+generic_tag* chunk_tag::clone_tag(generic_tag* src) {
+    generic_tag* tag = NULL;
+
+    // copy tag based on type
+    switch (src->type) {
+        case generic_tag::COMPOUND: {
+            compound_tag* cmp = static_cast<compound_tag*>(src);
+            compound_tag* c_cmp = new compound_tag(cmp->get_name());
+            for (unsigned int i = 0; i < cmp->size(); ++i) {
+                cmp->at(i)->retain();
+                c_cmp->push_back(cmp->at(i));
+            }
+            tag = c_cmp;
+        }
+            break;
+        case generic_tag::LIST: {
+            list_tag* lst = static_cast<list_tag*>(src);
+            list_tag* c_lst = new list_tag(lst->get_name(), lst->get_element_type());
+            for (unsigned int i = 0; i < lst->size(); ++i) {
+                lst->at(i)->retain();
+                c_lst->push_back(lst->at(i));
+            }
+            tag = c_lst;
+        }
+            break;
+        default:
+            tag = copy_tag(src);
+            break;
     }
     return tag;
 }
@@ -148,6 +189,19 @@ void chunk_tag::clean_root(void) {
     for (unsigned int i = 0; i < root.size(); ++i) {
         clean_tag(root.at(i));
     }
+    root.get_value().clear();
+    revision = next_revision();
+}
+
+/*
+ * Add a reference to every root sub-tag (subtrees become shared)
+ */
+void chunk_tag::retain_root(void) {
+
+    // iterate through sub-tags
+    for (unsigned int i = 0; i < root.size(); ++i) {
+        root.at(i)->retain();
+    }
 }
 
 /*
@@ -155,6 +209,10 @@ void chunk_tag::clean_root(void) {
  */
 void chunk_tag::clean_tag(generic_tag* tag) {
 
+    // keep subtrees still shared with another chunk tag
+    if (!tag->release())
+        return;
+
     // clean tag based on type
     switch (tag->get_type()) {
         case generic_tag::COMPOUND: {
@@ -188,6 +246,71 @@ std::vector<generic_tag*> chunk_tag::get_sub_tag_by_name(const std::string& name
     return sub_tag;
 }
 
+/*
+ * Returns the sub-tag at a given path (compound names or list indices) that is safe
+ * to modify, copying any shared tag along the path first. Returns NULL if not found.
+ */
+generic_tag* chunk_tag::get_unique_sub_tag(const std::vector<std::string>& path) {
+    std::vector<generic_tag*>* parent = &root.get_value();
+    generic_tag* tag = &root;
+
+    // walk the path, replacing shared tags with private copies
+    for (unsigned int i = 0; i < path.size(); ++i) {
+        size_t index = parent->size();
+        if (tag->get_type() == generic_tag::LIST) {
+            index = std::strtoul(path.at(i).c_str(), NULL, 10);
+        } else {
+            for (size_t j = 0; j < parent->size(); ++j) {
+                if (parent->at(j)->get_name() == path.at(i)) {
+                    index = j;
+                    break;
+                }
+            }
+        }
+        if (index >= parent->size())
+            return NULL;
+
+        tag = parent->at(index);
+        if (tag->is_shared()) {
+            generic_tag* copy = clone_tag(tag);
+            clean_tag(tag);
+            parent->at(index) = copy;
+            tag = copy;
+            revision = next_revision();
+        }
+
+        // descend into the next level
+        if (tag->get_type() == generic_tag::COMPOUND)
+            parent = &static_cast<compound_tag*>(tag)->get_value();
+        else if (tag->get_type() == generic_tag::LIST)
+            parent = &static_cast<list_tag*>(tag)->get_value();
+        else if (i + 1 < path.size())
+            return NULL;
+    }
+    return tag;
+}
+
+/*
+ * Returns a new, never used revision
+ */
+unsigned long chunk_tag::next_revision(void) {
+    static std::atomic<unsigned long> revisions(0);
+
+    return ++revisions;
+}
+
+/*
+ * Sets a chunk tag's root tag (adopts root's subtrees, which the caller must no longer release)
+ */
+void chunk_tag::set_root_tag(compound_tag& root) {
+
+    // drop old subtrees and take over the new ones, their reference counts are left as is
+    if (&this->root == &root)
+        return;
+    clean_root();
+    this->root = root;
+}
+
 /*
  * Returns a chunk tag sub-tag at a given name helper
  */
@@ -0,0 +1,133 @@
+/*
+ * chunk_view.cpp
+ * Copyright (C) 2012 - 2019 David Jolly
+ * ----------------------
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+#include <climits>
+#include "../include/block_registry.h"
+#include "../include/chunk_view.h"
+
+/*
+ * Chunk view constructor
+ */
+chunk_view::chunk_view(compound_tag& root) : generation(chunk_format::get_generation(chunk_format::get_data_version(root))),
+        level(chunk_format::get_level(root, generation)), positioned(false), x_pos(0), z_pos(0),
+        sections(chunk_format::get_sections(root, generation)), min_section(0), biomes(NULL), height_map(NULL),
+        heightmaps(NULL) {
+    int max_section = INT_MIN;
+
+    positioned = chunk_format::get_position(root, generation, x_pos, z_pos);
+    if (level) {
+        generic_tag* tag = level->get_subtag("Biomes");
+        if (tag && (tag->get_type() == generic_tag::BYTE_ARRAY || tag->get_type() == generic_tag::INT_ARRAY))
+            biomes = tag;
+        tag = level->get_subtag("HeightMap");
+        if (tag && tag->get_type() == generic_tag::INT_ARRAY)
+            height_map = static_cast<int_array_tag*>(tag);
+        tag = level->get_subtag("Heightmaps");
+        if (tag && tag->get_type() == generic_tag::COMPOUND)
+            heightmaps = static_cast<compound_tag*>(tag);
+    }
+    if (!sections)
+        return;
+
+    // index sections by y
+    min_section = INT_MAX;
+    for (generic_tag* entry : sections->get_view()) {
+        int y;
+        if (!chunk_format::get_section_y(static_cast<compound_tag*>(entry), y))
+            continue;
+        min_section = std::min(min_section, y);
+        max_section = std::max(max_section, y);
+    }
+    if (max_section < min_section) {
+        min_section = 0;
+        return;
+    }
+    size_t count = static_cast<size_t>(max_section - min_section + 1);
+    section_tags.resize(count, NULL);
+    decoded.resize(count);
+    legacy.resize(count);
+    checked.resize(count, 0);
+    for (generic_tag* entry : sections->get_view()) {
+        compound_tag* section = static_cast<compound_tag*>(entry);
+        int y;
+        if (chunk_format::get_section_y(section, y))
+            section_tags[y - min_section] = section;
+    }
+}
+
+/*
+ * Returns the block state id (see block_registry) at a given x, z coord (relative to the chunk)
+ * and world y. Returns air where no section holds block data (and for legacy chunks).
+ */
+uint32_t chunk_view::get_block_id_at(unsigned int x, int y, unsigned int z) {
+    const chunk_section* section = get_section(y >> 4);
+
+    if (!section)
+        return block_registry::AIR;
+    return section->get_id_at(x, y & 15, z);
+}
+
+/*
+ * Returns a packed heightmap (e.g. WORLD_SURFACE) from Heightmaps, NULL if absent
+ */
+long_array_tag* chunk_view::get_heightmap(const std::string& name) const {
+    generic_tag* heightmap;
+
+    if (!heightmaps || generation == chunk_format::LEGACY)
+        return NULL;
+    heightmap = heightmaps->get_subtag(name);
+    if (!heightmap || heightmap->get_type() != generic_tag::LONG_ARRAY)
+        return NULL;
+    return static_cast<long_array_tag*>(heightmap);
+}
+
+/*
+ * Returns the decoded legacy section at a given section y, NULL if absent
+ */
+const legacy_section* chunk_view::get_legacy_section(int y) {
+    int slot = get_slot(y);
+
+    if (slot < 0 || generation != chunk_format::LEGACY)
+        return NULL;
+    if (!(checked[slot] & 2)) {
+        checked[slot] |= 2;
+        std::unique_ptr<legacy_section> section(new legacy_section);
+        if (section_tags[slot] && legacy_section::decode(section_tags[slot], *section))
+            legacy[slot] = std::move(section);
+    }
+    return legacy[slot].get();
+}
+
+/*
+ * Returns the decoded section at a given section y, NULL if absent or without block data
+ */
+const chunk_section* chunk_view::get_section(int y) {
+    int slot = get_slot(y);
+
+    if (slot < 0 || generation == chunk_format::LEGACY)
+        return NULL;
+    if (!(checked[slot] & 1)) {
+        checked[slot] |= 1;
+        std::unique_ptr<chunk_section> section(new chunk_section);
+        if (section_tags[slot] && chunk_section::decode(section_tags[slot], generation, *section))
+            decoded[slot] = std::move(section);
+    }
+    return decoded[slot].get();
+}
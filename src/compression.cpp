@@ -27,7 +27,6 @@
 bool compression::deflate_(std::vector<char>& data) {
     int ret;
     z_stream zs;
-    char buff[SEG_SIZE];
     std::vector<char> out_data;
 
     // initialize zlib structure
@@ -36,16 +35,18 @@ bool compression::deflate_(std::vector<char>& data) {
         return false;
     zs.next_in = (Bytef*) data.data();
     zs.avail_in = static_cast<uInt>(data.size());
+    out_data.resize(deflateBound(&zs, zs.avail_in));
 
-    // deflate blocks
+    // deflate blocks, growing the output if the bound was not enough
     do {
-        zs.next_out = reinterpret_cast<Bytef*>(buff);
-        zs.avail_out = SEG_SIZE;
+        if (zs.total_out == out_data.size())
+            out_data.resize(out_data.size() + SEG_SIZE);
+        zs.next_out = reinterpret_cast<Bytef*>(out_data.data() + zs.total_out);
+        zs.avail_out = static_cast<uInt>(out_data.size() - zs.total_out);
 
-        // deflate data and place in out_data
+        // deflate data directly into out_data
         ret = deflate(&zs, Z_FINISH);
-        out_data.insert(out_data.end(), buff, buff + zs.total_out);
-    } while (ret == Z_OK);
+    } while (ret == Z_OK || ret == Z_BUF_ERROR);
 
     // check for errors
     deflateEnd(&zs);
@@ -53,7 +54,8 @@ bool compression::deflate_(std::vector<char>& data) {
         return false;
 
     // assign to data
-    data = out_data;
+    out_data.resize(zs.total_out);
+    data.swap(out_data);
     return true;
 }
 
@@ -63,31 +65,25 @@ bool compression::deflate_(std::vector<char>& data) {
 bool compression::inflate_(std::vector<char>& data) {
     int ret;
     z_stream zs;
-    std::vector<unsigned char> in_data, out_data;
-    unsigned long prev_out = 0;
+    std::vector<char> out_data;
 
     // initialize zlib structure
     memset(&zs, 0, sizeof(zs));
     if (inflateInit(&zs) != Z_OK)
         return false;
+    zs.next_in = (Bytef*) data.data();
+    zs.avail_in = static_cast<uInt>(data.size());
 
-    in_data.insert(in_data.begin(), data.begin(), data.end());
-
-	zs.next_in = (Bytef *) in_data.data();
-	zs.avail_in = in_data.size();
+    // chunk data typically inflates to several times its compressed size
+    out_data.resize(data.size() * 4 + SEG_SIZE);
 
-    // inflate blocks
+    // inflate blocks directly into out_data
     do {
-        std::vector<unsigned char> buff;
-
-		buff.resize(SEG_SIZE, 0);
-		zs.next_out = (Bytef *) buff.data();
-        zs.avail_out = SEG_SIZE;
-
-        // inflate data and place in out_data
-        ret = inflate(&zs, 0);
-        out_data.insert(out_data.end(), buff.begin(), buff.begin() + (zs.total_out - prev_out));
-        prev_out = zs.total_out;
+        if (zs.total_out == out_data.size())
+            out_data.resize(out_data.size() * 2);
+        zs.next_out = reinterpret_cast<Bytef*>(out_data.data() + zs.total_out);
+        zs.avail_out = static_cast<uInt>(out_data.size() - zs.total_out);
+        ret = inflate(&zs, Z_NO_FLUSH);
     } while (ret == Z_OK);
 
     // check for errors
@@ -96,7 +92,7 @@ bool compression::inflate_(std::vector<char>& data) {
         return false;
 
     // assign to data
-    data.clear();
-	data.insert(data.begin(), out_data.begin(), out_data.end());
+    out_data.resize(zs.total_out);
+    data.swap(out_data);
     return true;
 }
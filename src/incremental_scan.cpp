@@ -0,0 +1,173 @@
+/*
+ * incremental_scan.cpp
+ * Copyright (C) 2012 - 2019 David Jolly
+ * ----------------------
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <set>
+#include <sstream>
+#include <stdexcept>
+#include "../include/incremental_scan.h"
+
+/*
+ * Manifest file magic, followed by the format version
+ */
+static const std::string MANIFEST_MAGIC = "libanvil-manifest";
+
+/*
+ * Read a manifest written by save, replacing the current one. A missing file
+ * leaves the manifest empty. Throws std::runtime_error if the file is malformed.
+ */
+void incremental_scan::load(const std::string& path) {
+    std::string line, magic;
+    unsigned int version = 0;
+    region_manifest* region = NULL;
+
+    manifest.clear();
+    std::ifstream file(path.c_str(), std::ios::in);
+    if (!file.is_open())
+        return;
+
+    // header line, then a "region <path>" line followed by "<index> <modified> <offset>" lines per region
+    std::getline(file, line);
+    std::istringstream header(line);
+    if (!(header >> magic >> version) || magic != MANIFEST_MAGIC || version != VERSION)
+        throw std::runtime_error("Unsupported manifest file");
+    while (std::getline(file, line)) {
+        if (!line.compare(0, 7, "region ")) {
+            region = &manifest[line.substr(7)];
+            continue;
+        }
+        unsigned int index;
+        chunk_state state;
+        std::istringstream entry(line);
+        if (!region || !(entry >> index >> state.modified >> state.offset) || index >= region_dim::CHUNK_COUNT)
+            throw std::runtime_error("Malformed manifest file");
+        region->at(index) = state;
+    }
+}
+
+/*
+ * Report every chunk of a region as removed and forget it
+ */
+void incremental_scan::remove_region(std::map<std::string, region_manifest>::iterator region) {
+    std::vector<unsigned int> indices;
+
+    region->second.for_each([&](unsigned int index, const chunk_state&) { indices.push_back(index); });
+    for (unsigned int index : indices) {
+        if (removed)
+            removed(region->first, index % region_dim::CHUNK_WIDTH, index / region_dim::CHUNK_WIDTH);
+        region->second.erase(index);
+    }
+    manifest.erase(region);
+}
+
+/*
+ * Write the manifest to a file, through a temporary file renamed into place.
+ * Throws std::runtime_error on failure.
+ */
+void incremental_scan::save(const std::string& path) const {
+    std::string temp_path = path + ".tmp";
+
+    std::ofstream file(temp_path.c_str(), std::ios::out | std::ios::trunc);
+    if (!file.is_open())
+        throw std::runtime_error("Failed to open manifest file");
+    file << MANIFEST_MAGIC << " " << VERSION << "\n";
+    for (const auto& region : manifest) {
+        file << "region " << region.first << "\n";
+        region.second.for_each([&](unsigned int index, const chunk_state& state) {
+            file << index << " " << state.modified << " " << state.offset << "\n";
+        });
+    }
+    file.close();
+    if (!file) {
+        std::remove(temp_path.c_str());
+        throw std::runtime_error("Failed to write manifest file");
+    }
+
+    // rename over the old file (which has to be removed first on some platforms)
+    if (std::rename(temp_path.c_str(), path.c_str())) {
+        std::remove(path.c_str());
+        if (std::rename(temp_path.c_str(), path.c_str())) {
+            std::remove(temp_path.c_str());
+            throw std::runtime_error("Failed to replace manifest file");
+        }
+    }
+}
+
+/*
+ * Scan the given region files, calling back for added, changed and removed chunks. The manifest
+ * is updated as chunks are handled, so a scan interrupted by an exception resumes where it left
+ * off. Recorded regions not listed are only reported removed if their file no longer exists.
+ */
+void incremental_scan::scan(const std::vector<std::string>& paths) {
+    std::set<std::string> listed;
+
+    for (const std::string& path : paths) {
+        listed.insert(path);
+        scan_region(path, manifest[path]);
+    }
+
+    // a region missing from the listing may only be out of scope, check the file itself
+    for (auto region = manifest.begin(); region != manifest.end();) {
+        auto next = std::next(region);
+        if (!listed.count(region->first) && !std::ifstream(region->first.c_str()).is_open())
+            remove_region(region);
+        region = next;
+    }
+}
+
+/*
+ * Scan a single region file against its manifest entry
+ */
+void incremental_scan::scan_region(const std::string& path, region_manifest& previous) {
+    std::vector<unsigned int> gone;
+    region_file_reader reader(path);
+
+    // only the header is read, chunks are parsed when a callback asks for them
+    reader.read(true);
+    region_header& header = reader.get_region().get_header();
+    for (unsigned int index = 0; index < region_dim::CHUNK_COUNT; ++index) {
+        unsigned int x = index % region_dim::CHUNK_WIDTH, z = index / region_dim::CHUNK_WIDTH;
+        chunk_info* info = header.find_info_at(index);
+        chunk_state* state = previous.find(index);
+
+        if (!info || info->empty()) {
+            if (state)
+                gone.push_back(index);
+            continue;
+        }
+        if (state && state->modified == info->get_modified() && state->offset == info->get_offset())
+            continue;
+
+        // record the chunk only once its callback returned
+        const chunk_work& work = state ? changed : added;
+        if (work) {
+            work(reader, x, z);
+            reader.get_chunk_tag_at(x, z).clean_root();
+        }
+        previous.at(index) = chunk_state{ info->get_modified(), info->get_offset() };
+    }
+
+    for (unsigned int index : gone) {
+        if (removed)
+            removed(path, index % region_dim::CHUNK_WIDTH, index / region_dim::CHUNK_WIDTH);
+        previous.erase(index);
+    }
+}
@@ -0,0 +1,98 @@
+/*
+ * legacy_section.cpp
+ * Copyright (C) 2012 - 2019 David Jolly
+ * ----------------------
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdexcept>
+#include "../include/chunk_format.h"
+#include "../include/legacy_section.h"
+#include "../include/nibble_array.h"
+#include "../include/tag/byte_array_tag.h"
+
+#if defined(__SSE2__)
+#define LEGACY_SECTION_SSE2
+#include <emmintrin.h>
+#endif
+
+/*
+ * Returns a section's nibble array of a given name, or NULL if absent
+ */
+static const uint8_t* get_nibbles(compound_tag* section, const std::string& name) {
+    generic_tag* tag = section->get_subtag(name);
+
+    if (!tag || tag->get_type() != generic_tag::BYTE_ARRAY)
+        return NULL;
+    array_view<const char> data = static_cast<byte_array_tag*>(tag)->get_view();
+    if (data.size() != nibble_array::SECTION_SIZE)
+        throw std::runtime_error("Unexpected " + name + " length");
+    return reinterpret_cast<const uint8_t*>(data.data());
+}
+
+/*
+ * Decode a section compound's Blocks, Add and Data arrays in a single pass.
+ * Returns false if the section holds no Blocks.
+ */
+bool legacy_section::decode(compound_tag* section, legacy_section& sect) {
+    static const uint8_t NO_NIBBLES[nibble_array::SECTION_SIZE] = {};
+    unsigned int index = 0;
+
+    generic_tag* blocks_tag = section->get_subtag("Blocks");
+    int y;
+    if (!chunk_format::get_section_y(section, y) || !blocks_tag || blocks_tag->get_type() != generic_tag::BYTE_ARRAY)
+        return false;
+    array_view<const char> blocks_view = static_cast<byte_array_tag*>(blocks_tag)->get_view();
+    if (blocks_view.size() != BLOCK_COUNT)
+        throw std::runtime_error("Unexpected Blocks length");
+    sect.y = y;
+
+    // absent Add and Data arrays read as zero
+    const uint8_t* blocks = reinterpret_cast<const uint8_t*>(blocks_view.data()),
+        * add = get_nibbles(section, "Add"), * data = get_nibbles(section, "Data");
+    if (!add)
+        add = NO_NIBBLES;
+    if (!data)
+        data = NO_NIBBLES;
+
+#ifdef LEGACY_SECTION_SSE2
+    // 16 blocks per step, nibbles are split and interleaved back into block order
+    const __m128i mask = _mm_set1_epi8(15), zero = _mm_setzero_si128();
+    for (; index < BLOCK_COUNT; index += 16) {
+        __m128i add_packed = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(add + index / 2)),
+            data_packed = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(data + index / 2));
+        __m128i add_nibbles = _mm_unpacklo_epi8(_mm_and_si128(add_packed, mask),
+                _mm_and_si128(_mm_srli_epi16(add_packed, 4), mask)),
+            data_nibbles = _mm_unpacklo_epi8(_mm_and_si128(data_packed, mask),
+                _mm_and_si128(_mm_srli_epi16(data_packed, 4), mask)),
+            block_bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(blocks + index));
+
+        // (add << 12) | (block << 4) | data, in two halves of 8 values
+        __m128i low = _mm_or_si128(_mm_or_si128(_mm_slli_epi16(_mm_unpacklo_epi8(add_nibbles, zero), 12),
+                _mm_slli_epi16(_mm_unpacklo_epi8(block_bytes, zero), 4)), _mm_unpacklo_epi8(data_nibbles, zero)),
+            high = _mm_or_si128(_mm_or_si128(_mm_slli_epi16(_mm_unpackhi_epi8(add_nibbles, zero), 12),
+                _mm_slli_epi16(_mm_unpackhi_epi8(block_bytes, zero), 4)), _mm_unpackhi_epi8(data_nibbles, zero));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(sect.values + index), low);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(sect.values + index + 8), high);
+    }
+#endif // LEGACY_SECTION_SSE2
+
+    for (; index < BLOCK_COUNT; ++index) {
+        unsigned int shift = (index & 1) * 4;
+        sect.values[index] = static_cast<uint16_t>((((add[index / 2] >> shift) & 15) << 12) | (blocks[index] << 4)
+            | ((data[index / 2] >> shift) & 15));
+    }
+    return true;
+}
@@ -0,0 +1,53 @@
+/*
+ * nibble_array.cpp
+ * Copyright (C) 2012 - 2019 David Jolly
+ * ----------------------
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdexcept>
+#include "../include/nibble_array.h"
+
+#if defined(__SSE2__)
+#define NIBBLE_ARRAY_SSE2
+#include <emmintrin.h>
+#endif
+
+/*
+ * Unpack count values (even) from data, holding at least count / 2 bytes
+ */
+void nibble_array::unpack(array_view<const char> data, uint8_t* out, unsigned int count) {
+    unsigned int index = 0, bytes = count / 2;
+
+    if ((count & 1) || data.size() < bytes)
+        throw std::out_of_range("Unexpected nibble array length");
+    const uint8_t* in = reinterpret_cast<const uint8_t*>(data.data());
+
+#ifdef NIBBLE_ARRAY_SSE2
+    // split 16 bytes into low and high nibbles, interleaving them back into 32 values
+    const __m128i mask = _mm_set1_epi8(15);
+    for (; index + 16 <= bytes; index += 16) {
+        __m128i packed = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + index));
+        __m128i low = _mm_and_si128(packed, mask), high = _mm_and_si128(_mm_srli_epi16(packed, 4), mask);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + index * 2), _mm_unpacklo_epi8(low, high));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + index * 2 + 16), _mm_unpackhi_epi8(low, high));
+    }
+#endif // NIBBLE_ARRAY_SSE2
+
+    for (; index < bytes; ++index) {
+        out[index * 2] = in[index] & 15;
+        out[index * 2 + 1] = in[index] >> 4;
+    }
+}
@@ -0,0 +1,384 @@
+/*
+ * packed_array.cpp
+ * Copyright (C) 2012 - 2019 David Jolly
+ * ----------------------
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+#include <stdexcept>
+#include <utility>
+#include "../include/packed_array.h"
+
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#define PACKED_ARRAY_AVX2
+#include <immintrin.h>
+#endif
+
+/*
+ * Unpacker signature, data holds at least long_count() longs
+ */
+typedef void (*unpack_fn)(const uint64_t* data, uint16_t* out, unsigned int count);
+
+/*
+ * Extract a single bits-wide index
+ */
+template<unsigned int BITS, bool PADDED>
+static inline uint16_t extract(const uint64_t* data, unsigned int index) {
+    const uint64_t mask = (1ull << BITS) - 1;
+
+    if (PADDED) {
+        const unsigned int per_long = 64 / BITS;
+        return static_cast<uint16_t>((data[index / per_long] >> ((index % per_long) * BITS)) & mask);
+    }
+    unsigned int bit = index * BITS, word = bit >> 6, offset = bit & 63;
+    uint64_t value = data[word] >> offset;
+
+    // widths dividing 64 never span two longs
+    if ((64 % BITS) && (offset + BITS > 64))
+        value |= data[word + 1] << (64 - offset);
+    return static_cast<uint16_t>(value & mask);
+}
+
+/*
+ * Scalar unpacker for indices [begin, count)
+ */
+template<unsigned int BITS, bool PADDED>
+static void unpack_scalar_range(const uint64_t* data, uint16_t* out, unsigned int begin, unsigned int count) {
+    const uint64_t mask = (1ull << BITS) - 1;
+    const unsigned int per_long = 64 / BITS;
+
+    if (!PADDED || (begin % per_long)) {
+        for (unsigned int i = begin; i < count; ++i) {
+            out[i] = extract<BITS, PADDED>(data, i);
+        }
+        return;
+    }
+
+    // padded longs hold a fixed number of indices, shift them out one long at a time
+    for (unsigned int i = begin, word = begin / per_long; i < count; ++word) {
+        uint64_t value = data[word];
+        for (unsigned int j = 0; j < per_long && i < count; ++j, ++i) {
+            out[i] = static_cast<uint16_t>(value & mask);
+            value >>= BITS;
+        }
+    }
+}
+
+/*
+ * Scalar unpacker
+ */
+template<unsigned int BITS, bool PADDED>
+static void unpack_scalar(const uint64_t* data, uint16_t* out, unsigned int count) {
+    unpack_scalar_range<BITS, PADDED>(data, out, 0, count);
+}
+
+#ifdef PACKED_ARRAY_AVX2
+
+/*
+ * Byte shuffle and shift moving the indices found at bit offsets first,
+ * first + BITS, ... first + 7 * BITS of a 16 byte block into eight 32-bit lanes
+ */
+template<unsigned int BITS>
+__attribute__((target("avx2")))
+static void make_lanes(unsigned int first, __m256i& shuffle, __m256i& shift) {
+    alignas(32) char bytes[32];
+    alignas(32) int counts[8];
+
+    for (unsigned int lane = 0; lane < 8; ++lane) {
+        unsigned int bit = first + lane * BITS;
+        for (unsigned int byte = 0; byte < 4; ++byte) {
+            unsigned int src = (bit >> 3) + byte;
+            bytes[lane * 4 + byte] = static_cast<char>(src < 16 ? src : 0x80);
+        }
+        counts[lane] = static_cast<int>(bit & 7);
+    }
+    shuffle = _mm256_load_si256(reinterpret_cast<const __m256i*>(bytes));
+    shift = _mm256_load_si256(reinterpret_cast<const __m256i*>(counts));
+}
+
+/*
+ * Extract eight indices from a 16 byte block loaded in both 128-bit halves
+ */
+__attribute__((target("avx2")))
+static inline __m256i extract_lanes(__m256i block, __m256i shuffle, __m256i shift, __m256i mask) {
+
+    // pshufb works per 128-bit half, so lanes 4 - 7 use the same block bytes as 0 - 3
+    return _mm256_and_si256(_mm256_srlv_epi32(_mm256_shuffle_epi8(block, shuffle), shift), mask);
+}
+
+/*
+ * AVX2 unpacker with a scalar tail. Spanning arrays are a little endian bit
+ * stream where every eight indices take exactly BITS bytes, padded arrays
+ * are unpacked one long (per_long indices) at a time.
+ */
+template<unsigned int BITS, bool PADDED>
+__attribute__((target("avx2")))
+static void unpack_avx2(const uint64_t* data, uint16_t* out, unsigned int count) {
+    const unsigned char* bytes = reinterpret_cast<const unsigned char*>(data);
+    const __m256i mask = _mm256_set1_epi32((1 << BITS) - 1);
+    __m256i shuffle_low, shift_low, shuffle_high, shift_high;
+    unsigned int i = 0;
+
+    // narrower widths have more than 16 indices per long, leave them to the scalar path
+    if (BITS < 4) {
+        unpack_scalar<BITS, PADDED>(data, out, count);
+        return;
+    }
+
+    // lanes for indices 0 - 7 and 8 - 15 of a block
+    make_lanes<BITS>(0, shuffle_low, shift_low);
+    make_lanes<BITS>(8 * BITS, shuffle_high, shift_high);
+
+    if (PADDED) {
+        const unsigned int per_long = 64 / BITS;
+
+        // every store writes 16 values, only per_long of which are kept
+        for (unsigned int word = 0; i + 16 <= count; ++word, i += per_long) {
+            __m256i block = _mm256_broadcastsi128_si256(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(data + word)));
+            __m256i low = extract_lanes(block, shuffle_low, shift_low, mask);
+            __m256i high = per_long > 8 ? extract_lanes(block, shuffle_high, shift_high, mask) : low;
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i),
+                _mm256_permute4x64_epi64(_mm256_packus_epi32(low, high), 0xD8));
+        }
+    } else {
+        unsigned int length = static_cast<unsigned int>((static_cast<uint64_t>(count) * BITS + 63) / 64) * 8;
+
+        // sixteen indices take 2 * BITS bytes, the 16 byte loads must stay in the array
+        for (unsigned int offset = 0; i + 16 <= count && offset + BITS + 16 <= length; i += 16, offset += 2 * BITS) {
+            __m256i first = _mm256_broadcastsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i*>(bytes + offset)));
+            __m256i second = _mm256_broadcastsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i*>(bytes + offset + BITS)));
+            __m256i low = extract_lanes(first, shuffle_low, shift_low, mask);
+            __m256i high = extract_lanes(second, shuffle_low, shift_low, mask);
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i),
+                _mm256_permute4x64_epi64(_mm256_packus_epi32(low, high), 0xD8));
+        }
+    }
+    unpack_scalar_range<BITS, PADDED>(data, out, i, count);
+}
+
+/*
+ * AVX2 index search, sixteen indices per compare with a scalar tail
+ */
+__attribute__((target("avx2")))
+static unsigned int find_avx2(const uint16_t* values, unsigned int count, const uint16_t* targets, unsigned int target_count,
+        uint32_t* positions) {
+    __m256i target_vec[packed_array::MAX_FIND_TARGETS];
+    unsigned int i = 0, found = 0;
+
+    for (unsigned int t = 0; t < target_count; ++t) {
+        target_vec[t] = _mm256_set1_epi16(static_cast<short>(targets[t]));
+    }
+    for (; i + 16 <= count; i += 16) {
+        __m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(values + i));
+        __m256i equal = _mm256_cmpeq_epi16(block, target_vec[0]);
+        for (unsigned int t = 1; t < target_count; ++t) {
+            equal = _mm256_or_si256(equal, _mm256_cmpeq_epi16(block, target_vec[t]));
+        }
+
+        // two mask bits per matching index
+        uint32_t mask = static_cast<uint32_t>(_mm256_movemask_epi8(equal));
+        while (mask) {
+            positions[found++] = i + (__builtin_ctz(mask) >> 1);
+            mask &= mask - 1;
+            mask &= mask - 1;
+        }
+    }
+    for (; i < count; ++i) {
+        for (unsigned int t = 0; t < target_count; ++t) {
+            if (values[i] == targets[t]) {
+                positions[found++] = i;
+                break;
+            }
+        }
+    }
+    return found;
+}
+
+/*
+ * AVX2 tally for small value ranges, one compare per value and block
+ */
+__attribute__((target("avx2")))
+static void count_avx2(const uint16_t* values, unsigned int count, uint32_t* tally, unsigned int tally_size) {
+    unsigned int i = 0;
+
+    // 16-bit lane counters can take 65535 blocks before they are flushed
+    while (i + 16 <= count) {
+        unsigned int end = i + std::min<unsigned int>((count - i) & ~15u, 16u * 65535u);
+        for (unsigned int value = 0; value < tally_size; ++value) {
+            __m256i target = _mm256_set1_epi16(static_cast<short>(value)), total = _mm256_setzero_si256();
+            for (unsigned int j = i; j < end; j += 16) {
+                __m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(values + j));
+                total = _mm256_sub_epi16(total, _mm256_cmpeq_epi16(block, target));
+            }
+
+            // widen the unsigned lane counters (madd would sign them) and sum them
+            __m256i zero = _mm256_setzero_si256();
+            __m256i wide = _mm256_add_epi32(_mm256_unpacklo_epi16(total, zero), _mm256_unpackhi_epi16(total, zero));
+            __m128i sum = _mm_add_epi32(_mm256_castsi256_si128(wide), _mm256_extracti128_si256(wide, 1));
+            sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, 0x4E));
+            sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, 0xB1));
+            tally[value] += static_cast<uint32_t>(_mm_cvtsi128_si32(sum));
+        }
+        i = end;
+    }
+    for (; i < count; ++i) {
+        ++tally[values[i]];
+    }
+}
+
+#endif // PACKED_ARRAY_AVX2
+
+/*
+ * Build an unpacker table indexed by width - 1
+ */
+template<bool PADDED, bool AVX2, size_t... INDEX>
+static const unpack_fn* make_table(std::index_sequence<INDEX...>) {
+#ifdef PACKED_ARRAY_AVX2
+    static const unpack_fn table[] = { (AVX2 ? unpack_avx2<INDEX + 1, PADDED> : unpack_scalar<INDEX + 1, PADDED>)... };
+#else
+    static const unpack_fn table[] = { unpack_scalar<INDEX + 1, PADDED>... };
+#endif // PACKED_ARRAY_AVX2
+    return table;
+}
+
+/*
+ * Returns the unpacker for a given width and layout
+ */
+static unpack_fn select_unpacker(unsigned int bits, bool padded) {
+    typedef std::make_index_sequence<packed_array::MAX_BITS> widths;
+    static const bool avx2 = packed_array::has_avx2();
+    static const unpack_fn* tables[] = {
+        make_table<false, false>(widths()), make_table<true, false>(widths()),
+        make_table<false, true>(widths()), make_table<true, true>(widths()),
+    };
+    return tables[(avx2 ? 2 : 0) + (padded ? 1 : 0)][bits - 1];
+}
+
+/*
+ * Add the number of occurrences of every value to tally, values must be below tally_size
+ */
+void packed_array::count(const uint16_t* values, unsigned int count, uint32_t* tally, unsigned int tally_size) {
+    uint32_t partial[4][256];
+
+#ifdef PACKED_ARRAY_AVX2
+    if (tally_size <= MAX_COUNT_VALUES && has_avx2()) {
+        count_avx2(values, count, tally, tally_size);
+        return;
+    }
+#endif // PACKED_ARRAY_AVX2
+
+    // wide ranges go straight to the tally
+    if (tally_size > 256) {
+        for (unsigned int i = 0; i < count; ++i) {
+            ++tally[values[i]];
+        }
+        return;
+    }
+
+    // four interleaved tallies avoid stalls on runs of equal values
+    std::fill(&partial[0][0], &partial[0][0] + 4 * 256, 0);
+    unsigned int i = 0;
+    for (; i + 4 <= count; i += 4) {
+        ++partial[0][values[i]];
+        ++partial[1][values[i + 1]];
+        ++partial[2][values[i + 2]];
+        ++partial[3][values[i + 3]];
+    }
+    for (; i < count; ++i) {
+        ++partial[0][values[i]];
+    }
+    for (unsigned int value = 0; value < tally_size; ++value) {
+        tally[value] += partial[0][value] + partial[1][value] + partial[2][value] + partial[3][value];
+    }
+}
+
+/*
+ * Find the positions of values matching any of the targets, returns the number found
+ */
+unsigned int packed_array::find(const uint16_t* values, unsigned int count, array_view<const uint16_t> targets, uint32_t* positions) {
+    unsigned int found = 0;
+
+    if (targets.empty())
+        return 0;
+#ifdef PACKED_ARRAY_AVX2
+    if (targets.size() <= MAX_FIND_TARGETS && has_avx2())
+        return find_avx2(values, count, targets.data(), static_cast<unsigned int>(targets.size()), positions);
+#endif // PACKED_ARRAY_AVX2
+    for (unsigned int i = 0; i < count; ++i) {
+        if (std::find(targets.begin(), targets.end(), values[i]) != targets.end())
+            positions[found++] = i;
+    }
+    return found;
+}
+
+/*
+ * Returns the index at a given position
+ */
+unsigned int packed_array::get(array_view<const int64_t> data, unsigned int bits, bool padded, unsigned int index) {
+    uint64_t mask = (1ull << bits) - 1, value;
+
+    // check width
+    if (!bits || bits > MAX_BITS)
+        throw std::runtime_error("Unsupported index width");
+
+    if (padded) {
+        unsigned int per_long = 64 / bits;
+        return static_cast<unsigned int>((static_cast<uint64_t>(data.at(index / per_long)) >> ((index % per_long) * bits)) & mask);
+    }
+    uint64_t bit = static_cast<uint64_t>(index) * bits;
+    unsigned int word = static_cast<unsigned int>(bit >> 6), offset = bit & 63;
+    value = static_cast<uint64_t>(data.at(word)) >> offset;
+    if (offset + bits > 64)
+        value |= static_cast<uint64_t>(data.at(word + 1)) << (64 - offset);
+    return static_cast<unsigned int>(value & mask);
+}
+
+/*
+ * Returns true if the AVX2 kernels are in use
+ */
+bool packed_array::has_avx2(void) {
+#ifdef PACKED_ARRAY_AVX2
+    static const bool supported = __builtin_cpu_supports("avx2");
+    return supported;
+#else
+    return false;
+#endif // PACKED_ARRAY_AVX2
+}
+
+/*
+ * Returns the number of longs needed to hold count bits-wide indices
+ */
+unsigned int packed_array::long_count(unsigned int bits, bool padded, unsigned int count) {
+    if (!bits || bits > MAX_BITS)
+        throw std::runtime_error("Unsupported index width");
+    if (padded) {
+        unsigned int per_long = 64 / bits;
+        return (count + per_long - 1) / per_long;
+    }
+    return static_cast<unsigned int>((static_cast<uint64_t>(count) * bits + 63) / 64);
+}
+
+/*
+ * Unpack count bits-wide indices from a packed long array
+ */
+void packed_array::unpack(array_view<const int64_t> data, unsigned int bits, bool padded, uint16_t* out, unsigned int count) {
+
+    // check that the array holds every index
+    if (data.size() < long_count(bits, padded, count))
+        throw std::out_of_range("Packed array too short");
+    if (count)
+        select_unpacker(bits, padded)(reinterpret_cast<const uint64_t*>(data.data()), out, count);
+}
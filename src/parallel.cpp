@@ -0,0 +1,131 @@
+/*
+ * parallel.cpp
+ * Copyright (C) 2012 - 2019 David Jolly
+ * ----------------------
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <atomic>
+#include <cstdint>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include "../include/parallel.h"
+#include "../include/region_dim.h"
+
+/*
+ * Run work on every filled chunk of the given region files. Each chunk row of a region
+ * is one item (item = path index * ITEMS_PER_REGION + chunk z), so callers can keep
+ * per-item results in a deterministic order. Every thread reads through its own lazy
+ * reader and chunk tags are dropped once their work is done.
+ */
+void parallel::for_each_chunk(const std::vector<std::string>& paths, unsigned int thread_count, const chunk_work& work) {
+    thread_count = get_thread_count(thread_count);
+    std::vector<std::unique_ptr<region_file_reader>> readers(thread_count);
+    std::vector<size_t> reader_paths(thread_count, SIZE_MAX);
+
+    for_each_item(paths.size() * ITEMS_PER_REGION, thread_count, [&](size_t item, unsigned int thread) {
+        size_t path = item / ITEMS_PER_REGION;
+        unsigned int z = static_cast<unsigned int>(item % ITEMS_PER_REGION);
+
+        // items are handed out in order, so a thread mostly stays on one region
+        if (reader_paths[thread] != path) {
+            readers[thread].reset(new region_file_reader(paths[path]));
+            readers[thread]->read(true);
+            reader_paths[thread] = path;
+        }
+        region_file_reader& reader = *readers[thread];
+        for (unsigned int x = 0; x < region_dim::CHUNK_WIDTH; ++x) {
+            if (!reader.is_filled(x, z))
+                continue;
+            work(reader, x, z, item, thread);
+            reader.get_chunk_tag_at(x, z).clean_root();
+        }
+    });
+}
+
+/*
+ * Run work on the given chunks, each one being an item (item = index into chunks). Chunks
+ * are expected to be grouped by path. Empty chunks are skipped.
+ */
+void parallel::for_each_chunk(const std::vector<std::string>& paths, const std::vector<chunk_item>& chunks,
+        unsigned int thread_count, const chunk_work& work) {
+    thread_count = get_thread_count(thread_count);
+    std::vector<std::unique_ptr<region_file_reader>> readers(thread_count);
+    std::vector<size_t> reader_paths(thread_count, SIZE_MAX);
+
+    for_each_item(chunks.size(), thread_count, [&](size_t item, unsigned int thread) {
+        const chunk_item& chunk = chunks[item];
+
+        if (reader_paths[thread] != chunk.path) {
+            readers[thread].reset(new region_file_reader(paths[chunk.path]));
+            readers[thread]->read(true);
+            reader_paths[thread] = chunk.path;
+        }
+        region_file_reader& reader = *readers[thread];
+        if (!reader.is_filled(chunk.x, chunk.z))
+            return;
+        work(reader, chunk.x, chunk.z, item, thread);
+        reader.get_chunk_tag_at(chunk.x, chunk.z).clean_root();
+    });
+}
+
+/*
+ * Run work on items [0, count) over thread_count threads (0 for one per core).
+ * The first exception thrown by a worker is rethrown once all threads are done.
+ */
+void parallel::for_each_item(size_t count, unsigned int thread_count, const item_work& work) {
+    std::atomic<size_t> next(0);
+    std::exception_ptr error;
+    std::mutex error_mutex;
+    std::vector<std::thread> threads;
+
+    thread_count = get_thread_count(thread_count);
+    auto worker = [&](unsigned int thread) {
+        size_t item;
+        while ((item = next.fetch_add(1)) < count) {
+            try {
+                work(item, thread);
+            } catch (...) {
+                std::lock_guard<std::mutex> lock(error_mutex);
+                if (!error)
+                    error = std::current_exception();
+                next = count; // stop handing out work
+            }
+        }
+    };
+
+    // the calling thread works as thread 0
+    for (unsigned int thread = 1; thread < thread_count && thread < count; ++thread) {
+        threads.emplace_back(worker, thread);
+    }
+    worker(0);
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+    if (error)
+        std::rethrow_exception(error);
+}
+
+/*
+ * Returns the number of threads to use for a requested count (0 for one per core)
+ */
+unsigned int parallel::get_thread_count(unsigned int requested) {
+    if (requested)
+        return requested;
+    requested = std::thread::hardware_concurrency();
+    return requested ? requested : 1;
+}
@@ -34,28 +34,6 @@
 #include "../include/tag/short_tag.h"
 #include "../include/tag/string_tag.h"
 
-/*
- * Region constructor
- */
-region::region(const region& other) : header(other.header), x(other.x), z(other.z) {
-
-    // assign attributes
-    for (unsigned int i = 0; i < region_dim::CHUNK_COUNT; ++i) {
-        tags[i] = other.tags[i];
-    }
-}
-
-/*
- * Region constructor
- */
-region::region(int x, int z, const region_header& header, const chunk_tag (& tags)[region_dim::CHUNK_COUNT]) : header(header), x(x), z(z) {
-
-    // assign attributes
-    for (unsigned int i = 0; i < region_dim::CHUNK_COUNT; ++i) {
-        this->tags[i] = tags[i];
-    }
-}
-
 /*
  * Region assignment operator
  */
@@ -67,9 +45,7 @@ region& region::operator=(const region& other) {
 
     // assign attributes
     header = other.header;
-    for (unsigned int i = 0; i < region_dim::CHUNK_COUNT; ++i) {
-        tags[i] = other.tags[i];
-    }
+    tags = other.tags;
     x = other.x;
     z = other.z;
     return *this;
@@ -89,11 +65,7 @@ bool region::operator==(const region& other) {
         || x != other.x
         || z != other.z)
         return false;
-    for (unsigned int i = 0; i < region_dim::CHUNK_COUNT; ++i) {
-        if (tags[i] != other.tags[i])
-            return false;
-    }
-    return true;
+    return tags == other.tags;
 }
 
 /*
@@ -101,12 +73,9 @@ bool region::operator==(const region& other) {
  */
 void region::generate(int x, int z, region& reg) {
 
-    // cleanup old tags and assign new chunks
-    for (unsigned int i = 0; i < region_dim::CHUNK_COUNT; ++i) {
-        reg.get_tag_at(i).clean_root();
-        reg.get_tag_at(i) = chunk_tag();
-        reg.get_header().set_info_at(i, chunk_info(0, 0, chunk_info::ZLIB, 0));
-    }
+    // cleanup old tags and info, chunks are allocated as they are generated
+    reg.tags.clear();
+    reg.header = region_header();
     reg.set_x(x);
     reg.set_z(z);
 }
@@ -187,7 +156,7 @@ chunk_tag& region::get_tag_at(unsigned int index) {
     // check for valid index
     if (index >= region_dim::CHUNK_COUNT)
         throw std::out_of_range("index out-of-range");
-    return tags[index];
+    return tags.at(index);
 }
 
 /*
@@ -198,18 +167,8 @@ bool region::is_filled(unsigned int index) {
     // check for valid index
     if (index >= region_dim::CHUNK_COUNT)
         throw std::out_of_range("index out-of-range");
-    return !header.get_info_at(index).empty();
-}
-
-/*
- * Sets a region's tags
- */
-void region::set_tags(const chunk_tag (& tags)[region_dim::CHUNK_COUNT]) {
-
-    // set info
-    for (unsigned int i = 0; i < region_dim::CHUNK_COUNT; ++i) {
-        this->tags[i] = tags[i];
-    }
+    chunk_info* info = header.find_info_at(index);
+    return info && !info->empty();
 }
 
 /*
@@ -220,7 +179,7 @@ void region::set_tag_at(unsigned int index, chunk_tag& tag) {
     // check for valid index
     if (index >= region_dim::CHUNK_COUNT)
         throw std::out_of_range("index out-of-range");
-    tags[index] = tag;
+    tags.at(index) = tag;
 }
 
 /*
@@ -232,9 +191,10 @@ std::string region::to_string(void) {
     // form string representation
     ss << "(" << x << ", " << z << "): " << header.to_string() << std::endl;
     for (unsigned int i = 0; i < region_dim::CHUNK_COUNT; ++i) {
-        if (header.get_info_at(i).empty())
+        chunk_info* info = header.find_info_at(i);
+        if (!info || info->empty())
             continue;
-        ss << i << ": " << header.get_info_at(i).to_string() << std::endl;
+        ss << i << ": " << info->to_string() << std::endl;
     }
     return ss.str();
 }
@@ -17,12 +17,17 @@
 * along with this program.  If not, see <http://www.gnu.org/licenses/>.
 */
 
+#include <algorithm>
 #include <sstream>
 #include <vector>
 #include <iostream>
+#include "../include/biome_grid.h"
+#include "../include/block_registry.h"
+#include "../include/chunk_format.h"
 #include "../include/chunk_info.h"
 #include "../include/chunk_tag.h"
 #include "../include/compression.h"
+#include "../include/packed_array.h"
 #include "../include/region_dim.h"
 #include "../include/region_file_reader.h"
 #include "../include/tag/byte_tag.h"
@@ -53,6 +58,10 @@ region_file_reader& region_file_reader::operator=(const region_file_reader& othe
     // assign attributes
     path = other.path;
     reg = other.reg;
+    decode_and_drop = other.decode_and_drop;
+    sidecar = other.sidecar;
+    view.reset();
+    view_pos = region_dim::CHUNK_COUNT;
     return *this;
 }
 
@@ -74,196 +83,171 @@ bool region_file_reader::operator==(const region_file_reader& other) {
  * Returns a region biome value at a given x, z & b coord
  */
 char region_file_reader::get_biome_at(unsigned int x, unsigned int z, unsigned int b_x, unsigned int b_z) {
-    std::vector<generic_tag*> biome;
-    unsigned int pos = z * region_dim::CHUNK_WIDTH + x,
-        b_pos = b_z * region_dim::BLOCK_WIDTH + b_x;
+    unsigned int b_pos = b_z * region_dim::BLOCK_WIDTH + b_x;
 
     // check coordinates
-    if (pos >= region_dim::CHUNK_COUNT
-        || b_pos >= region_dim::BLOCK_COUNT)
+    if (b_pos >= region_dim::BLOCK_COUNT)
         throw std::out_of_range("coordinates out-of-range");
 
-    // collect biome tags
-    biome = reg.get_tag_at(pos).get_sub_tag_by_name("Biomes");
-    if (biome.empty())
+    // per column biomes only
+    chunk_view* chunk = find_chunk_view(x, z);
+    if (!chunk)
         return 0;
-    return static_cast<byte_array_tag*>(biome.at(0))->at(b_pos);
+    generic_tag* biomes = chunk->get_biomes();
+    if (!biomes || biomes->get_type() != generic_tag::BYTE_ARRAY)
+        return 0;
+    return static_cast<byte_array_tag*>(biomes)->at(b_pos);
 }
 
 /*
  * Returns a region's biomes at a given x, z coord
  */
 std::vector<char> region_file_reader::get_biomes_at(unsigned int x, unsigned int z) {
-    std::vector<char> biomes;
-    std::vector<generic_tag*> biome;
-    unsigned int pos = z * region_dim::CHUNK_WIDTH + x;
-
-    // check coordinates
-    if (pos >= region_dim::CHUNK_COUNT)
-        throw std::out_of_range("coordinates out-of-range");
 
-    // collect biome tags
-    biome = reg.get_tag_at(pos).get_sub_tag_by_name("Biomes");
-    if (biome.empty())
-        return biomes;
-    return static_cast<byte_array_tag*>(biome.at(0))->get_value();
+    // per column biomes only
+    chunk_view* chunk = find_chunk_view(x, z);
+    if (!chunk)
+        return std::vector<char>();
+    generic_tag* biomes = chunk->get_biomes();
+    if (!biomes || biomes->get_type() != generic_tag::BYTE_ARRAY)
+        return std::vector<char>();
+    return static_cast<byte_array_tag*>(biomes)->get_value();
 }
 
 /*
  * Returns a region block value at given x, z & b coord
  */
-int
-region_file_reader::get_block_at(unsigned int x, unsigned int z, unsigned int b_x, unsigned int b_y, unsigned int b_z) {
-    std::vector<char> sect_blocks;
-    std::vector<generic_tag*> section;
-    unsigned int pos = z * region_dim::CHUNK_WIDTH + x, sect;
+int region_file_reader::get_block_at(unsigned int x, unsigned int z, unsigned int b_x, unsigned int b_y, unsigned int b_z) {
 
     // check coordinates
-    if (pos >= region_dim::CHUNK_COUNT)
+    if (b_x >= region_dim::BLOCK_WIDTH || b_z >= region_dim::BLOCK_WIDTH)
         throw std::out_of_range("coordinates out-of-range");
-    section = reg.get_tag_at(pos).get_sub_tag_by_name("Blocks");
 
-    // return an air block if no blocks exists in a given chunk
-    if (section.empty())
+    // return an air block if no blocks exists at a given y coord
+    chunk_view* chunk = find_chunk_view(x, z);
+    if (!chunk)
         return 0;
-
-    // check if y coord exists in file
-    if ((sect = b_y / region_dim::BLOCK_WIDTH) >= section.size())
+    const legacy_section* section = chunk->get_legacy_section(b_y / region_dim::BLOCK_WIDTH);
+    if (!section)
         return 0;
+    return section->get_block_id_at(b_x, b_y % region_dim::BLOCK_WIDTH, b_z);
+}
 
-    // retrieve block from the appropriate section
-    sect_blocks = static_cast<byte_array_tag*>(section.at(sect))->get_value();
-
-    // TODO: check for "AddBlock" tag and apply to block id
+/*
+ * Returns a region block data value at given x, z & b coord (pre-1.13 chunks)
+ */
+int region_file_reader::get_block_data_at(unsigned int x, unsigned int z, unsigned int b_x, unsigned int b_y,
+        unsigned int b_z) {
 
-    return sect_blocks.at(
-        ((b_y % region_dim::BLOCK_WIDTH) * region_dim::BLOCK_WIDTH + b_z) * region_dim::BLOCK_WIDTH + b_x);
+    // check coordinates
+    if (b_x >= region_dim::BLOCK_WIDTH || b_z >= region_dim::BLOCK_WIDTH)
+        throw std::out_of_range("coordinates out-of-range");
+    chunk_view* chunk = find_chunk_view(x, z);
+    if (!chunk)
+        return 0;
+    const legacy_section* section = chunk->get_legacy_section(b_y / region_dim::BLOCK_WIDTH);
+    if (!section)
+        return 0;
+    return section->get_data_at(b_x, b_y % region_dim::BLOCK_WIDTH, b_z);
 }
 
-std::shared_ptr<Chunk> region_file_reader::getChunkAt(int32_t chunkX, int32_t chunkZ) {
+std::shared_ptr<Chunk> region_file_reader::getChunkAt(int32_t chunkX, int32_t chunkZ, uint32_t fields) {
     std::array<int32_t, 2> pos{chunkX, chunkZ};
     std::shared_ptr<Chunk> chunk = std::make_shared<Chunk>(pos);
-    readChunk(chunk);
+    readChunk(chunk, fields);
     return chunk;
 }
 
-void region_file_reader::readChunk(std::shared_ptr<Chunk> chunk) {
-    std::vector<generic_tag*> sections;
-    int32_t x = chunk->getPos()[0];
-    int32_t z = chunk->getPos()[1];
-    unsigned int pos = z * region_dim::CHUNK_WIDTH + x;
-
-    // For debug
-    std::vector<generic_tag*> xPosEntries = reg.get_tag_at(pos).get_sub_tag_by_name("xPos");
-    std::vector<generic_tag*> zPosEntries = reg.get_tag_at(pos).get_sub_tag_by_name("zPos");
+void region_file_reader::readChunk(std::shared_ptr<Chunk> chunk, uint32_t fields) {
+    chunk_status::check(tryReadChunk(chunk, fields), chunk->getPos()[0], chunk->getPos()[1]);
+}
 
-    if (xPosEntries.empty() || zPosEntries.empty()) {
-        read_chunk(x, z);
-        xPosEntries = reg.get_tag_at(pos).get_sub_tag_by_name("xPos");
-        zPosEntries = reg.get_tag_at(pos).get_sub_tag_by_name("zPos");
-        if (xPosEntries.empty() || zPosEntries.empty()) {
-            throw std::out_of_range("Could not loat chunk at " + std::to_string(x) + "|" + std::to_string(z));
+chunk_status::STATUS region_file_reader::tryReadChunk(std::shared_ptr<Chunk> chunk, uint32_t fields) {
+    int xPos, zPos;
+    list_tag* subChunk;
+    chunk_format::GENERATION generation;
+    unsigned int x = chunk->getPos()[0], z = chunk->getPos()[1];
+    unsigned int pos = z * region_dim::CHUNK_WIDTH + x;
+    chunk_info* info = NULL;
+
+    // a valid sidecar entry spares reading, inflating and parsing the chunk
+    if (sidecar && fields == Chunk::BLOCKS && x < region_dim::CHUNK_WIDTH && z < region_dim::CHUNK_WIDTH) {
+        info = reg.get_header().find_info_at(pos);
+        if (info && info->empty())
+            info = NULL;
+        if (info) {
+            array_view<const char> data = sidecar->find(pos, info->get_modified(), info->get_offset());
+            if (!data.empty() && chunk->readSections(data.data(), data.size()))
+                return chunk_status::OK;
         }
     }
+    chunk_status::STATUS status = try_get_chunk_sections(x, z, generation, xPos, zPos, subChunk);
+    if (status != chunk_status::OK) {
 
-    sections = reg.get_tag_at(pos).get_sub_tag_by_name("Sections");
-
-    if (sections.size() != 1) {
-        throw std::out_of_range("Number of sections is not equal to 1");
+        // chunks without sections or position are parsed before being reported
+        if (decode_and_drop && is_loaded(x, z))
+            get_chunk_tag_at(x, z).clean_root();
+        return status;
     }
 
-    int xPos = static_cast<int_tag*>(xPosEntries.at(0))->get_value();
-    int32_t blockOffsetX = xPos * 16;
-    int zPos = static_cast<int_tag*>(zPosEntries.at(0))->get_value();
-    int32_t blockOffsetZ = zPos * 16;
-
-    list_tag* subChunk = static_cast<list_tag*>(sections[0]);
-    for (int i = 0; i < subChunk->size(); ++i) {
-        for (int x = 0; x < 16; ++x) {
-            for (int z = 0; z < 16; ++z) {
-                compound_tag* subChunkEntry = static_cast<compound_tag*>(subChunk->at(i));
-                addSubchunk(subChunkEntry, x, z,{blockOffsetX, blockOffsetZ}, chunk);
-            }
+    chunk->setOrigin({xPos * 16, zPos * 16});
+    try {
+
+        // decode every section once, blocks are served from the chunk's dense indices
+        if (fields & Chunk::BLOCKS) {
+            chunk_section section;
+            for (unsigned int i = 0; i < subChunk->size(); ++i) {
+                if (chunk_section::decode(static_cast<compound_tag*>(subChunk->at(i)), generation, section)) {
+                    chunk->addSection(section);
+                }
+            }//for sectionEntries (aka subchunks)
         }
-
-
-    }//for sectionEntries (aka subchunks)
-}
-
-void region_file_reader::addSubchunk(compound_tag* sectionEntry, int32_t chunkX, int32_t chunkZ, std::array<int32_t, 2> blockOffset,
-                                     std::shared_ptr<Chunk> chunk) {
-
-    byte_tag* yValue = static_cast<byte_tag*>(sectionEntry->get_subtag("Y"));
-    int yPos = yValue->get_value();
-
-    generic_tag* blockStates = sectionEntry->get_subtag("BlockStates");
-    if (!blockStates) {
-        return; // air-only subchunks are empty
-    }
-    generic_tag* palette = sectionEntry->get_subtag("Palette");
-
-    std::vector<int64_t> blockStateEntries = static_cast<long_array_tag*>(blockStates)->get_value();
-    std::vector<generic_tag*> paletteEntries = static_cast<list_tag*>(palette)->get_value();
-
-    // Iterate through block states, calculate palette indices and query indices value
-
-    // Calculate the number of required bits. Depends on the size of the palette
-    int bitPerIndex = ceil(log2(paletteEntries.size()));
-    if (bitPerIndex < 4) {
-        bitPerIndex = 4; // 4 is the minimal size
-    }
-
-    for (int subChunkCounter = 0; subChunkCounter < 16; ++subChunkCounter) { // From bottom to top
-        uint64_t blockNumber = 16 * 16 * subChunkCounter + 16 * chunkZ + chunkX;
-
-        uint64_t paletteIndex = getPaletteIndex(blockStateEntries, blockNumber, bitPerIndex);
-
-        if (paletteIndex >= paletteEntries.size()) {
-            throw std::out_of_range("Palette index out-of-range");
+        if (fields & Chunk::BIOMES) {
+            biome_grid biomes;
+            if (biomes.decode(get_chunk_tag_at(x, z).get_root_tag()))
+                chunk->setBiomes(std::move(biomes));
         }
-        generic_tag* compountEntry = static_cast<compound_tag*>(paletteEntries[paletteIndex])->get_subtag("Name");
-        std::string name = static_cast<string_tag*>(compountEntry)->get_value();
-        name.erase(0, 10); // Erase minecraft:
-
-        int realY = yPos * 16 + subChunkCounter;
-        Block block{name, {chunkX + blockOffset[0], realY, chunkZ + blockOffset[1]}};
-        chunk->addBlock(block);
+    } catch (const std::runtime_error&) {
+        status = chunk_status::CORRUPT; // malformed block states or biomes
+    } catch (const std::out_of_range&) {
+        status = chunk_status::CORRUPT; // palette index past the palette
+    } catch (...) {
+        if (decode_and_drop)
+            get_chunk_tag_at(x, z).clean_root();
+        throw;
+    }
 
+    // only the decoded fields outlive the call
+    if (decode_and_drop)
+        get_chunk_tag_at(x, z).clean_root();
+    if (status != chunk_status::OK)
+        return status;
+    if (info) {
+        std::vector<char> data;
+        chunk->writeSections(data);
+        sidecar->insert(pos, info->get_modified(), info->get_offset(), std::move(data));
     }
+    return chunk_status::OK;
 }
+
 // ###############################################################################################################################
 
 std::vector<Block> region_file_reader::get_blocks_at(unsigned int chunkX, unsigned int chunkZ, unsigned int blockX, unsigned int blockZ) {
-    std::vector<generic_tag*> sections;
-    unsigned int pos = chunkZ * region_dim::CHUNK_WIDTH + chunkX;
-
+    int xPos, zPos;
+    chunk_format::GENERATION generation;
     std::vector<Block> foundBlocks;
 
-    // For debug
-    std::vector<generic_tag*> xPosEntries = reg.get_tag_at(pos).get_sub_tag_by_name("xPos");
-	if (!xPosEntries.size())
-		return {};
-    int xPos = static_cast<int_tag*>(xPosEntries.at(0))->get_value();
+    list_tag* subChunk = get_chunk_sections(chunkX, chunkZ, false, generation, xPos, zPos);
+    if (!subChunk)
+        return {};
     int blockIdX = xPos * 16;
-    std::vector<generic_tag*> zPosEntries = reg.get_tag_at(pos).get_sub_tag_by_name("zPos");
-    int zPos = static_cast<int_tag*>(zPosEntries.at(0))->get_value();
     int blockIdZ = zPos * 16;
 
-    //std::cout << "In " << xPos << " " << zPos << std::endl;
-
-    sections = reg.get_tag_at(pos).get_sub_tag_by_name("Sections");
-
-    if (sections.size() != 1) {
-        throw std::out_of_range("Number of sections is not equal to 1");
-    }
-
-
-    list_tag* subChunk = static_cast<list_tag*>(sections[0]);
-    for (int i = 0; i < subChunk->size(); ++i) {
+    for (unsigned int i = 0; i < subChunk->size(); ++i) {
         compound_tag* subChunkEntry = static_cast<compound_tag*>(subChunk->at(i));
         std::vector<Block> subchunkBlocks;
 
-		get_blocks_from_subchunk(subChunkEntry, chunkX, chunkZ, blockX, blockZ, subchunkBlocks);
+		get_blocks_from_subchunk(subChunkEntry, generation, blockX, blockZ, subchunkBlocks);
 
         for (Block& b : subchunkBlocks) {
             std::array<int, 3> blockPosInChunk = b.getPos();
@@ -278,13 +262,11 @@ std::vector<Block> region_file_reader::get_blocks_at(unsigned int chunkX, unsign
 
 std::vector<Block> region_file_reader::get_blocks_in_range(unsigned int lowerX, unsigned int upperX, unsigned int lowerZ, unsigned int upperZ) {
     std::vector<Block> foundBlocks;
-    foundBlocks.reserve((upperX - lowerX) * (upperZ - lowerZ) * 16 * 16 * 16);
     for (unsigned int x = lowerX; x < upperX; ++x) {
         for (unsigned int z = lowerZ; z < upperZ; ++z) {
             get_blocks_at(x, z, foundBlocks);
         }
     }
-    //foundBlocks.shrink_to_fit();
     return foundBlocks;
 }
 
@@ -292,72 +274,33 @@ std::vector<Block> region_file_reader::get_blocks_in_range(unsigned int lowerX,
  * Returns a region's blocks at a given x, z coord
  */
 void region_file_reader::get_blocks_at(unsigned int x, unsigned int z, std::vector<Block>& foundBlocks) {
-    std::vector<generic_tag*> sections;
-    unsigned int pos = z * region_dim::CHUNK_WIDTH + x;
-
-    // For debug
-    std::vector<generic_tag*> xPosEntries = reg.get_tag_at(pos).get_sub_tag_by_name("xPos");
-    std::vector<generic_tag*> zPosEntries = reg.get_tag_at(pos).get_sub_tag_by_name("zPos");
-
-    if (xPosEntries.empty() || zPosEntries.empty()) {
-        read_chunk(x, z);
-        xPosEntries = reg.get_tag_at(pos).get_sub_tag_by_name("xPos");
-        zPosEntries = reg.get_tag_at(pos).get_sub_tag_by_name("zPos");
-        if (xPosEntries.empty() || zPosEntries.empty()) {
-            throw std::out_of_range("Could not loat chunk at " + std::to_string(x) + "|" + std::to_string(z));
-        }
-    }
-
-    int xPos = static_cast<int_tag*>(xPosEntries.at(0))->get_value();
-    int blockIdX = xPos * 16;
-    int zPos = static_cast<int_tag*>(zPosEntries.at(0))->get_value();
-    int blockIdZ = zPos * 16;
-
-    //std::cout << "In " << xPos  << " " << zPos << std::endl;
-
-    sections = reg.get_tag_at(pos).get_sub_tag_by_name("Sections");
-
-    if (sections.size() != 1) {
-        throw std::out_of_range("Number of sections is not equal to 1");
-    }
-
-
-    list_tag* subChunk = static_cast<list_tag*>(sections[0]);
-    for (int i = 0; i < subChunk->size(); ++i) {
-        for (int x = 0; x < 16; ++x) {
-            for (int z = 0; z < 16; ++z) {
-                compound_tag* subChunkEntry = static_cast<compound_tag*>(subChunk->at(i));
-                get_blocks_from_subchunk(subChunkEntry, x, z, blockIdX, blockIdZ, foundBlocks);
-            }
-        }
+    block_registry& registry = block_registry::get_instance();
 
-
-    }//for sectionEntries (aka subchunks)
+    visit_blocks_at(x, z, [&](int32_t blockX, int32_t blockY, int32_t blockZ, uint32_t id) {
+        foundBlocks.emplace_back(registry.get_name(id), std::array<int32_t, 3>{blockX, blockY, blockZ});
+    });
 }
 
-void region_file_reader::get_blocks_from_subchunk(compound_tag* sectionEntry, uint64_t chunkX, uint64_t chunkZ, unsigned int blockX,
+void region_file_reader::get_blocks_from_subchunk(compound_tag* sectionEntry, chunk_format::GENERATION generation, unsigned int blockX,
                                                   unsigned int blockZ, std::vector<Block>& blockList) {
+    list_tag* palette;
+    long_array_tag* blockStates;
 
-    byte_tag* yValue = static_cast<byte_tag*>(sectionEntry->get_subtag("Y"));
-    int yPos = yValue->get_value();
-
-    generic_tag* blockStates = sectionEntry->get_subtag("BlockStates");
-    if (!blockStates) {
+    int yPos;
+    if (!chunk_format::get_section_y(sectionEntry, yPos)
+            || !chunk_section::get_block_states(sectionEntry, generation, palette, blockStates)) {
         return; // air-only subchunks are empty
     }
-    generic_tag* palette = sectionEntry->get_subtag("Palette");
 
-    std::vector<int64_t> blockStateEntries = static_cast<long_array_tag*>(blockStates)->get_value();
-    std::vector<generic_tag*> paletteEntries = static_cast<list_tag*>(palette)->get_value();
+    array_view<generic_tag* const> paletteEntries = palette->get_view();
 
     // Iterate through block states, calculate palette indices and query indices value
-    int bitPerIndex = static_cast<int>(blockStateEntries.size() * 64 / 4096);
+    unsigned int bitPerIndex = chunk_section::get_bits(paletteEntries.size());
+    bool padded = generation >= chunk_format::PADDED;
 
     for (uint64_t y = 0; y < 16; ++y) {
 		uint64_t blockNumber = 16*16*y + 16*blockZ + blockX;
-        uint64_t indexOffset = blockNumber * bitPerIndex;
-
-        uint64_t paletteIndex = getPaletteIndex(blockStateEntries, blockNumber, bitPerIndex);
+        uint64_t paletteIndex = blockStates ? packed_array::get(blockStates->get_view(), bitPerIndex, padded, blockNumber) : 0;
 
         if (paletteIndex >= paletteEntries.size()) {
             //throw std::out_of_range("Palette index out-of-range");
@@ -376,46 +319,36 @@ void region_file_reader::get_blocks_from_subchunk(compound_tag* sectionEntry, ui
     }
 }
 
-uint64_t region_file_reader::getPaletteIndex(std::vector<int64_t> const& blockStateEntries, uint64_t blockNumber, unsigned int bitPerIndex) {
-    uint64_t paletteIndex = 0;
-
-    // Slight changes in 1.16:
-    /*if (bitPerIndex % 2 != 0) {
-        // Highest bits will not be used, eg at 5 bits the highest 4 bit wont be used.
-        uint8_t numberOfStatesPerEntry = 64 / bitPerIndex;
-        uint16_t vectorIndexForBlockOfInterest = (blockNumber / numberOfStatesPerEntry);
-
-        uint16_t stateNumberInEntry = blockNumber - vectorIndexForBlockOfInterest * numberOfStatesPerEntry;
-        uint16_t bitOffsetInEntry = stateNumberInEntry * bitPerIndex;
-        unsigned int lowerBound = bitOffsetInEntry;
-        unsigned int upperBound = lowerBound + bitPerIndex;
+/*
+ * Returns the section list of a chunk at a given x, z coord, along with its layout and position.
+ * Returns NULL if the chunk is not loaded and load is false.
+ */
+list_tag* region_file_reader::get_chunk_sections(unsigned int x, unsigned int z, bool load, chunk_format::GENERATION& generation,
+        int& x_pos, int& z_pos) {
+    list_tag* sections = NULL;
+
+    if (!load && !is_loaded(x, z))
+        return NULL;
+    chunk_status::STATUS status = try_get_chunk_sections(x, z, generation, x_pos, z_pos, sections);
+    if (status != chunk_status::OK && !load)
+        return NULL;
+    chunk_status::check(status, x, z);
+    return sections;
+}
 
-        paletteIndex = getBits(blockStateEntries[vectorIndexForBlockOfInterest], lowerBound, upperBound);
-    }
-    else {*/
-        unsigned int indexOfInterest = (blockNumber * bitPerIndex) / 64;
-        unsigned int lowerBound = (blockNumber * bitPerIndex) % 64;
-        unsigned int upperBound = lowerBound + bitPerIndex;
-       
-        if (upperBound > 64) {
-            // The upper bound is in the next index
-            uint64_t lowerBits = getBits(blockStateEntries[indexOfInterest], lowerBound,
-                64); // Get remaining bits in current index
-            uint64_t higherBits = getBits(blockStateEntries[indexOfInterest + 1], 0,
-                upperBound - 64); // And the one from the next entry
-
-            paletteIndex = (higherBits << (64 - lowerBound) | lowerBits); // Combine values
-        }
-        else {
-            paletteIndex = getBits(blockStateEntries[indexOfInterest], lowerBound, upperBound);
-        }
-	//}
+/*
+ * Returns a view of a chunk at a given x, z coord, reading the chunk on first use. The view is
+ * kept for further queries until another chunk is viewed or the chunk's tag changes.
+ */
+chunk_view& region_file_reader::get_chunk_view(unsigned int x, unsigned int z) {
+    chunk_view* result = NULL;
 
-    return paletteIndex;
+    chunk_status::check(try_get_chunk_view(x, z, result), x, z);
+    return *result;
 }
 
 /*
- * Returns a region's chunk tag at a given x, z coord
+ * Returns a region's chunk tag at a given x, z coord, allocating its slot on first use
  */
 chunk_tag& region_file_reader::get_chunk_tag_at(unsigned int x, unsigned int z) {
     unsigned int pos = z * region_dim::CHUNK_WIDTH + x;
@@ -426,43 +359,194 @@ chunk_tag& region_file_reader::get_chunk_tag_at(unsigned int x, unsigned int z)
     return reg.get_tag_at(pos);
 }
 
+/*
+ * Decode a region's chunk at a given x, z coord one section at a time, calling visit(section, chunk x, chunk z)
+ * with the chunk's world position (in chunks). Chunks loaded for the visit are dropped afterwards.
+ */
+void region_file_reader::visit_sections_at(unsigned int x, unsigned int z, const std::function<void(const chunk_section&, int, int)>& visit) {
+    chunk_status::check(try_visit_sections_at(x, z, visit), x, z);
+}
+
+/*
+ * Returns the root compound of a chunk at a given x, z coord, reading it on first use.
+ * Returns the chunk's status instead of throwing.
+ */
+chunk_status::STATUS region_file_reader::try_load_root(unsigned int x, unsigned int z, compound_tag*& root) {
+
+    // empty chunks are reported without allocating a slot
+    if (!is_loaded(x, z)) {
+        chunk_status::STATUS status = try_read_chunk(x, z);
+        if (status != chunk_status::OK)
+            return status;
+    }
+    root = &get_chunk_tag_at(x, z).get_root_tag();
+    return chunk_status::OK;
+}
+
+/*
+ * Returns the section list of a chunk at a given x, z coord, along with its layout and position,
+ * reading the chunk on first use. Returns the chunk's status instead of throwing.
+ */
+chunk_status::STATUS region_file_reader::try_get_chunk_sections(unsigned int x, unsigned int z, chunk_format::GENERATION& generation,
+        int& x_pos, int& z_pos, list_tag*& sections) {
+    chunk_view* result;
+
+    // the view resolves layout, position and sections once per chunk
+    chunk_status::STATUS status = try_get_chunk_view(x, z, result);
+    if (status != chunk_status::OK)
+        return status;
+    generation = result->get_generation();
+    if (!result->has_position())
+        return chunk_status::CORRUPT;
+    if (!result->get_sections())
+        return chunk_status::EMPTY;
+    x_pos = result->get_x_pos();
+    z_pos = result->get_z_pos();
+    sections = result->get_sections();
+    return chunk_status::OK;
+}
+
+/*
+ * Returns a view of a chunk at a given x, z coord, reading the chunk on first use (see get_chunk_view).
+ * Returns the chunk's status instead of throwing.
+ */
+chunk_status::STATUS region_file_reader::try_get_chunk_view(unsigned int x, unsigned int z, chunk_view*& result) {
+    compound_tag* root;
+    chunk_tag* tag;
+    unsigned int pos = z * region_dim::CHUNK_WIDTH + x;
+
+    // dropping or replacing the chunk's tags changes its revision
+    if (!view || view_pos != pos || !(tag = reg.find_tag_at(pos)) || view_revision != tag->get_revision()) {
+        chunk_status::STATUS status = try_load_root(x, z, root);
+        if (status != chunk_status::OK)
+            return status;
+        view.reset(new chunk_view(*root));
+        view_pos = pos;
+        view_revision = get_chunk_tag_at(x, z).get_revision();
+    }
+    result = view.get();
+    return chunk_status::OK;
+}
+
+/*
+ * Decode a region's chunk at a given x, z coord one section at a time (see visit_sections_at).
+ * Returns the chunk's status instead of throwing, exceptions thrown by visit are passed on.
+ */
+chunk_status::STATUS region_file_reader::try_visit_sections_at(unsigned int x, unsigned int z,
+        const std::function<void(const chunk_section&, int, int)>& visit) {
+    int xPos, zPos;
+    list_tag* subChunk;
+    chunk_format::GENERATION generation;
+    chunk_section section;
+    chunk_status::STATUS status;
+    bool loaded = is_loaded(x, z);
+
+    try {
+        status = try_get_chunk_sections(x, z, generation, xPos, zPos, subChunk);
+        if (status == chunk_status::OK) {
+            for (unsigned int i = 0; i < subChunk->size(); ++i) {
+                bool decoded;
+
+                // only decoding errors mark the chunk corrupt, exceptions from visit propagate
+                try {
+                    decoded = chunk_section::decode(static_cast<compound_tag*>(subChunk->at(i)), generation, section);
+                } catch (const std::runtime_error&) {
+                    status = chunk_status::CORRUPT;
+                    break;
+                } catch (const std::out_of_range&) {
+                    status = chunk_status::CORRUPT;
+                    break;
+                }
+                if (decoded)
+                    visit(section, xPos, zPos);
+            }
+        }
+    } catch (...) {
+        if (!loaded && is_loaded(x, z))
+            get_chunk_tag_at(x, z).clean_root();
+        throw;
+    }
+    if (!loaded && is_loaded(x, z))
+        get_chunk_tag_at(x, z).clean_root();
+    return status;
+}
+
 /*
  * Returns a region height value at a given x, z & b coord
  */
 int region_file_reader::get_height_at(unsigned int x, unsigned int z, unsigned int b_x, unsigned int b_z) {
-    std::vector<generic_tag*> height;
-    unsigned int pos = z * region_dim::CHUNK_WIDTH + x,
-        b_pos = b_z * region_dim::BLOCK_WIDTH + b_x;
+    unsigned int b_pos = b_z * region_dim::BLOCK_WIDTH + b_x;
 
     // check coordinates
-    if (pos >= region_dim::CHUNK_COUNT
-        || b_pos >= region_dim::BLOCK_COUNT)
+    if (b_pos >= region_dim::BLOCK_COUNT)
         throw std::out_of_range("coordinates out-of-range");
-
-    // collect biome tags
-    height = reg.get_tag_at(pos).get_sub_tag_by_name("HeightMap");
-    if (height.empty())
+    chunk_view* chunk = find_chunk_view(x, z);
+    if (!chunk)
         return 0;
-    return static_cast<int_array_tag*>(height.at(0))->at(b_pos);
+    int_array_tag* height_map = chunk->get_height_map();
+    if (!height_map)
+        return 0;
+    return height_map->at(b_pos);
 }
 
 /*
  * Returns a region's height map at a given x, z coord
  */
 std::vector<int> region_file_reader::get_heightmap_at(unsigned int x, unsigned int z) {
-    std::vector<int> heights;
-    std::vector<generic_tag*> height;
-    unsigned int pos = z * region_dim::CHUNK_WIDTH + x;
+    chunk_view* chunk = find_chunk_view(x, z);
+    if (!chunk)
+        return std::vector<int>();
+    int_array_tag* height_map = chunk->get_height_map();
+    if (!height_map)
+        return std::vector<int>();
+    return height_map->get_value();
+}
 
-    // check coordinates
-    if (pos >= region_dim::CHUNK_COUNT)
-        throw std::out_of_range("coordinates out-of-range");
+/*
+ * Decode a packed heightmap (e.g. WORLD_SURFACE, MOTION_BLOCKING) of a chunk at a given x, z coord
+ * into 256 heights, ordered z * 16 + x and relative to the chunk's lowest y (see chunk_format::get_min_y).
+ * Returns false if not found.
+ */
+bool region_file_reader::get_heightmap_at(unsigned int x, unsigned int z, const std::string& name, uint16_t* heights) {
+    chunk_view& view = get_chunk_view(x, z);
+    long_array_tag* heightmap = view.get_heightmap(name);
+    bool padded = view.get_generation() >= chunk_format::PADDED;
+
+    if (!heightmap)
+        return false;
+    if (heightmap->size() != packed_array::long_count(chunk_format::HEIGHTMAP_BITS, padded, region_dim::BLOCK_COUNT))
+        throw std::runtime_error("Unexpected heightmap length");
+    packed_array::unpack(heightmap->get_view(), chunk_format::HEIGHTMAP_BITS, padded, heights, region_dim::BLOCK_COUNT);
+    return true;
+}
+
+/*
+ * Returns a byte array of a chunk's section at a given x, z & section y coord, without copying.
+ * Returns an empty view if not found.
+ */
+array_view<const char> region_file_reader::get_section_array(unsigned int x, unsigned int z, int section_y,
+        const std::string& name) {
+    compound_tag* section = get_chunk_view(x, z).get_section_tag(section_y);
+
+    if (!section)
+        return array_view<const char>();
+    generic_tag* array = section->get_subtag(name);
+    if (!array || array->get_type() != generic_tag::BYTE_ARRAY)
+        return array_view<const char>();
+    return static_cast<byte_array_tag*>(array)->get_view();
+}
 
-    // collect biome tags
-    height = reg.get_tag_at(pos).get_sub_tag_by_name("HeightMap");
-    if (height.empty())
-        return heights;
-    return static_cast<int_array_tag*>(height.at(0))->get_value();
+/*
+ * Returns the view of a chunk at a given x, z coord, or NULL if the chunk is empty
+ */
+chunk_view* region_file_reader::find_chunk_view(unsigned int x, unsigned int z) {
+    chunk_view* result = NULL;
+    chunk_status::STATUS status = try_get_chunk_view(x, z, result);
+
+    if (status == chunk_status::EMPTY)
+        return NULL;
+    chunk_status::check(status, x, z);
+    return result;
 }
 
 /*
@@ -477,6 +561,30 @@ bool region_file_reader::is_filled(unsigned int x, unsigned int z) {
     return reg.is_filled(pos);
 }
 
+/*
+ * Return a region's loaded status, true if a chunk at a given x, z coord holds tags.
+ * Unlike get_chunk_tag_at, no slot is allocated for the chunk.
+ */
+bool region_file_reader::is_loaded(unsigned int x, unsigned int z) {
+    unsigned int pos = z * region_dim::CHUNK_WIDTH + x;
+
+    // check coordinates
+    if (pos >= region_dim::CHUNK_COUNT)
+        throw std::out_of_range("coordinates out-of-range");
+    chunk_tag* tag = reg.find_tag_at(pos);
+    return tag && !tag->get_root_tag().empty();
+}
+
+/*
+ * Returns the root compound of a chunk at a given x, z coord, reading it on first use
+ */
+compound_tag& region_file_reader::load_root(unsigned int x, unsigned int z) {
+    compound_tag* root = NULL;
+
+    chunk_status::check(try_load_root(x, z, root), x, z);
+    return *root;
+}
+
 /*
  * Read a tag from data
  */
@@ -535,12 +643,19 @@ generic_tag* region_file_reader::parse_tag(byte_stream& stream, bool is_list, ch
         case generic_tag::LIST: {
             char ele_type = read_value<char>(stream);
             int ele_len = read_value<int>(stream);
+            if (ele_len > 0 && static_cast<size_t>(ele_len) > stream.available())
+                throw std::runtime_error("Unexpected list length");
             list_tag* lst_tag = new list_tag(name, ele_type);
 
-            // parse all subtags and add to list
-            for (int i = 0; i < ele_len; ++i) {
-                sub_tag = parse_tag(stream, true, ele_type);
-                lst_tag->push_back(sub_tag);
+            // parse all subtags and add to list, the partial list is released on failure
+            try {
+                for (int i = 0; i < ele_len; ++i) {
+                    sub_tag = parse_tag(stream, true, ele_type);
+                    lst_tag->push_back(sub_tag);
+                }
+            } catch (...) {
+                chunk_tag::clean_tag(lst_tag);
+                throw;
             }
             tag = lst_tag;
         }
@@ -548,14 +663,19 @@ generic_tag* region_file_reader::parse_tag(byte_stream& stream, bool is_list, ch
         case generic_tag::COMPOUND: {
             compound_tag* cmp_tag = new compound_tag(name);
 
-            // parse all sub_tags and add to compound
-            do {
-                sub_tag = parse_tag(stream, false, 0);
-                if (!sub_tag)
-                    throw std::runtime_error("Failed to parse tag");
-                if (sub_tag->get_type() != generic_tag::END)
-                    cmp_tag->push_back(sub_tag);
-            } while (sub_tag->get_type() != generic_tag::END);
+            // parse all sub_tags and add to compound, the partial compound is released on failure
+            try {
+                do {
+                    sub_tag = parse_tag(stream, false, 0);
+                    if (!sub_tag)
+                        throw std::runtime_error("Failed to parse tag");
+                    if (sub_tag->get_type() != generic_tag::END)
+                        cmp_tag->push_back(sub_tag);
+                } while (sub_tag->get_type() != generic_tag::END);
+            } catch (...) {
+                chunk_tag::clean_tag(cmp_tag);
+                throw;
+            }
             delete sub_tag;
             tag = cmp_tag;
         }
@@ -576,13 +696,13 @@ generic_tag* region_file_reader::parse_tag(byte_stream& stream, bool is_list, ch
 /*
  * Read a chunk tag from data
  */
-void region_file_reader::parse_chunk_tag(std::vector<char>& data, chunk_tag& tag) {
+void region_file_reader::parse_chunk_tag(std::vector<char>&& data, chunk_tag& tag) {
     char type;
     std::string name;
     generic_tag* sub_tag = NULL;
 
     // setup bytestream
-    byte_stream bstream(data);
+    byte_stream bstream(std::move(data));
     bstream.set_swap(byte_stream::NO_SWAP_ENDIAN);
 
     // parse tags from root
@@ -649,21 +769,19 @@ void region_file_reader::read_chunks() {
 
     // iterate though header entries, reading in chunks if they exist
     for (unsigned int i = 0; i < region_dim::CHUNK_COUNT; ++i) {
-        info = reg.get_header().get_info_at(i);
+        chunk_info* entry = reg.get_header().find_info_at(i);
 
         // skip empty chunks
-        if (info.empty())
+        if (!entry || entry->empty())
             continue;
+        info = *entry;
 
         // Retrieve raw data
         size_t length = info.get_length();
-		std::vector<char> raw_data, raw_vec;
-		raw_data.resize(length, 0);
-		file.clear();
+        std::vector<char> raw_vec(length, 0);
+        file.clear();
         file.seekg(info.get_offset(), std::ios::beg);
-        file.read((char *)&raw_data[0], length);
-		raw_vec.clear();
-		raw_vec.insert(raw_vec.begin(), raw_data.begin(), raw_data.end());
+        file.read(raw_vec.data(), length);
 
         // check for compression type
         switch (info.get_type()) {
@@ -681,55 +799,85 @@ void region_file_reader::read_chunks() {
         }
 
         // use data to fill chunk tag
-        parse_chunk_tag(raw_vec, reg.get_tag_at(i));
+        parse_chunk_tag(std::move(raw_vec), reg.get_tag_at(i));
     }
 }
 
 
+/*
+ * Reads chunk information from the mca file at the given chunk, throwing if it cannot be read
+ */
 void region_file_reader::read_chunk(uint16_t x, uint16_t z) {
-    // attempt to open file
-    file.open(path.c_str(), std::ios::in | std::ios::binary);
-    if (!file.is_open())
-        throw std::runtime_error("Failed to open input file");
-
-    chunk_info info;
+    chunk_status::check(try_read_chunk(x, z), x, z);
+}
 
-    uint16_t chunkToRead = z * region_dim::CHUNK_WIDTH + x;
+/*
+ * Reads chunk information from the mca file at the given chunk. Returns the chunk's status
+ * instead of throwing, only I/O failures throw.
+ */
+chunk_status::STATUS region_file_reader::try_read_chunk(uint16_t x, uint16_t z) {
+    std::vector<char> data;
+    chunk_status::STATUS status = try_read_compressed(x, z, data);
 
+    if (status != chunk_status::OK)
+        return status;
+    return try_load_compressed(x, z, std::move(data));
+}
 
-    info = reg.get_header().get_info_at(chunkToRead);
+/*
+ * Fill a chunk's tags at a given x, z coord from its compressed (zlib) data, as returned by
+ * try_read_compressed. Tags already loaded are replaced. Returns the chunk's status instead of throwing.
+ */
+chunk_status::STATUS region_file_reader::try_load_compressed(unsigned int x, unsigned int z, std::vector<char> data) {
+    chunk_tag& tag = get_chunk_tag_at(x, z);
+
+    tag.clean_root();
+    if (!compression::inflate_(data))
+        return chunk_status::CORRUPT;
+
+    // use data to fill chunk tag, malformed tags are the only exceptional case left
+    try {
+        parse_chunk_tag(std::move(data), tag);
+    } catch (const std::runtime_error&) {
+        tag.clean_root();
+        return chunk_status::CORRUPT;
+    }
+    return chunk_status::OK;
+}
 
-    // skip empty chunks
-    if (info.empty())
-        throw std::out_of_range("Chunk at " + std::to_string(x) + "|" + std::to_string(z) + " is empty");
+/*
+ * Reads the compressed (zlib) data of a chunk at a given x, z coord from the mca file, without
+ * decoding it. Returns the chunk's status instead of throwing, only I/O failures throw.
+ */
+chunk_status::STATUS region_file_reader::try_read_compressed(unsigned int x, unsigned int z, std::vector<char>& data) {
+    unsigned int pos = z * region_dim::CHUNK_WIDTH + x;
 
-    // Retrieve raw data
-    char* raw_data = new char[info.get_length()];
-    std::vector<char> raw_vec;
-    file.seekg(info.get_offset(), std::ios::beg);
-    file.read((char*) raw_data, info.get_length());
-    raw_vec.assign(raw_data, raw_data + info.get_length());
+    // check coordinates
+    if (pos >= region_dim::CHUNK_COUNT)
+        throw std::out_of_range("coordinates out-of-range");
+    chunk_info* entry = reg.get_header().find_info_at(pos);
 
-    // check for compression type
-    switch (info.get_type()) {
-        case chunk_info::GZIP:
-            throw std::runtime_error("Unsupported compression type");
-            break;
-        case chunk_info::ZLIB:
-            compression::inflate_(raw_vec);
-            break;
-        default:
-            throw std::runtime_error("Unknown compression type");
-            break;
-    }
+    // skip empty chunks before touching the file
+    if (!entry || entry->empty())
+        return chunk_status::EMPTY;
+    chunk_info& info = *entry;
+    if (info.get_type() != chunk_info::ZLIB)
+        return chunk_status::UNSUPPORTED_COMPRESSION;
 
-    // use data to fill chunk tag
-    parse_chunk_tag(raw_vec, reg.get_tag_at(chunkToRead));
+    // attempt to open file
+    file.open(path.c_str(), std::ios::in | std::ios::binary);
+    if (!file.is_open())
+        throw std::runtime_error("Failed to open input file");
 
+    // Retrieve raw data
+    data.assign(info.get_length(), 0);
+    file.seekg(info.get_offset(), std::ios::beg);
+    file.read(data.data(), info.get_length());
+    data.resize(static_cast<size_t>(file.gcount()));
     file.close();
+    return chunk_status::OK;
 }
 
-
 /*
  * Reads header data from a file
  */
@@ -742,36 +890,38 @@ void region_file_reader::read_header(void) {
     if (!file.is_open())
         throw std::runtime_error("Failed to read header data");
 
-    // read position data into header
+    // read position data into header, info is only allocated for chunks with data
     for (unsigned int i = 0; i < region_dim::CHUNK_COUNT; ++i) {
         file.read(reinterpret_cast<char*>(&value), sizeof(value));
         convert_endian(value);
-        reg.get_header().get_info_at(i).set_offset(value);
+        if (value)
+            reg.get_header().get_info_at(i).set_offset(value);
     }
 
     // read timestamp data into header
     for (unsigned int i = 0; i < region_dim::CHUNK_COUNT; ++i) {
         file.read(reinterpret_cast<char*>(&value), sizeof(value));
         convert_endian(value);
-        reg.get_header().get_info_at(i).set_modified(value);
+        if (value)
+            reg.get_header().get_info_at(i).set_modified(value);
     }
 
     // read length and compression type data into header
     for (unsigned int i = 0; i < region_dim::CHUNK_COUNT; ++i) {
-        offset = reg.get_header().get_info_at(i).get_offset();
+        chunk_info* info = reg.get_header().find_info_at(i);
 
         // skip all empty chunks
-        if (!offset)
+        if (!info || !(offset = info->get_offset()))
             continue;
 
         // collect length and compression data
         file.seekg((offset >> 8) * region_dim::SECTOR_SIZE, std::ios::beg);
         file.read(reinterpret_cast<char*>(&value), sizeof(value));
         convert_endian(value);
-        reg.get_header().get_info_at(i).set_length(value);
+        info->set_length(value);
         file.read(&type, sizeof(type));
-        reg.get_header().get_info_at(i).set_type(type);
-        reg.get_header().get_info_at(i).set_offset((unsigned int) file.tellg());
+        info->set_type(type);
+        info->set_offset((unsigned int) file.tellg());
     }
 }
 
@@ -788,19 +938,13 @@ std::string region_file_reader::read_string_value(byte_stream& stream) {
 
     // retrieve value
     str_len = read_value<short>(stream);
+    value.reserve(str_len);
     for (short i = 0; i < str_len; ++i) {
         value += read_value<char>(stream);
     }
     return value;
 }
 
-uint64_t region_file_reader::getBits(uint64_t val, unsigned int start, unsigned int end) {
-    val >>= start;
-    unsigned int relevantBits = static_cast<unsigned int>(pow(2, end - start) - 1);
-    val &= relevantBits;
-    return val;
-}
-
 
 
 
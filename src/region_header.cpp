@@ -22,39 +22,6 @@
 #include "../include/byte_stream.h"
 #include "../include/region_header.h"
 
-/*
- * Region header constructor
- */
-region_header::region_header(void) {
-
-    // initialize attributes
-    for (unsigned int i = 0; i < region_dim::CHUNK_COUNT; ++i) {
-        info[i] = chunk_info();
-    }
-}
-
-/*
- * Region header constructor
- */
-region_header::region_header(const region_header& other) {
-
-    // set attributes
-    for (unsigned int i = 0; i < region_dim::CHUNK_COUNT; ++i) {
-        info[i] = other.info[i];
-    }
-}
-
-/*
- * Region header constructor
- */
-region_header::region_header(const chunk_info (& info)[region_dim::CHUNK_COUNT]) {
-
-    // set attributes
-    for (unsigned int i = 0; i < region_dim::CHUNK_COUNT; ++i) {
-        this->info[i] = info[i];
-    }
-}
-
 /*
  * Region header assignment operator
  */
@@ -65,9 +32,7 @@ region_header& region_header::operator=(const region_header& other) {
         return *this;
 
     // set attributes
-    for (unsigned int i = 0; i < region_dim::CHUNK_COUNT; ++i) {
-        info[i] = other.info[i];
-    }
+    info = other.info;
     return *this;
 }
 
@@ -81,27 +46,26 @@ bool region_header::operator==(const region_header& other) {
         return true;
 
     // check attributes
-    for (unsigned int i = 0; i < region_dim::CHUNK_COUNT; ++i) {
-        if (info[i] != other.info[i])
-            return false;
-    }
-    return true;
+    return info == other.info;
 }
 
 /*
  * Return a region header as character vector
  */
 std::vector<char> region_header::get_data(void) {
+    chunk_info* entry;
     byte_stream stream(byte_stream::SWAP_ENDIAN);
 
     // insert offsets
     for (unsigned int i = 0; i < region_dim::CHUNK_COUNT; ++i) {
-        stream << (int) info[i].get_offset();
+        entry = info.find(i);
+        stream << (int) (entry ? entry->get_offset() : 0);
     }
 
     // insert timestamps
     for (unsigned int i = 0; i < region_dim::CHUNK_COUNT; ++i) {
-        stream << (int) info[i].get_modified();
+        entry = info.find(i);
+        stream << (int) (entry ? entry->get_modified() : 0);
     }
     return stream.vbuf();
 }
@@ -113,33 +77,22 @@ unsigned int region_header::get_count(void) {
     unsigned int count = 0;
 
     // count all occupied regions
-    for (unsigned int i = 0; i < region_dim::CHUNK_COUNT; ++i) {
-        if (!info[i].empty())
+    info.for_each([&count](unsigned int, chunk_info& entry) {
+        if (!entry.empty())
             ++count;
-    }
+    });
     return count;
 }
 
 /*
- * Return a region header's info at a given index
+ * Return a region header's info at a given index, allocating it on first use
  */
 chunk_info& region_header::get_info_at(unsigned int index) {
 
     // check for valid index
     if (index >= region_dim::CHUNK_COUNT)
         throw std::out_of_range("index out-of-range");
-    return info[index];
-}
-
-/*
- * Set a region header's info
- */
-void region_header::set_info(const chunk_info (& info)[region_dim::CHUNK_COUNT]) {
-
-    // set info
-    for (unsigned int i = 0; i < region_dim::CHUNK_COUNT; ++i) {
-        this->info[i] = info[i];
-    }
+    return info.at(index);
 }
 
 /*
@@ -150,7 +103,7 @@ void region_header::set_info_at(unsigned int index, const chunk_info& info) {
     // check for valid index
     if (index >= region_dim::CHUNK_COUNT)
         throw std::out_of_range("index out-of-range");
-    this->info[index] = info;
+    this->info.at(index) = info;
 }
 
 /*
@@ -0,0 +1,298 @@
+/*
+ * shared_chunk_cache.cpp
+ * Copyright (C) 2012 - 2019 David Jolly
+ * ----------------------
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <stdexcept>
+#include <thread>
+#include "../include/shared_chunk_cache.h"
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define SHARED_CHUNK_CACHE_POSIX
+#endif
+
+static_assert(std::atomic<uint32_t>::is_always_lock_free && std::atomic<uint64_t>::is_always_lock_free,
+    "shared memory atomics must be lock free");
+
+namespace {
+
+/*
+ * Segment magic ("ACHC"), published last by the creating process
+ */
+const uint32_t SEGMENT_MAGIC = 0x41434843;
+
+/*
+ * Segment layout version, bumped with any change to the layout or payload format
+ */
+const uint32_t SEGMENT_VERSION = 1;
+
+/*
+ * Slot states
+ */
+const uint32_t SLOT_EMPTY = 0;
+const uint32_t SLOT_WRITING = 1;
+const uint32_t SLOT_READY = 2;
+
+/*
+ * Alignment of the slot table, the arena and every payload
+ */
+const size_t ALIGNMENT = 64;
+
+/*
+ * How long to wait for another process to finish creating a segment
+ */
+const std::chrono::seconds CREATE_TIMEOUT(5);
+
+size_t align(size_t value, size_t alignment) {
+    return (value + alignment - 1) & ~(alignment - 1);
+}
+}
+
+/*
+ * Segment header, zero filled until the creating process publishes the magic
+ */
+struct shared_chunk_cache::segment_header {
+    std::atomic<uint32_t> magic;
+    uint32_t version;
+    uint64_t slot_count;
+    uint64_t data_size;
+    std::atomic<uint64_t> used;
+};
+
+/*
+ * Index slot, the key and payload location are immutable once the state is SLOT_READY
+ */
+struct shared_chunk_cache::slot {
+    std::atomic<uint32_t> state;
+    key k;
+    uint64_t offset;
+    uint64_t size;
+};
+
+/*
+ * Shared chunk cache constructor. Opens the named segment, creating it with data_size
+ * payload bytes and slot_count index slots (rounded up to a power of two) if it does not exist.
+ * An existing segment keeps its own layout. Throws std::runtime_error on failure.
+ */
+shared_chunk_cache::shared_chunk_cache(const std::string& name, size_t data_size, unsigned int slot_count)
+        : name(name.empty() || name[0] != '/' ? "/" + name : name), base(NULL), size(0), index_size(0),
+          arena_size(0), header(NULL), slots(NULL), data(NULL) {
+#ifdef SHARED_CHUNK_CACHE_POSIX
+    size_t slots_size, slot_count_pow2 = 1;
+    struct stat info;
+
+    while (slot_count_pow2 < slot_count) {
+        slot_count_pow2 <<= 1;
+    }
+    slots_size = align(slot_count_pow2 * sizeof(slot), ALIGNMENT);
+
+    // the creating process sizes the segment, a zero filled segment is an empty index
+    int fd = shm_open(this->name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+    bool creator = fd >= 0;
+    if (creator) {
+        size = align(sizeof(segment_header), ALIGNMENT) + slots_size + align(data_size, ALIGNMENT);
+        if (ftruncate(fd, static_cast<off_t>(size))) {
+            close(fd);
+            shm_unlink(this->name.c_str());
+            throw std::runtime_error("Failed to size shared memory segment");
+        }
+    } else {
+        fd = shm_open(this->name.c_str(), O_RDWR, 0600);
+        if (fd < 0)
+            throw std::runtime_error("Failed to open shared memory segment");
+
+        // another process may still be sizing the segment
+        auto deadline = std::chrono::steady_clock::now() + CREATE_TIMEOUT;
+        while (!fstat(fd, &info) && static_cast<size_t>(info.st_size) < sizeof(segment_header)
+                && std::chrono::steady_clock::now() < deadline) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        size = static_cast<size_t>(info.st_size);
+        if (size < sizeof(segment_header)) {
+            close(fd);
+            throw std::runtime_error("Shared memory segment was not initialized");
+        }
+    }
+
+    base = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED) {
+        base = NULL;
+        if (creator)
+            shm_unlink(this->name.c_str());
+        throw std::runtime_error("Failed to map shared memory segment");
+    }
+    header = static_cast<segment_header*>(base);
+
+    if (creator) {
+        header->version = SEGMENT_VERSION;
+        header->slot_count = slot_count_pow2;
+        data_size = align(data_size, ALIGNMENT);
+        header->data_size = data_size;
+        header->magic.store(SEGMENT_MAGIC, std::memory_order_release);
+    } else {
+        auto deadline = std::chrono::steady_clock::now() + CREATE_TIMEOUT;
+        while (header->magic.load(std::memory_order_acquire) != SEGMENT_MAGIC
+                && std::chrono::steady_clock::now() < deadline) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+
+        // the segment's own layout wins over the requested one, it is checked once and copied
+        slot_count_pow2 = header->slot_count;
+        data_size = header->data_size;
+        slots_size = align(slot_count_pow2 * sizeof(slot), ALIGNMENT);
+        if (header->magic.load(std::memory_order_acquire) != SEGMENT_MAGIC || header->version != SEGMENT_VERSION
+                || !slot_count_pow2 || (slot_count_pow2 & (slot_count_pow2 - 1)) || slot_count_pow2 > size / sizeof(slot)
+                || data_size > size || align(sizeof(segment_header), ALIGNMENT) + slots_size + data_size > size) {
+            munmap(base, size);
+            base = NULL;
+            throw std::runtime_error("Incompatible shared memory segment");
+        }
+    }
+    index_size = slot_count_pow2;
+    arena_size = data_size;
+    slots = reinterpret_cast<slot*>(static_cast<char*>(base) + align(sizeof(segment_header), ALIGNMENT));
+    data = reinterpret_cast<char*>(slots) + slots_size;
+#else
+    (void) data_size;
+    (void) slot_count;
+    throw std::runtime_error("Shared memory is not supported on this platform");
+#endif
+}
+
+/*
+ * Shared chunk cache destructor, the segment outlives the mapping
+ */
+shared_chunk_cache::~shared_chunk_cache(void) {
+#ifdef SHARED_CHUNK_CACHE_POSIX
+    if (base)
+        munmap(base, size);
+#endif
+}
+
+/*
+ * Returns a view of the payload stored for a key, empty if not cached. Payloads are never
+ * modified once published, the view stays valid for the lifetime of the cache object.
+ */
+array_view<const char> shared_chunk_cache::find(const key& k) const {
+    size_t mask = get_slot_count() - 1;
+    size_t index = get_slot_index(k);
+
+    // probe until an empty slot, slots still being written are passed over
+    for (size_t i = 0; i <= mask; ++i) {
+        const slot& entry = slots[(index + i) & mask];
+        uint32_t state = entry.state.load(std::memory_order_acquire);
+        if (state == SLOT_EMPTY)
+            break;
+        if (state != SLOT_READY || std::memcmp(&entry.k, &k, sizeof(key)))
+            continue;
+
+        // any process can write the segment, never trust a payload location
+        if (entry.offset > arena_size || entry.size > arena_size - entry.offset)
+            break;
+        return array_view<const char>(data + entry.offset, entry.size);
+    }
+    return array_view<const char>();
+}
+
+/*
+ * Returns the payload arena size in bytes
+ */
+size_t shared_chunk_cache::get_capacity(void) const {
+    return arena_size;
+}
+
+/*
+ * Returns the first slot probed for a key
+ */
+size_t shared_chunk_cache::get_slot_index(const key& k) const {
+    uint64_t hash = (static_cast<uint64_t>(static_cast<uint32_t>(k.x)) << 32) | static_cast<uint32_t>(k.z);
+
+    // splitmix64 finalizer over the position, mixed with dimension and timestamp
+    hash ^= (static_cast<uint64_t>(static_cast<uint32_t>(k.dimension)) << 32 | k.timestamp) * 0x9e3779b97f4a7c15ULL;
+    hash = (hash ^ (hash >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    hash = (hash ^ (hash >> 27)) * 0x94d049bb133111ebULL;
+    hash ^= hash >> 31;
+    return static_cast<size_t>(hash & (get_slot_count() - 1));
+}
+
+/*
+ * Returns the number of index slots
+ */
+size_t shared_chunk_cache::get_slot_count(void) const {
+    return index_size;
+}
+
+/*
+ * Returns the payload bytes allocated so far (across all processes)
+ */
+size_t shared_chunk_cache::get_used(void) const {
+    uint64_t used = header->used.load(std::memory_order_relaxed);
+    return used < arena_size ? used : arena_size;
+}
+
+/*
+ * Publish a payload for a key. Returns false if the payload is empty or the arena or index is full.
+ * Publishing a key already present is a no-op.
+ */
+bool shared_chunk_cache::insert(const key& k, const std::vector<char>& payload) {
+    size_t mask = get_slot_count() - 1;
+    size_t index = get_slot_index(k);
+
+    if (payload.empty() || !find(k).empty())
+        return !payload.empty();
+
+    // reserve and fill the payload first, readers can only reach it once a slot is published
+    uint64_t length = align(payload.size(), ALIGNMENT);
+    uint64_t offset = header->used.fetch_add(length, std::memory_order_relaxed);
+    if (offset > arena_size || length > arena_size - offset)
+        return false;
+    std::memcpy(data + offset, payload.data(), payload.size());
+
+    // claim the first empty slot, a concurrent insert of the same key at worst leaves a duplicate
+    for (size_t i = 0; i <= mask; ++i) {
+        slot& entry = slots[(index + i) & mask];
+        uint32_t expected = SLOT_EMPTY;
+        if (entry.state.load(std::memory_order_relaxed) != SLOT_EMPTY
+                || !entry.state.compare_exchange_strong(expected, SLOT_WRITING, std::memory_order_acquire))
+            continue;
+        entry.k = k;
+        entry.offset = offset;
+        entry.size = payload.size();
+        entry.state.store(SLOT_READY, std::memory_order_release);
+        return true;
+    }
+    return false;
+}
+
+/*
+ * Remove a named segment, processes which mapped it keep their mapping
+ */
+void shared_chunk_cache::remove(const std::string& name) {
+#ifdef SHARED_CHUNK_CACHE_POSIX
+    shm_unlink((name.empty() || name[0] != '/' ? "/" + name : name).c_str());
+#else
+    (void) name;
+#endif
+}
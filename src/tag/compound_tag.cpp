@@ -138,7 +138,7 @@ std::string compound_tag::to_string(unsigned int tab) {
 /*
  * Returns the subtag with the given name. Returns NULL if not found.
  */
-generic_tag* compound_tag::get_subtag(std::string name) {
+generic_tag* compound_tag::get_subtag(std::string_view name) {
 
     for (unsigned int i = 0; i < value.size(); i++) { //check every subtag
         if (value[i]->name == name) { //if names match, return
@@ -67,11 +67,20 @@ bool long_array_tag::operator==(const generic_tag& other) {
 }
 
 /*
- * Return a integer array tag's data
+ * Return a long array tag's data
  */
 std::vector<char> long_array_tag::get_data(bool list_ele) {
     byte_stream stream(byte_stream::SWAP_ENDIAN);
 
+    get_data(list_ele, stream);
+
+    return stream.vbuf();
+}
+
+/*
+ * Save a long array tag's data to a stream
+ */
+void long_array_tag::get_data(bool list_ele, byte_stream& stream) {
     // form data representation
     if (!list_ele) {
         stream << (char) type;
@@ -82,7 +91,21 @@ std::vector<char> long_array_tag::get_data(bool list_ele) {
     for (unsigned int i = 0; i < value.size(); ++i) {
         stream << value.at(i);
     }
-    return stream.vbuf();
+}
+
+/*
+ * Return a long array tag's data size, equivalent to get_data().size(), but faster.
+ */
+unsigned int long_array_tag::get_data_size(bool list_ele) {
+    unsigned int total = 0; //nothing yet
+
+    if (!list_ele) {
+        total += 1 + 2 + static_cast<unsigned int>(name.size()); //1 for type, 2 for short size, and every symbol in the name.
+    }
+    total += 4; //array size, int = 4 bytes
+    total += static_cast<unsigned int>(value.size()) * 8; //8 bytes in a long, this many longs
+
+    return total;
 }
 
 /*
@@ -78,6 +78,7 @@ void string_tag::get_data(bool list_ele, byte_stream& stream) {
         stream << (short) name.size();
         stream << name;
     }
+    stream << (short) value.size();
     stream << value;
 }
 
@@ -0,0 +1,580 @@
+/*
+ * value_tag.cpp
+ * Copyright (C) 2012 - 2019 David Jolly
+ * ----------------------
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <cstring>
+#include <sstream>
+#include <stdexcept>
+#include "../../include/byte_stream.h"
+#include "../../include/tag/byte_tag.h"
+#include "../../include/tag/byte_array_tag.h"
+#include "../../include/tag/compound_tag.h"
+#include "../../include/tag/double_tag.h"
+#include "../../include/tag/end_tag.h"
+#include "../../include/tag/float_tag.h"
+#include "../../include/tag/int_tag.h"
+#include "../../include/tag/int_array_tag.h"
+#include "../../include/tag/list_tag.h"
+#include "../../include/tag/long_tag.h"
+#include "../../include/tag/long_array_tag.h"
+#include "../../include/tag/short_tag.h"
+#include "../../include/tag/string_tag.h"
+#include "../../include/tag/value_tag.h"
+
+/*
+ * Reads a numeric value from stream
+ */
+template<class T>
+static T read_number(byte_stream& stream) {
+    T value;
+
+    // check stream status
+    if (!stream.good() || !(stream >> value))
+        throw std::runtime_error("Unexpected end of stream");
+    return value;
+}
+
+/*
+ * Reads a floating point value from stream (bit pattern of the same width integer)
+ */
+template<class T, class B>
+static T read_floating(byte_stream& stream) {
+    T value;
+    B bits = read_number<B>(stream);
+
+    std::memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+/*
+ * Reads an array value from stream
+ */
+template<class T>
+static std::vector<T> read_array(byte_stream& stream) {
+    std::vector<T> value;
+    int ele_len = read_number<int>(stream);
+
+    // lengths come from the stream, never reserve more than it can hold
+    if (ele_len < 0)
+        throw std::runtime_error("Negative array length");
+    if (static_cast<size_t>(ele_len) > stream.available() / sizeof(T))
+        throw std::runtime_error("Unexpected array length");
+    value.reserve(ele_len);
+    for (int i = 0; i < ele_len; ++i) {
+        value.push_back(read_number<T>(stream));
+    }
+    return value;
+}
+
+/*
+ * Reads a string value from stream
+ */
+static std::string read_string(byte_stream& stream) {
+    std::string value;
+    unsigned short str_len = static_cast<unsigned short>(read_number<short>(stream));
+
+    value.reserve(str_len);
+    for (unsigned short i = 0; i < str_len; ++i) {
+        value += read_number<char>(stream);
+    }
+    return value;
+}
+
+/*
+ * List value equals operator
+ */
+bool value_tag::list_value::operator==(const list_value& other) const {
+    return ele_type == other.ele_type
+           && value == other.value;
+}
+
+/*
+ * Value tag equals operator
+ */
+bool value_tag::operator==(const value_tag& other) const {
+
+    // check for self
+    if (this == &other)
+        return true;
+    return value == other.value;
+}
+
+/*
+ * Convert a generic tag (recursively) into a value tag
+ */
+value_tag value_tag::from_generic(generic_tag* tag) {
+    value_type value;
+
+    // convert tag based on type
+    switch (tag->get_type()) {
+        case generic_tag::BYTE:
+            value.emplace<generic_tag::BYTE>(static_cast<byte_tag*>(tag)->get_value());
+            break;
+        case generic_tag::SHORT:
+            value.emplace<generic_tag::SHORT>(static_cast<short_tag*>(tag)->get_value());
+            break;
+        case generic_tag::INT:
+            value.emplace<generic_tag::INT>(static_cast<int_tag*>(tag)->get_value());
+            break;
+        case generic_tag::LONG:
+            value.emplace<generic_tag::LONG>(static_cast<long_tag*>(tag)->get_value());
+            break;
+        case generic_tag::FLOAT:
+            value.emplace<generic_tag::FLOAT>(static_cast<float_tag*>(tag)->get_value());
+            break;
+        case generic_tag::DOUBLE:
+            value.emplace<generic_tag::DOUBLE>(static_cast<double_tag*>(tag)->get_value());
+            break;
+        case generic_tag::BYTE_ARRAY:
+            value.emplace<generic_tag::BYTE_ARRAY>(static_cast<byte_array_tag*>(tag)->get_value());
+            break;
+        case generic_tag::STRING:
+            value.emplace<generic_tag::STRING>(static_cast<string_tag*>(tag)->get_value());
+            break;
+        case generic_tag::LIST: {
+            list_tag* lst = static_cast<list_tag*>(tag);
+            list_value& l_val = value.emplace<generic_tag::LIST>();
+            l_val.ele_type = lst->get_element_type();
+            l_val.value.reserve(lst->size());
+            for (unsigned int i = 0; i < lst->size(); ++i) {
+                l_val.value.push_back(from_generic(lst->at(i)));
+            }
+        }
+            break;
+        case generic_tag::COMPOUND: {
+            compound_tag* cmp = static_cast<compound_tag*>(tag);
+            compound_value& c_val = value.emplace<generic_tag::COMPOUND>();
+            c_val.reserve(cmp->size());
+            for (unsigned int i = 0; i < cmp->size(); ++i) {
+                c_val.push_back(entry{cmp->at(i)->get_name(), from_generic(cmp->at(i))});
+            }
+        }
+            break;
+        case generic_tag::INT_ARRAY:
+            value.emplace<generic_tag::INT_ARRAY>(static_cast<int_array_tag*>(tag)->get_value());
+            break;
+        case generic_tag::LONG_ARRAY:
+            value.emplace<generic_tag::LONG_ARRAY>(static_cast<long_array_tag*>(tag)->get_value());
+            break;
+        default:
+        case generic_tag::END:
+            break;
+    }
+    return value_tag(std::move(value));
+}
+
+/*
+ * Save a value tag's data to a stream
+ */
+void value_tag::get_data(bool list_ele, const std::string& name, byte_stream& stream) const {
+    unsigned char type = get_type();
+
+    // form data representation
+    if (!list_ele) {
+        stream << (char) type;
+        if (type == generic_tag::END)
+            return;
+        stream << (short) name.size();
+        stream << name;
+    }
+    switch (type) {
+        case generic_tag::BYTE:
+            stream << std::get<generic_tag::BYTE>(value);
+            break;
+        case generic_tag::SHORT:
+            stream << std::get<generic_tag::SHORT>(value);
+            break;
+        case generic_tag::INT:
+            stream << std::get<generic_tag::INT>(value);
+            break;
+        case generic_tag::LONG:
+            stream << std::get<generic_tag::LONG>(value);
+            break;
+        case generic_tag::FLOAT:
+            stream << std::get<generic_tag::FLOAT>(value);
+            break;
+        case generic_tag::DOUBLE:
+            stream << std::get<generic_tag::DOUBLE>(value);
+            break;
+        case generic_tag::BYTE_ARRAY: {
+            const std::vector<char>& arr = std::get<generic_tag::BYTE_ARRAY>(value);
+            stream << (int) arr.size();
+            for (unsigned int i = 0; i < arr.size(); ++i) {
+                stream << arr[i];
+            }
+        }
+            break;
+        case generic_tag::STRING: {
+            const std::string& str = std::get<generic_tag::STRING>(value);
+            stream << (short) str.size();
+            stream << str;
+        }
+            break;
+        case generic_tag::LIST: {
+            const list_value& lst = std::get<generic_tag::LIST>(value);
+            stream << (char) lst.ele_type;
+            stream << (int) lst.value.size();
+            for (unsigned int i = 0; i < lst.value.size(); ++i) {
+                lst.value[i].get_data(true, std::string(), stream);
+            }
+        }
+            break;
+        case generic_tag::COMPOUND: {
+            const compound_value& cmp = std::get<generic_tag::COMPOUND>(value);
+            for (unsigned int i = 0; i < cmp.size(); ++i) {
+                cmp[i].value.get_data(false, cmp[i].name, stream);
+            }
+            stream << (char) generic_tag::END;
+        }
+            break;
+        case generic_tag::INT_ARRAY: {
+            const std::vector<int>& arr = std::get<generic_tag::INT_ARRAY>(value);
+            stream << (int) arr.size();
+            for (unsigned int i = 0; i < arr.size(); ++i) {
+                stream << arr[i];
+            }
+        }
+            break;
+        case generic_tag::LONG_ARRAY: {
+            const std::vector<int64_t>& arr = std::get<generic_tag::LONG_ARRAY>(value);
+            stream << (int) arr.size();
+            for (unsigned int i = 0; i < arr.size(); ++i) {
+                stream << arr[i];
+            }
+        }
+            break;
+        default:
+            break;
+    }
+}
+
+/*
+ * Return a value tag's data
+ */
+std::vector<char> value_tag::get_data(bool list_ele, const std::string& name) const {
+    byte_stream stream(byte_stream::SWAP_ENDIAN);
+
+    get_data(list_ele, name, stream);
+
+    return stream.vbuf();
+}
+
+/*
+ * Return the size of a value tag's data, equivalent to get_data().size(), but faster.
+ */
+unsigned int value_tag::get_data_size(bool list_ele, const std::string& name) const {
+    unsigned int total = 0; //nothing yet
+    unsigned char type = get_type();
+
+    if (!list_ele) {
+        if (type == generic_tag::END)
+            return 1; //just a char
+        total += 1 + 2 + static_cast<unsigned int>(name.size()); //1 for type, 2 for short size, and every symbol in the name.
+    }
+    switch (type) {
+        case generic_tag::BYTE:
+            total += 1;
+            break;
+        case generic_tag::SHORT:
+            total += 2;
+            break;
+        case generic_tag::INT:
+        case generic_tag::FLOAT:
+            total += 4;
+            break;
+        case generic_tag::LONG:
+        case generic_tag::DOUBLE:
+            total += 8;
+            break;
+        case generic_tag::BYTE_ARRAY:
+            total += 4 + static_cast<unsigned int>(std::get<generic_tag::BYTE_ARRAY>(value).size());
+            break;
+        case generic_tag::STRING:
+            total += 2 + static_cast<unsigned int>(std::get<generic_tag::STRING>(value).size());
+            break;
+        case generic_tag::LIST: {
+            const list_value& lst = std::get<generic_tag::LIST>(value);
+            total += 1 + 4; //1 for ele type, 4 for size
+            for (unsigned int i = 0; i < lst.value.size(); ++i) {
+                total += lst.value[i].get_data_size(true, std::string());
+            }
+        }
+            break;
+        case generic_tag::COMPOUND: {
+            const compound_value& cmp = std::get<generic_tag::COMPOUND>(value);
+            for (unsigned int i = 0; i < cmp.size(); ++i) {
+                total += cmp[i].value.get_data_size(false, cmp[i].name);
+            }
+            total += 1; //end tag
+        }
+            break;
+        case generic_tag::INT_ARRAY:
+            total += 4 + static_cast<unsigned int>(std::get<generic_tag::INT_ARRAY>(value).size()) * 4;
+            break;
+        case generic_tag::LONG_ARRAY:
+            total += 4 + static_cast<unsigned int>(std::get<generic_tag::LONG_ARRAY>(value).size()) * 8;
+            break;
+        default:
+            break;
+    }
+    return total;
+}
+
+/*
+ * Returns the subtag with the given name. Returns NULL if not found or not a compound.
+ */
+value_tag* value_tag::get_subtag(const std::string& name) {
+    compound_value* cmp = std::get_if<generic_tag::COMPOUND>(&value);
+
+    if (!cmp)
+        return NULL;
+    for (unsigned int i = 0; i < cmp->size(); ++i) { //check every subtag
+        if ((*cmp)[i].name == name) {
+            return &(*cmp)[i].value;
+        }
+    }
+    return NULL; //not found
+}
+
+/*
+ * Read a tag payload of a given type from a (big endian) stream
+ */
+value_tag value_tag::parse(byte_stream& stream, char type) {
+    value_type value;
+
+    // parse tag based off type
+    switch (type) {
+        case generic_tag::END:
+            break;
+        case generic_tag::BYTE:
+            value.emplace<generic_tag::BYTE>(read_number<char>(stream));
+            break;
+        case generic_tag::SHORT:
+            value.emplace<generic_tag::SHORT>(read_number<short>(stream));
+            break;
+        case generic_tag::INT:
+            value.emplace<generic_tag::INT>(read_number<int>(stream));
+            break;
+        case generic_tag::LONG:
+            value.emplace<generic_tag::LONG>(read_number<int64_t>(stream));
+            break;
+        case generic_tag::FLOAT:
+            value.emplace<generic_tag::FLOAT>(read_floating<float, int>(stream));
+            break;
+        case generic_tag::DOUBLE:
+            value.emplace<generic_tag::DOUBLE>(read_floating<double, int64_t>(stream));
+            break;
+        case generic_tag::BYTE_ARRAY:
+            value.emplace<generic_tag::BYTE_ARRAY>(read_array<char>(stream));
+            break;
+        case generic_tag::STRING:
+            value.emplace<generic_tag::STRING>(read_string(stream));
+            break;
+        case generic_tag::LIST: {
+            list_value& lst = value.emplace<generic_tag::LIST>();
+            lst.ele_type = read_number<char>(stream);
+            int ele_len = read_number<int>(stream);
+
+            // parse all elements and add to list, lengths past the stream's bytes are corrupt
+            if (ele_len > 0 && static_cast<size_t>(ele_len) > stream.available())
+                throw std::runtime_error("Unexpected list length");
+            if (ele_len > 0)
+                lst.value.reserve(ele_len);
+            for (int i = 0; i < ele_len; ++i) {
+                lst.value.push_back(parse(stream, lst.ele_type));
+            }
+        }
+            break;
+        case generic_tag::COMPOUND: {
+            compound_value& cmp = value.emplace<generic_tag::COMPOUND>();
+
+            // parse all named entries until the end tag
+            for (char sub_type = read_number<char>(stream); sub_type != generic_tag::END; sub_type = read_number<char>(stream)) {
+                std::string sub_name = read_string(stream);
+                cmp.push_back(entry{std::move(sub_name), parse(stream, sub_type)});
+            }
+        }
+            break;
+        case generic_tag::INT_ARRAY:
+            value.emplace<generic_tag::INT_ARRAY>(read_array<int>(stream));
+            break;
+        case generic_tag::LONG_ARRAY:
+            value.emplace<generic_tag::LONG_ARRAY>(read_array<int64_t>(stream));
+            break;
+        default:
+            throw std::runtime_error("Unknown tag type: " + std::to_string(type));
+    }
+    return value_tag(std::move(value));
+}
+
+/*
+ * Convert a value tag (recursively) into a newly allocated generic tag
+ */
+generic_tag* value_tag::to_generic(const std::string& name) const {
+    generic_tag* tag = NULL;
+
+    // convert tag based on type
+    switch (get_type()) {
+        default:
+        case generic_tag::END:
+            tag = new end_tag();
+            break;
+        case generic_tag::BYTE:
+            tag = new byte_tag(name, std::get<generic_tag::BYTE>(value));
+            break;
+        case generic_tag::SHORT:
+            tag = new short_tag(name, std::get<generic_tag::SHORT>(value));
+            break;
+        case generic_tag::INT:
+            tag = new int_tag(name, std::get<generic_tag::INT>(value));
+            break;
+        case generic_tag::LONG:
+            tag = new long_tag(name, std::get<generic_tag::LONG>(value));
+            break;
+        case generic_tag::FLOAT:
+            tag = new float_tag(name, std::get<generic_tag::FLOAT>(value));
+            break;
+        case generic_tag::DOUBLE:
+            tag = new double_tag(name, std::get<generic_tag::DOUBLE>(value));
+            break;
+        case generic_tag::BYTE_ARRAY:
+            tag = new byte_array_tag(name, std::get<generic_tag::BYTE_ARRAY>(value));
+            break;
+        case generic_tag::STRING:
+            tag = new string_tag(name, std::get<generic_tag::STRING>(value));
+            break;
+        case generic_tag::LIST: {
+            const list_value& lst = std::get<generic_tag::LIST>(value);
+            list_tag* c_lst = new list_tag(name, lst.ele_type);
+            for (unsigned int i = 0; i < lst.value.size(); ++i) {
+                c_lst->push_back(lst.value[i].to_generic(std::string()));
+            }
+            tag = c_lst;
+        }
+            break;
+        case generic_tag::COMPOUND: {
+            const compound_value& cmp = std::get<generic_tag::COMPOUND>(value);
+            compound_tag* c_cmp = new compound_tag(name);
+            for (unsigned int i = 0; i < cmp.size(); ++i) {
+                c_cmp->push_back(cmp[i].value.to_generic(cmp[i].name));
+            }
+            tag = c_cmp;
+        }
+            break;
+        case generic_tag::INT_ARRAY:
+            tag = new int_array_tag(name, std::get<generic_tag::INT_ARRAY>(value));
+            break;
+        case generic_tag::LONG_ARRAY:
+            tag = new long_array_tag(name, std::get<generic_tag::LONG_ARRAY>(value));
+            break;
+    }
+    return tag;
+}
+
+/*
+ * Return a string representation of a value tag
+ */
+std::string value_tag::to_string(unsigned int tab, const std::string& name) const {
+    std::stringstream ss;
+    unsigned char type = get_type();
+
+    // form string representation
+    generic_tag::append_tabs(tab, ss);
+    ss << generic_tag::type_to_string(type);
+    if (!name.empty())
+        ss << " " << name;
+    switch (type) {
+        case generic_tag::BYTE:
+            ss << ": " << (int) std::get<generic_tag::BYTE>(value);
+            break;
+        case generic_tag::SHORT:
+            ss << ": " << std::get<generic_tag::SHORT>(value);
+            break;
+        case generic_tag::INT:
+            ss << ": " << std::get<generic_tag::INT>(value);
+            break;
+        case generic_tag::LONG:
+            ss << ": " << std::get<generic_tag::LONG>(value);
+            break;
+        case generic_tag::FLOAT:
+            ss << ": " << std::get<generic_tag::FLOAT>(value);
+            break;
+        case generic_tag::DOUBLE:
+            ss << ": " << std::get<generic_tag::DOUBLE>(value);
+            break;
+        case generic_tag::STRING:
+            ss << ": " << std::get<generic_tag::STRING>(value);
+            break;
+        case generic_tag::BYTE_ARRAY: {
+            const std::vector<char>& arr = std::get<generic_tag::BYTE_ARRAY>(value);
+            ss << " (" << arr.size() << ") { ";
+            for (unsigned int i = 0; i < arr.size(); ++i) {
+                ss << (int) arr[i] << ", ";
+            }
+            ss << "}";
+        }
+            break;
+        case generic_tag::INT_ARRAY: {
+            const std::vector<int>& arr = std::get<generic_tag::INT_ARRAY>(value);
+            ss << " (" << arr.size() << ") { ";
+            for (unsigned int i = 0; i < arr.size(); ++i) {
+                ss << arr[i] << ", ";
+            }
+            ss << "}";
+        }
+            break;
+        case generic_tag::LONG_ARRAY: {
+            const std::vector<int64_t>& arr = std::get<generic_tag::LONG_ARRAY>(value);
+            ss << " (" << arr.size() << ") { ";
+            for (unsigned int i = 0; i < arr.size(); ++i) {
+                ss << arr[i] << ", ";
+            }
+            ss << "}";
+        }
+            break;
+        case generic_tag::LIST: {
+            const list_value& lst = std::get<generic_tag::LIST>(value);
+            ss << " (" << lst.value.size() << ") {";
+            if (!lst.value.empty()) {
+                ss << std::endl;
+                for (unsigned int i = 0; i < lst.value.size(); ++i) {
+                    ss << lst.value[i].to_string(tab + 1, std::string()) << std::endl;
+                }
+                generic_tag::append_tabs(tab, ss);
+            }
+            ss << "}";
+        }
+            break;
+        case generic_tag::COMPOUND: {
+            const compound_value& cmp = std::get<generic_tag::COMPOUND>(value);
+            ss << " (" << cmp.size() << ") {";
+            if (!cmp.empty()) {
+                ss << std::endl;
+                for (unsigned int i = 0; i < cmp.size(); ++i) {
+                    ss << cmp[i].value.to_string(tab + 1, cmp[i].name) << std::endl;
+                }
+                generic_tag::append_tabs(tab, ss);
+            }
+            ss << "}";
+        }
+            break;
+        default:
+            break;
+    }
+    return ss.str();
+}